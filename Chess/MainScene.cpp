@@ -30,14 +30,19 @@ void MainScene::onFoundMove(chess::FullMove m) {
     auto& i = instance();
     i.board.doFullMove(m);
     i.pieceMovingData.setInterpolatedMove(m);
+    i.hintsPending = true;
     i.redraw();
     SoundManager::playPieceMove();
 }
+void MainScene::onHintsUpdated() {
+    instance().redraw();
+}
 
 MainScene::MainScene()
         : board(onPromotion, onCheckmate, onStalemate, onGameDraw),
-          bot(onFoundMove) {
+          bot(onFoundMove, onHintsUpdated) {
     showingValidMoves = true;
+    showingHints = false;
 }
 
 bool MainScene::getShowingValidMoves() {
@@ -50,6 +55,20 @@ void MainScene::toggleShowingValidMoves() {
     instance().showingValidMoves = !instance().showingValidMoves;
 }
 
+bool MainScene::getShowingHints() {
+    return instance().showingHints;
+}
+void MainScene::toggleShowingHints() {
+    auto& i = instance();
+    i.showingHints = !i.showingHints;
+    if (!i.showingHints) {
+        i.bot.stopHints();
+        i.hintsPending = false;
+    } else if (i.board.getCurrentSide() == i.playerSide) {
+        i.hintsPending = true;
+    }
+}
+
 void MainScene::updateBotDifficulty() {
     playerNames[getOtherSide(playerSide)] = concat("Bot ", bot.getDifficulty());
 }
@@ -64,11 +83,21 @@ void MainScene::newGameImpl(chess::Side side) {
     board.reset();
     bot.reset();
     validMoves.clear();
+    hintsPending = side == chess::Side::White;
     SceneManager::load(*this);
     if (side != chess::Side::White)
         bot.onPlayerMove(board.getState());
 }
 
+void MainScene::onDraw(Paint& paint) {
+    // Hints would stop the speculative search while a piece is held
+    if (!isSelected() && hintsPending.exchange(false)) {
+        if (showingHints && board.getCurrentSide() == playerSide)
+            bot.startHints(board.getState());
+    }
+    BoardDrawingScene::onDraw(paint);
+}
+
 void MainScene::drawBoard(Paint& paint) const {
     if (isSelected()) {
         auto pt = boardPosToScreen(selectedPos);
@@ -81,6 +110,16 @@ void MainScene::drawBoard(Paint& paint) const {
             paint.fillPixelatedCircle(pt, SquareLength / 4, ValidColor, 2);
         }
     }
+    if (showingHints) {
+        auto hints = bot.getHints();
+        // Draw the best hint last so it ends up on top
+        for (int i = int(hints.size()) - 1; i >= 0; --i) {
+            auto from = boardPosToScreen(hints[i].from) + SquareSize / 2;
+            auto to = boardPosToScreen(hints[i].to) + SquareSize / 2;
+            auto col = HintColor.withAlpha(HintColor.a() / (i + 1));
+            paint.drawArrow(from, to, SquareLength / 8, col);
+        }
+    }
     spriteOnBoard(paint, cursor, sprites::Cursor, sprites::CursorPalette);
 }
 void MainScene::moveVert(int dir) {
@@ -92,6 +131,10 @@ void MainScene::moveVert(int dir) {
 
 bool MainScene::isSelected() const { return selectedPos.isValid(); }
 void MainScene::deselect() {
+    if (isSelected()) {
+        bot.stopSpeculation();
+        hintsPending = true;
+    }
     validMoves.clear();
     selectedPos = chess::Pos::Invalid;
     redraw();
@@ -105,6 +148,17 @@ bool MainScene::trySelect(chess::Pos pos) {
     val->getValidMoves(pos, board.getState(), validMoves);
 
     selectedPos = pos;
+
+    if (board.getCurrentSide() == playerSide) {
+        std::vector<chess::FullMove> candidates;
+        for (auto m : validMoves) {
+            auto pr = m.type == chess::Move::Type::Promotion
+                ? chess::PromotionResult::Queen
+                : chess::PromotionResult::None;
+            candidates.emplace_back(pos, m.pos, pr);
+        }
+        bot.startSpeculation(board.getState(), candidates);
+    }
     return true;
 }
 
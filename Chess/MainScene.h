@@ -4,6 +4,7 @@
 #include "chess/Board.h"
 #include "chess/Bot.h"
 
+#include <atomic>
 #include <chrono>
 
 class MainScene : public BoardDrawingScene {
@@ -17,6 +18,7 @@ public:
         instance().newGameImpl(side);
     }
 
+    void onDraw(core::Paint& paint) override;
     void drawBoard(core::Paint& paint) const override;
 
     void onKeyDown(char k) override;
@@ -31,6 +33,9 @@ public:
     static void setShowingValidMoves(bool val);
     static void toggleShowingValidMoves();
 
+    static bool getShowingHints();
+    static void toggleShowingHints();
+
     chess::Board& getBoard() { return board; }
 
     const chess::Board& getBoard() const override { return board; }
@@ -54,6 +59,11 @@ private:
     std::vector<chess::Move> validMoves;
 
     bool showingValidMoves;
+    bool showingHints;
+
+    // The hint search can't be started from the bot's callback (it runs on
+    // the search thread), so we start it on the next draw
+    std::atomic_bool hintsPending = false;
 
     bool isSelected() const;
     void deselect();
@@ -67,4 +77,5 @@ private:
 
     static void onExecutedMove(chess::FullMove m);
     static void onFoundMove(chess::FullMove m);
+    static void onHintsUpdated();
 };
@@ -11,6 +11,7 @@ enum Button : int {
     SfxVolume,
     Difficulty,
     ShowValidMoves,
+    ShowHints,
     IsResizeable,
 
     BtnCount,
@@ -37,6 +38,7 @@ OptionsScene::OptionsScene()
                                       chess::Bot::setDifficulty),
             ButtonData::makeRadio("Show valid moves",
                                   MainScene::getShowingValidMoves),
+            ButtonData::makeRadio("Show hints", MainScene::getShowingHints),
             ButtonData::makeRadio("Is Resizeable", getIsResizeable),
         }, Mode::Vertical), rects(2) {}
 
@@ -85,6 +87,10 @@ void OptionsScene::onButtonSelected(int index) {
         MainScene::toggleShowingValidMoves();
         redraw();
         break;
+    case Button::ShowHints:
+        MainScene::toggleShowingHints();
+        redraw();
+        break;
     case Button::IsResizeable: {
         auto& wh = WindowHandler::instance();
         if (wh.getWindowMode() == WindowMode::Static) {
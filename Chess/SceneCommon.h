@@ -23,6 +23,7 @@ constexpr core::Color BigTextCol = core::Color::Red;
 
 constexpr core::Color SelectedColor = core::Color::Green.withAlpha(200);
 constexpr core::Color ValidColor    = core::Color::Blue.withAlpha(200);
+constexpr core::Color HintColor     = core::Color::NiceOrange.withAlpha(220);
 
 constexpr core::Point VertButtonSize {350, 64};
 constexpr int ButtonSpacing = 5;
@@ -3,7 +3,9 @@
 #include "BoardState.h"
 
 #include "../stockfish/endgame.h"
+#include "../stockfish/tbgen.h"
 #include "../stockfish/thread.h"
+#include "../stockfish/tt.h"
 #include "../stockfish/uci.h"
 
 #include <sstream>
@@ -35,8 +37,8 @@ constexpr chess::PromotionResult toPR(stockfish::PieceType pt) {
     }
 }
 
-namespace stockfish::Search {
-void onBestMoveFound(stockfish::Move sm) {
+static chess::FullMove toFullMove(stockfish::Move sm) {
+    using namespace stockfish;
     chess::Pos from = squareToPos(from_sq(sm));
     chess::Pos to = squareToPos(to_sq(sm));
     chess::PromotionResult pr = toPR(promotion_type(sm));
@@ -51,9 +53,35 @@ void onBestMoveFound(stockfish::Move sm) {
             to.x() = from.x() + 2;
         }
     }
-    chess::FullMove move(from, to, pr);
+    return chess::FullMove(from, to, pr);
+}
+
+namespace stockfish::Search {
+void onBestMoveFound(stockfish::Move sm) {
+    using SearchMode = chess::Bot::SearchMode;
+    auto bot = chess::Bot::instance;
+    switch (bot->mode) {
+    case SearchMode::Play:
+        bot->onBotMoved();
+        bot->foundMoveCallback(toFullMove(sm));
+        break;
+    case SearchMode::Speculation:
+        bot->speculativeBest = sm;
+        break;
+    case SearchMode::Hints:
+        break;
+    }
+}
+void onIterationFinished(const RootMoves& rootMoves, size_t multiPV, Depth) {
+    auto bot = chess::Bot::instance;
+    if (bot->mode != chess::Bot::SearchMode::Hints)
+        return;
 
-    chess::Bot::instance->foundMoveCallback(move);
+    std::vector<chess::FullMove> res;
+    for (size_t i = 0; i < multiPV; ++i)
+        res.push_back(toFullMove(rootMoves[i].pv[0]));
+
+    bot->setHints(std::move(res));
 }
 }
 
@@ -64,6 +92,8 @@ namespace chess {
 int Bot::difficulty = 3;
 Bot* Bot::instance = nullptr;
 stockfish::Search::LimitsType Bot::limits;
+TimePoint Bot::gameTime = Bot::DefaultGameTimeMs;
+TimePoint Bot::increment = Bot::DefaultIncrementMs;
 
 class InvalidMoveError {};
 
@@ -81,9 +111,11 @@ stockfish::Move Bot::toStockfishMove(const FullMove& m) {
     throw InvalidMoveError{};
 }
 
-Bot::Bot(FoundMoveCallback callback, int depth, int64_t nodes,
-          std::chrono::milliseconds::rep timeMs)
-        : foundMoveCallback(callback) {
+Bot::Bot(FoundMoveCallback callback, HintsUpdatedCallback hintsCallback,
+         int depth, int64_t nodes, std::chrono::milliseconds::rep timeMs)
+        : foundMoveCallback(callback),
+          hintsUpdatedCallback(hintsCallback),
+          rng(now()) {
     if (instance != nullptr) {
         throw new std::logic_error("can't have multiple Bot instances");
     }
@@ -93,10 +125,13 @@ Bot::Bot(FoundMoveCallback callback, int depth, int64_t nodes,
     limits.time[WHITE] = limits.time[BLACK] = timeMs;
 
     UCI::init(Options);
+    // The game often follows lines the bot or the hints already searched
+    Options["Fast Move"] = std::string("true");
+    // Only matters for the timed levels, short on clock anyway
+    Options["Fast Few Moves"] = std::string("true");
     PSQT::init();
     Bitboards::init();
     Position::init();
-    Bitbases::init();
     Endgames::init();
     Threads.set(Options["Threads"]);
     Search::clear();
@@ -104,36 +139,126 @@ Bot::Bot(FoundMoveCallback callback, int depth, int64_t nodes,
 
 void Bot::setDifficulty(int val) {
     val = core::clamp(val, MinDifficulty, MaxDifficulty);
+    // Keep the part of the budget already spent in this game
+    if (instance != nullptr) {
+        std::lock_guard<std::mutex> lk(instance->clockMutex);
+        instance->clock = instance->clock * clockShare(val) / clockShare(difficulty);
+    }
     difficulty = val;
-    if (val == 0) {
-        limits.depth = 1;
-        limits.nodes = 5;
-    } else if (val == 1) {
-        limits.depth = 1;
-        limits.nodes = 10;
-    } else if (val == 2) {
-        limits.depth = 1;
-        limits.nodes = 50;
-    } else {
+    // The weak levels don't use the limits
+    if (val > WeakMaxDifficulty) {
         limits.depth = val-2;
+        limits.nodes = 0;
     }
 }
 int Bot::getDifficulty() {
     return difficulty;
 }
+void Bot::setTimeBudget(TimePoint gameTimeMs, TimePoint incrementMs) {
+    gameTime = gameTimeMs;
+    increment = incrementMs;
+}
+
+bool Bot::isWeak() const {
+    return difficulty <= WeakMaxDifficulty;
+}
+
+void Bot::playWeakMove() {
+    stockfish::Move m = Weak::pick(pos, Weak::Temperatures[difficulty],
+                                    Weak::Depths[difficulty], rng);
+    if (m != MOVE_NONE)
+        foundMoveCallback(toFullMove(m));
+}
+
+int Bot::clockShare(int difficulty) {
+    // The levels right above TimedMinDifficulty only get a share of the time
+    return std::max(difficulty - TimedMinDifficulty + 1, 1);
+}
+
+bool Bot::usesClock() const {
+    return difficulty >= TimedMinDifficulty && gameTime > 0;
+}
+
+Search::LimitsType Bot::searchLimits() const {
+    if (!usesClock())
+        return limits;
+
+    // Let stockfish's time management split the clock between the moves. It
+    // stretches the time of moves where the best move keeps changing or the
+    // score drops, and shortens it when there are few legal moves.
+    Search::LimitsType l;
+    Color us = pos.side_to_move();
+    {
+        std::lock_guard<std::mutex> lk(clockMutex);
+        l.time[us] = clock;
+    }
+    l.inc[us] = increment;
+    return l;
+}
+
+void Bot::onBotMoved() {
+    if (!usesClock())
+        return;
+    std::lock_guard<std::mutex> lk(clockMutex);
+    clock = std::max(clock - (now() - thinkStart) - speculationTime, TimePoint(0))
+            + increment;
+}
+
 void Bot::reset() {
+    stopHints();
+    stopSpeculation();
+    speculativeResults.clear();
+    // The depth limited levels search too little to need full size histories
+    Options["Compact History"] = std::string(usesClock() ? "false" : "true");
+    // The timed levels play the endgames of up to 4 pieces perfectly, their
+    // tables are built in the background when the game first gets to them.
+    // The depth limited levels keep their strength there. Setting the option
+    // reloads the Syzygy tables, so only when it changes.
+    int tbPieces = usesClock() ? stockfish::TBGen::MaxPieces : 0;
+    if (int(Options["Generated Tablebases"]) != tbPieces)
+        Options["Generated Tablebases"] = std::to_string(tbPieces);
     Search::clear();
     states = std::make_unique<std::deque<StateInfo>>(1);
     pos.set(StartFEN, false, &states->back(), Threads.main());
+
+    std::lock_guard<std::mutex> lk(clockMutex);
+    clock = gameTime * clockShare(difficulty) / clockShare(MaxDifficulty);
 }
 void Bot::stop() {
     Threads.stop = true;
 }
 
 void Bot::onPlayerMove(const BoardState& state) {
+    stopHints();
+    stopSpeculation();
     states = std::make_unique<std::deque<StateInfo>>(1);
     pos.set(state.getFEN(), false, &states->back(), Threads.main());
-    think();
+
+    if (isWeak()) {
+        speculativeResults.clear();
+        playWeakMove();
+        return;
+    }
+
+    Search::LimitsType l = searchLimits();
+    speculationTime = 0;
+
+    // If we already found the reply while the player was holding the piece,
+    // a search of just that root move hands it over from the search thread,
+    // like any other bot move, in a few microseconds. The clock is charged
+    // the time the speculative search took; like pondering, the searches of
+    // moves the player didn't make are free.
+    auto it = speculativeResults.find(pos.key());
+    if (it != speculativeResults.end()
+        && MoveList<LEGAL>(pos).contains(it->second.move)) {
+        l = Search::LimitsType();
+        l.searchmoves = {it->second.move};
+        l.depth = 1;
+        speculationTime = it->second.time;
+    }
+    speculativeResults.clear();
+
+    think(l);
 }
 void Bot::doMove(FullMove m) {
     try {
@@ -146,12 +271,153 @@ void Bot::doMove(FullMove m) {
                                    m, ". Ignoring"));
     }
 }
-void Bot::think() {
+void Bot::think(const Search::LimitsType& searchLimits) {
     bool ponderMode = false;
-    Threads.start_thinking(pos, states, limits, ponderMode);
+    Search::LimitsType l = searchLimits;
+    l.startTime = thinkStart = now();
+    Threads.start_thinking(pos, states, l, ponderMode);
+}
+
+void Bot::startHints(const BoardState& state) {
+    stopHints();
+    stopSpeculation();
+    states = std::make_unique<std::deque<StateInfo>>(1);
+    pos.set(state.getFEN(), false, &states->back(), Threads.main());
+
+    // The bot's last search most likely predicted this position, so we can
+    // show its expected reply right away, before the threads even wake up.
+    bool ttHit;
+    TTEntry* tte = TT.probe(pos.key(), ttHit);
+    stockfish::Move ttMove = ttHit ? tte->move() : MOVE_NONE; // Local copy to be SMP safe
+    if (ttMove != MOVE_NONE && MoveList<LEGAL>(pos).contains(ttMove))
+        setHints({toFullMove(ttMove)});
+
+    Search::LimitsType hintLimits;
+    hintLimits.depth = HintMaxDepth;
+    hintLimits.startTime = now();
+
+    Options["MultiPV"] = std::to_string(HintCount);
+    mode = SearchMode::Hints;
+    Threads.start_thinking(pos, states, hintLimits);
+}
+
+void Bot::stopHints() {
+    if (mode != SearchMode::Hints)
+        return;
+    Threads.stop = true;
+    Threads.main()->wait_for_search_finished();
+    mode = SearchMode::Play;
+    Options["MultiPV"] = std::to_string(1);
+    setHints({});
+}
+
+std::vector<FullMove> Bot::getHints() const {
+    std::lock_guard<std::mutex> lk(hintsMutex);
+    return hints;
+}
+
+void Bot::setHints(std::vector<FullMove>&& val) {
+    {
+        std::lock_guard<std::mutex> lk(hintsMutex);
+        hints = std::move(val);
+    }
+    if (hintsUpdatedCallback)
+        hintsUpdatedCallback();
+}
+
+void Bot::startSpeculation(const BoardState& state,
+                           const std::vector<FullMove>& candidates) {
+    stopHints();
+    stopSpeculation();
+    // The weak levels reply right away anyway
+    if (isWeak())
+        return;
+
+    std::string fen = state.getFEN();
+    states = std::make_unique<std::deque<StateInfo>>(1);
+    pos.set(fen, false, &states->back(), Threads.main());
+
+    bool ttHit;
+    TTEntry* tte = TT.probe(pos.key(), ttHit);
+    stockfish::Move ttMove = ttHit ? tte->move() : MOVE_NONE;
+
+    // Cheap guess of which moves the player is most likely to make: the one
+    // the engine would play, then captures of big pieces and checks, and
+    // moves that lose material last.
+    auto likeliness = [&] (stockfish::Move m) {
+        int val = m == ttMove ? 10000 : 0;
+        if (pos.capture(m))
+            val += PieceValue[MG][pos.piece_on(to_sq(m))];
+        if (pos.gives_check(m))
+            val += PawnValueMg;
+        if (!pos.see_ge(m))
+            val -= QueenValueMg;
+        return val;
+    };
+
+    std::vector<stockfish::Move> moves;
+    for (auto& m : candidates) {
+        try {
+            moves.push_back(toStockfishMove(m));
+        } catch (const InvalidMoveError&) {}
+    }
+    std::stable_sort(moves.begin(), moves.end(),
+                     [&] (stockfish::Move a, stockfish::Move b) {
+                         return likeliness(a) > likeliness(b);
+                     });
+
+    speculationStopped = false;
+    mode = SearchMode::Speculation;
+    speculationThread = std::thread(&Bot::speculate, this, std::move(fen),
+                                    std::move(moves));
+}
+
+void Bot::stopSpeculation() {
+    if (!speculationThread.joinable())
+        return;
+    speculationStopped = true;
+    Threads.stop = true;
+    speculationThread.join();
+    mode = SearchMode::Play;
+}
+
+void Bot::speculate(std::string fen, std::vector<stockfish::Move> candidates) {
+    for (auto m : candidates) {
+        if (speculationStopped)
+            return;
+
+        Position p;
+        StateListPtr st = std::make_unique<std::deque<StateInfo>>(1);
+        p.set(fen, false, &st->back(), Threads.main());
+        st->emplace_back();
+        p.do_move(m, st->back());
+
+        // The game ends here, nothing to reply
+        if (!MoveList<LEGAL>(p).size())
+            continue;
+
+        Key key = p.key();
+        Search::LimitsType l = searchLimits();
+        // The position is the one after the player's move
+        std::swap(l.time[WHITE], l.time[BLACK]);
+        std::swap(l.inc[WHITE], l.inc[BLACK]);
+        l.startTime = now();
+        speculativeBest = MOVE_NONE;
+        Threads.start_thinking(p, st, l);
+
+        // We might have been stopped before the search started
+        if (speculationStopped)
+            Threads.stop = true;
+        Threads.main()->wait_for_search_finished();
+
+        if (!speculationStopped && speculativeBest != MOVE_NONE)
+            speculativeResults[key] = {speculativeBest, now() - l.startTime};
+    }
 }
 
 Bot::~Bot() noexcept {
+    stopHints();
+    stopSpeculation();
     stockfish::Threads.set(0);
 }
 
@@ -1,13 +1,19 @@
 #pragma once
 
 #include "../stockfish/search.h"
+#include "../stockfish/weak.h"
 
 #include <chrono>
 
 #include "Piece.h"
 
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace chess {
 class Bot {
@@ -17,8 +23,30 @@ public:
     static void setDifficulty(int val);
     static int  getDifficulty();
     using FoundMoveCallback = void(*)(FullMove m);
+    // Gets called from the search thread, every time the hints get refined
+    using HintsUpdatedCallback = void(*)();
+
+    // How many candidate moves we show as hints
+    constexpr static int HintCount = 3;
+    // The hint search stops by itself after this depth
+    constexpr static int HintMaxDepth = 16;
+
+    // Up to this difficulty the bot doesn't search, see playWeakMove
+    constexpr static int WeakMaxDifficulty = stockfish::Weak::Levels - 1;
+
+    // From this difficulty up the bot plays on a clock instead of a fixed
+    // depth, so it can spend its time where it matters
+    constexpr static int TimedMinDifficulty = 9;
+    constexpr static stockfish::TimePoint DefaultGameTimeMs = 3 * 60 * 1000;
+    constexpr static stockfish::TimePoint DefaultIncrementMs = 2000;
+
+    // The bot's time for the whole game, and what it gains after each move.
+    // Takes effect on the next game.
+    static void setTimeBudget(stockfish::TimePoint gameTimeMs,
+                              stockfish::TimePoint incrementMs);
 
     Bot(FoundMoveCallback callback,
+        HintsUpdatedCallback hintsCallback = nullptr,
         int depth = 0, int64_t nodes = 0,
         std::chrono::milliseconds::rep timeMs = 200);
     ~Bot() noexcept;
@@ -27,6 +55,22 @@ public:
     void reset();
     void stop();
 
+    // Starts a MultiPV search on the player's position. The transposition
+    // table is kept from the bot's searches, so the first lines come from
+    // the bot's own predictions.
+    void startHints(const BoardState& state);
+    void stopHints();
+
+    // Best move first
+    std::vector<FullMove> getHints() const;
+
+    // While the player holds a piece, the idle engine threads search the
+    // positions after each of its moves, with the bot's own limits. If the
+    // player then makes one of those moves, the bot replies right away.
+    void startSpeculation(const BoardState& state,
+                          const std::vector<FullMove>& candidates);
+    void stopSpeculation();
+
 private:
     stockfish::Position pos;
     stockfish::StateListPtr states;
@@ -34,6 +78,61 @@ private:
 
     stockfish::Move toStockfishMove(const FullMove& m);
     FoundMoveCallback foundMoveCallback;
+    HintsUpdatedCallback hintsUpdatedCallback;
+
+    // What the running search is for, decides what onBestMoveFound does.
+    // Set by the UI and speculation threads, read on the search thread.
+    enum class SearchMode {
+        Play,
+        Hints,
+        Speculation,
+    };
+    std::atomic<SearchMode> mode = SearchMode::Play;
+
+    mutable std::mutex hintsMutex;
+    std::vector<FullMove> hints;
+
+    void setHints(std::vector<FullMove>&& val);
+
+    // Runs the speculative searches one after the other
+    std::thread speculationThread;
+    std::atomic_bool speculationStopped;
+    // Written by onBestMoveFound in Speculation mode
+    std::atomic<stockfish::Move> speculativeBest;
+    struct SpeculativeResult {
+        stockfish::Move move;
+        // How long the search took, charged to the clock if it gets played
+        stockfish::TimePoint time;
+    };
+    // key: position after the player's move
+    // value: the bot's reply
+    std::map<stockfish::Key, SpeculativeResult> speculativeResults;
+
+    void speculate(std::string fen, std::vector<stockfish::Move> candidates);
+
+    static stockfish::TimePoint gameTime;
+    static stockfish::TimePoint increment;
+    // What's left of the bot's time budget in this game. Rescaled by
+    // setDifficulty on the UI thread, spent on the search thread.
+    mutable std::mutex clockMutex;
+    stockfish::TimePoint clock = 0;
+    stockfish::TimePoint thinkStart;
+    // Time of the speculative search that found the current reply
+    stockfish::TimePoint speculationTime = 0;
+
+    stockfish::PRNG rng;
+
+    bool isWeak() const;
+    // Picks a move with Weak::pick at the level's temperature and depth,
+    // with the better moves being more likely. Runs on the caller's thread.
+    void playWeakMove();
+
+    // A timed level's part of gameTime, in shares of MaxDifficulty's
+    static int clockShare(int difficulty);
+    bool usesClock() const;
+    // The limits for a search of pos
+    stockfish::Search::LimitsType searchLimits() const;
+    void onBotMoved();
 
     // Must be static, getDifficulty might get called before this initializes
     static int difficulty;
@@ -41,7 +140,10 @@ private:
     void doMove(FullMove m);
 
     friend void ::stockfish::Search::onBestMoveFound(stockfish::Move move);
+    friend void ::stockfish::Search::onIterationFinished(
+            const stockfish::Search::RootMoves& rootMoves, size_t multiPV,
+            stockfish::Depth depth);
 
-    void think();
+    void think(const stockfish::Search::LimitsType& searchLimits);
 };
 } // namespace chess
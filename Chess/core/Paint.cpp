@@ -1,5 +1,6 @@
 #include "Paint.h"
 
+#include <cmath>
 #include <cstring>
 
 namespace core {
@@ -227,6 +228,46 @@ void Paint::fillPixelatedCircle(Point c, int radius, Color col,
     }
 }
 
+void Paint::drawArrow(Point from, Point to, int thickness, Color col) {
+    Point d = to - from;
+    double length = std::sqrt(double(d.length2()));
+    if (length < 1) return;
+
+    // Unit vector along the arrow
+    double ux = d.x / length;
+    double uy = d.y / length;
+
+    double headLength = std::min(3.0 * thickness, length);
+    double headHalfWidth = 1.5 * thickness;
+    double shaftLength = length - headLength;
+    double shaftHalfWidth = thickness / 2.0;
+
+    int margin = 2 * thickness;
+    int xMin = std::max(0, std::min(from.x, to.x) - margin);
+    int yMin = std::max(0, std::min(from.y, to.y) - margin);
+    int xMax = std::min(width()-1, std::max(from.x, to.x) + margin);
+    int yMax = std::min(height()-1, std::max(from.y, to.y) + margin);
+
+    // The shaft and the head are drawn in the same pass, otherwise the
+    // pixels where they overlap would get blended twice
+    for (int y = yMin; y <= yMax; ++y) {
+        for (int x = xMin; x <= xMax; ++x) {
+            Point p = Point(x, y) - from;
+            double along = p.x * ux + p.y * uy;
+            double across = std::abs(p.y * ux - p.x * uy);
+
+            if (along < 0 || along > length)
+                continue;
+
+            bool inShaft = along <= shaftLength && across <= shaftHalfWidth;
+            bool inHead = along >= shaftLength &&
+                across <= headHalfWidth * (length - along) / headLength;
+            if (inShaft || inHead)
+                setPixelUnchecked(x, y, col);
+        }
+    }
+}
+
 void Paint::fillRect(int x0, int y0, int x1, int y1, Color col) {
     fillRect({x0, y0, x1, y1}, col);
 }
@@ -113,6 +113,9 @@ public:
     void fillPixelatedCircle(Point center, int radius, Color col,
                              int pixelSize);
 
+    // The head of the arrow ends at 'to'
+    void drawArrow(Point from, Point to, int thickness, Color col);
+
     void drawSprite(int x, int y,
                     const PaletteSprite& sprite,
                     const Palette& palette);
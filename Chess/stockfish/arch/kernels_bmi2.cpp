@@ -0,0 +1,57 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The kernels for CPUs with POPCNT, AVX2 and a fast PEXT (Intel Haswell, AMD
+// Zen 3 and later). See cpu.h.
+//
+// It must inline every function of the headers, so that it defines nothing
+// out of its namespace: tools/check_kernels.sh checks it after each build.
+// It still comes after the baseline objects on the link line.
+
+#if !defined(NO_CPU_DISPATCH) && defined(__x86_64__) && defined(__GNUC__)
+
+#define KERNELS_ONLY
+#define ISA_NAMESPACE isa_bmi2
+
+#ifndef USE_POPCNT
+#  define USE_POPCNT
+#endif
+#ifndef USE_AVX2
+#  define USE_AVX2
+#endif
+#ifndef USE_PEXT
+#  define USE_PEXT
+#endif
+
+#if defined(__clang__)
+#  pragma clang attribute push (__attribute__((target("popcnt,avx2,bmi2"))), apply_to = function)
+#elif defined(__GNUC__)
+#  pragma GCC target("popcnt,avx2,bmi2")
+#endif
+
+#include "../movegen.cpp"
+#include "../evaluate.cpp"
+#include "../nnue/evaluate_nnue.cpp"
+
+#if defined(__clang__)
+#  pragma clang attribute pop
+#endif
+
+#endif
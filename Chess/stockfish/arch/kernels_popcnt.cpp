@@ -0,0 +1,56 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The kernels for CPUs with POPCNT and SSE 4.1 (Intel Nehalem, AMD Bulldozer
+// and later). See cpu.h.
+//
+// It must inline every function of the headers, so that it defines nothing
+// out of its namespace: tools/check_kernels.sh checks it after each build.
+// It still comes after the baseline objects on the link line.
+
+#if !defined(NO_CPU_DISPATCH) && defined(__x86_64__) && defined(__GNUC__)
+
+#define KERNELS_ONLY
+#define ISA_NAMESPACE isa_popcnt
+
+#undef USE_AVX2
+#undef USE_PEXT
+#ifndef USE_POPCNT
+#  define USE_POPCNT
+#endif
+#ifndef USE_SSE41
+#  define USE_SSE41
+#endif
+
+#if defined(__clang__)
+#  pragma clang attribute push (__attribute__((target("popcnt,sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#  pragma GCC target("popcnt,sse4.1")
+#endif
+
+#include "../movegen.cpp"
+#include "../evaluate.cpp"
+#include "../nnue/evaluate_nnue.cpp"
+
+#if defined(__clang__)
+#  pragma clang attribute pop
+#endif
+
+#endif
@@ -19,6 +19,7 @@
 */
 
 #include <cassert>
+#include <mutex>
 #include <vector>
 #include <bitset>
 
@@ -32,6 +33,7 @@ namespace stockfish {
   constexpr unsigned MAX_INDEX = 2*24*64*64; // stm * psq * wksq * bksq = 196608
 
   std::bitset<MAX_INDEX> KPKBitbase;
+  std::once_flag KPKBuilt;
 
   // A KPK bitbase index is an integer in [0, IndexMax] range
   //
@@ -68,33 +70,51 @@ namespace stockfish {
 
 
 
+  // build() computes the KPK bitbase by retrograde analysis
+
+  void build() {
+
+    std::vector<KPKPosition> db(MAX_INDEX);
+    unsigned idx, repeat = 1;
+
+    // Initialize db with known win / draw positions
+    for (idx = 0; idx < MAX_INDEX; ++idx)
+        db[idx] = KPKPosition(idx);
+
+    // Iterate through the positions until none of the unknown positions can be
+    // changed to either wins or draws (15 cycles needed).
+    while (repeat)
+        for (repeat = idx = 0; idx < MAX_INDEX; ++idx)
+            repeat |= (db[idx] == UNKNOWN && db[idx].classify(db) != UNKNOWN);
+
+    // Fill the bitbase with the decisive results
+    for (idx = 0; idx < MAX_INDEX; ++idx)
+        if (db[idx] == WIN)
+            KPKBitbase.set(idx);
+  }
+
+
+/// Bitbases::probe() looks up the KPK bitbase, which the first probe builds
+/// unless init() already did.
+
 bool Bitbases::probe(Square wksq, Square wpsq, Square bksq, Color stm) {
 
   assert(file_of(wpsq) <= FILE_D);
 
+  init();
+
   return KPKBitbase[index(stm, bksq, wksq, wpsq)];
 }
 
 
-void Bitbases::init() {
+/// Bitbases::init() builds the KPK bitbase, at most once. The bitbase takes
+/// some milliseconds to compute and is rarely needed, so it isn't built at
+/// startup but when it is first probed. The thread that does it blocks the
+/// others probing meanwhile.
 
-  std::vector<KPKPosition> db(MAX_INDEX);
-  unsigned idx, repeat = 1;
-
-  // Initialize db with known win / draw positions
-  for (idx = 0; idx < MAX_INDEX; ++idx)
-      db[idx] = KPKPosition(idx);
-
-  // Iterate through the positions until none of the unknown positions can be
-  // changed to either wins or draws (15 cycles needed).
-  while (repeat)
-      for (repeat = idx = 0; idx < MAX_INDEX; ++idx)
-          repeat |= (db[idx] == UNKNOWN && db[idx].classify(db) != UNKNOWN);
+void Bitbases::init() {
 
-  // Fill the bitbase with the decisive results
-  for (idx = 0; idx < MAX_INDEX; ++idx)
-      if (db[idx] == WIN)
-          KPKBitbase.set(idx);
+  std::call_once(KPKBuilt, build);
 }
 
 
@@ -82,19 +82,19 @@ extern Bitboard PseudoAttacks[PIECE_TYPE_NB][SQUARE_NB];
 extern Bitboard PawnAttacks[COLOR_NB][SQUARE_NB];
 
 
-/// Magic holds all magic bitboards relevant data for a single square
+/// Magic holds all magic bitboards relevant data for a single square. The
+/// kernels with pext look up pextAttacks instead, filled only when the CPU
+/// has it.
 struct Magic {
   Bitboard  mask;
   Bitboard  magic;
   Bitboard* attacks;
+  Bitboard* pextAttacks;
   unsigned  shift;
 
   // Compute the attack's index using the 'magic bitboards' approach
   unsigned index(Bitboard occupied) const {
 
-    if (HasPext)
-        return unsigned(pext(occupied, mask));
-
     if (Is64Bit)
         return unsigned(((occupied & mask) * magic) >> shift);
 
@@ -260,6 +260,12 @@ template<> inline int distance<Square>(Square x, Square y) { return SquareDistan
 inline File edge_distance(File f) { return std::min(f, File(FILE_H - f)); }
 inline Rank edge_distance(Rank r) { return std::min(r, Rank(RANK_8 - r)); }
 
+/// attacks_bb() and popcount() depend on the instruction set, so they are in
+/// the namespace of the kernels that include them. Code out of the kernels
+/// gets the baseline ones.
+
+namespace ISA_NAMESPACE {
+
 /// attacks_bb() returns a bitboard representing all the squares attacked by a
 /// piece of type Pt (bishop or rook) placed on 's'.
 
@@ -267,7 +273,8 @@ template<PieceType Pt>
 inline Bitboard attacks_bb(Square s, Bitboard occupied) {
 
   const Magic& m = Pt == ROOK ? RookMagics[s] : BishopMagics[s];
-  return m.attacks[m.index(occupied)];
+  return HasPext ? m.pextAttacks[pext(occupied, m.mask)]
+                 : m.attacks[m.index(occupied)];
 }
 
 inline Bitboard attacks_bb(PieceType pt, Square s, Bitboard occupied) {
@@ -304,6 +311,11 @@ inline int popcount(Bitboard b) {
 #endif
 }
 
+} // namespace ISA_NAMESPACE
+
+using ISA_NAMESPACE::attacks_bb;
+using ISA_NAMESPACE::popcount;
+
 
 /// lsb() and msb() return the least/most significant bit in a non-zero bitboard
 
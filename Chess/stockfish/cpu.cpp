@@ -0,0 +1,175 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "cpu.h"
+
+#ifdef USE_CPU_DISPATCH
+#  include <cpuid.h>
+#endif
+
+namespace stockfish {
+
+// The entry points of the kernels of a level, in its namespace
+#define DECLARE_KERNELS(isa)                                                  \
+  namespace isa {                                                             \
+    template<GenType> ExtMove* generate(const Position&, ExtMove*);           \
+    template<> ExtMove* generate<QUIET_CHECKS>(const Position&, ExtMove*);    \
+    template<> ExtMove* generate<EVASIONS>(const Position&, ExtMove*);        \
+    template<> ExtMove* generate<LEGAL>(const Position&, ExtMove*);           \
+  }                                                                           \
+  namespace Eval::isa {                                                       \
+    Value evaluate(const Position&);                                          \
+    Value time_steps(const Position&, StepTimes&);                            \
+  }                                                                           \
+  namespace Eval::NNUE::isa { Value evaluate(const Position&); }
+
+#define KERNELS(isa)                                                          \
+  { { isa::generate<CAPTURES>, isa::generate<QUIETS>,                         \
+      isa::generate<QUIET_CHECKS>, isa::generate<EVASIONS>,                   \
+      isa::generate<NON_EVASIONS>, isa::generate<LEGAL> },                    \
+    Eval::isa::evaluate, Eval::isa::time_steps, Eval::NNUE::isa::evaluate }
+
+DECLARE_KERNELS(isa_base)
+
+#ifdef USE_CPU_DISPATCH
+DECLARE_KERNELS(isa_popcnt)
+DECLARE_KERNELS(isa_avx2)
+DECLARE_KERNELS(isa_bmi2)
+#endif
+
+namespace {
+
+  const Cpu::Kernels LevelKernels[] = {
+      KERNELS(isa_base),
+#ifdef USE_CPU_DISPATCH
+      KERNELS(isa_popcnt),
+      KERNELS(isa_avx2),
+      KERNELS(isa_bmi2)
+#endif
+  };
+
+  constexpr int CompiledLevels = sizeof(LevelKernels) / sizeof(LevelKernels[0]);
+
+#ifdef USE_CPU_DISPATCH
+
+  // cpuid() reads a leaf of the CPU features, as eax, ebx, ecx and edx
+
+  void cpuid(unsigned leaf, unsigned r[4]) {
+
+    __cpuid_count(leaf, 0, r[0], r[1], r[2], r[3]);
+  }
+
+  // xgetbv() reads XCR0, the register states the OS saves on context switches
+
+  uint64_t xgetbv() {
+
+    uint32_t lo, hi;
+    __asm__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+    return uint64_t(hi) << 32 | lo;
+  }
+
+  // detect() returns the best level the CPU supports. AVX2 also needs the OS
+  // to save the YMM registers. PEXT is microcoded on AMD before Zen 3, and
+  // much slower than magics there, so those CPUs stay at AVX2.
+
+  Cpu::Level detect() {
+
+    unsigned r[4];
+    char vendor[13] = {};
+
+    cpuid(0, r);
+    unsigned maxLeaf = r[0];
+    std::memcpy(vendor, &r[1], 4);
+    std::memcpy(vendor + 4, &r[3], 4);
+    std::memcpy(vendor + 8, &r[2], 4);
+
+    cpuid(1, r);
+    unsigned family = ((r[0] >> 8) & 0xF) + ((r[0] >> 20) & 0xFF);
+    bool popcnt = r[2] & (1 << 23);
+    bool sse41  = r[2] & (1 << 19);
+    bool avx    =    (r[2] & (1 << 27)) // OSXSAVE
+                  && (r[2] & (1 << 28))
+                  && (xgetbv() & 6) == 6;
+
+    r[1] = 0;
+    if (maxLeaf >= 7)
+        cpuid(7, r);
+
+    bool avx2 = avx && (r[1] & (1 << 5));
+    bool fastPext =    (r[1] & (1 << 8))
+                    && !(!std::strcmp(vendor, "AuthenticAMD") && family < 0x19);
+
+    return !popcnt || !sse41 ? Cpu::GENERIC
+          : !avx2            ? Cpu::POPCNT
+          : !fastPext        ? Cpu::AVX2
+                             : Cpu::BMI2;
+  }
+
+#else
+
+  Cpu::Level detect() { return Cpu::GENERIC; }
+
+#endif
+
+} // namespace
+
+namespace Cpu {
+
+const Kernels* kernels = &LevelKernels[detected()];
+
+
+/// detected() returns the best level the CPU supports, among the compiled ones
+
+Level detected() {
+
+  static Level l = std::min(detect(), Level(CompiledLevels - 1));
+  return l;
+}
+
+
+/// level() returns the level of the kernels in use
+
+Level level() {
+  return Level(kernels - LevelKernels);
+}
+
+
+/// set() selects the kernels of level l, or of the best level the CPU supports
+/// if it's lower. Not while searching.
+
+void set(Level l) {
+  kernels = &LevelKernels[std::min(l, detected())];
+}
+
+
+/// name() is the name of level l, as in the "CPU Kernels" option
+
+const char* name(Level l) {
+
+  constexpr const char* Names[] = { "Generic", "POPCNT", "AVX2", "BMI2" };
+  return Names[l];
+}
+
+} // namespace Cpu
+
+} // namespace stockfish
@@ -0,0 +1,78 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CPU_H_INCLUDED
+#define CPU_H_INCLUDED
+
+#include "movegen.h"
+#include "types.h"
+
+namespace stockfish {
+
+class Position;
+
+namespace Eval { struct StepTimes; }
+
+/// Cpu selects at startup the kernels to run, among those compiled for several
+/// instruction set levels: the best level the CPU supports. The kernels are the
+/// hot code that depends on the instruction set: the move generators, and the
+/// classical and NNUE evaluations, with the slider attacks and the popcounts
+/// they inline. movegen.cpp, evaluate.cpp and nnue/evaluate_nnue.cpp compile
+/// them for the baseline of the build, in namespace isa_base, and the files in
+/// arch/ include them again with KERNELS_ONLY and the flags of each level, in
+/// a namespace of their own. The code out of the kernels stays at the baseline.
+///
+/// An arch/ object must define nothing out of its namespace: a header's inline
+/// function it doesn't inline would be shared with the baseline objects, and
+/// the linker could keep the copy with the level's instructions for every CPU.
+/// The Makefile compiles them optimized, checks their symbols and those of the
+/// programs with tools/check_kernels.sh, and rejects -flto. Compilers without
+/// such a check (MSVC) build the baseline only.
+
+namespace Cpu {
+
+enum Level {
+  GENERIC, // The baseline of the build
+  POPCNT,  // POPCNT and SSE 4.1
+  AVX2,    // POPCNT and AVX2
+  BMI2,    // POPCNT, AVX2 and a fast PEXT
+  LEVEL_NB
+};
+
+/// Kernels are the entry points of the kernels of a level
+struct Kernels {
+  ExtMove* (*generate[LEGAL + 1])(const Position&, ExtMove*);
+  Value (*evaluate)(const Position&);
+  Value (*time_steps)(const Position&, Eval::StepTimes&);
+  Value (*evaluate_nnue)(const Position&);
+};
+
+extern const Kernels* kernels; // The ones in use
+
+Level detected();
+Level level();
+void set(Level l);
+const char* name(Level l);
+
+} // namespace Cpu
+
+} // namespace stockfish
+
+#endif // #ifndef CPU_H_INCLUDED
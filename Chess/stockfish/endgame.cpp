@@ -18,10 +18,13 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <cassert>
+#include <iterator>
 
 #include "bitboard.h"
 #include "endgame.h"
+#include "misc.h"
 #include "movegen.h"
 
 namespace stockfish {
@@ -64,10 +67,43 @@ namespace stockfish {
 
 namespace Endgames {
 
-  std::pair<Map<Value>, Map<ScaleFactor>> maps;
+  Slot Table[1 << TableBits];
+  Key Multiplier;
+
+  namespace {
+
+    Slot Slots[32]; // The configurations, before they get their place in Table
+    int SlotCount;
+
+    // add() sets up the functions of endgame E for the material of code, for
+    // each strong side
+
+    template<EndgameCode E, typename T = eg_type<E>>
+    void add(const char* code) {
+
+      static const Endgame<E> functions[] = { Endgame<E>(WHITE), Endgame<E>(BLACK) };
+
+      for (Color c : { WHITE, BLACK })
+      {
+          StateInfo st;
+          Slot& s = Slots[SlotCount++];
+
+          assert(SlotCount <= int(sizeof(Slots) / sizeof(Slot)));
+
+          s = { Position().set(code, c, &st).material_key(), code, c, nullptr, nullptr };
+
+          if constexpr (std::is_same<T, Value>::value)
+              s.evaluation = &functions[c];
+          else
+              s.scaling = &functions[c];
+      }
+    }
+  }
 
   void init() {
 
+    SlotCount = 0;
+
     add<KPK>("KPK");
     add<KNNK>("KNNK");
     add<KBNK>("KBNK");
@@ -84,6 +120,25 @@ namespace Endgames {
     add<KBPKN>("KBPKN");
     add<KBPPKB>("KBPPKB");
     add<KRPPKRP>("KRPPKRP");
+
+    // Try multipliers, odd ones from a fixed seed, until no two keys share a
+    // slot. With a table 4 times bigger than the number of keys, it takes
+    // about 30 tries on average.
+    PRNG rng(1070372);
+    bool collision;
+
+    do {
+        Multiplier = rng.rand<Key>() | 1;
+        std::fill(std::begin(Table), std::end(Table), Slot());
+        collision = false;
+
+        for (int i = 0; i < SlotCount && !collision; ++i)
+        {
+            Slot& s = Table[index(Slots[i].key)];
+            collision = s.key != 0;
+            s = Slots[i];
+        }
+    } while (collision);
   }
 }
 
@@ -21,11 +21,7 @@
 #ifndef ENDGAME_H_INCLUDED
 #define ENDGAME_H_INCLUDED
 
-#include <memory>
-#include <string>
 #include <type_traits>
-#include <unordered_map>
-#include <utility>
 
 #include "position.h"
 #include "types.h"
@@ -90,36 +86,46 @@ struct Endgame : public EndgameBase<T> {
 };
 
 
-/// The Endgames namespace handles the pointers to endgame evaluation and scaling
-/// base objects in two std::map. We use polymorphism to invoke the actual
-/// endgame function by calling its virtual operator().
+/// The Endgames namespace holds the endgame evaluation and scaling functions
+/// of the material configurations that have one, for each strong side, in a
+/// table indexed by a perfect hash of the material key: init() picks the
+/// multiplier so that each of these keys gets a slot of its own. A lookup is
+/// then a multiplication, a shift and a comparison of the key. We use
+/// polymorphism to invoke the actual endgame function by calling its virtual
+/// operator().
 
 namespace Endgames {
 
-  template<typename T> using Ptr = std::unique_ptr<EndgameBase<T>>;
-  template<typename T> using Map = std::unordered_map<Key, Ptr<T>>;
+  constexpr int TableBits = 7;
 
-  extern std::pair<Map<Value>, Map<ScaleFactor>> maps;
+  struct Slot {
+    Key key;
+    const char* code;      // The material, like "KRPKR", with strongSide as white
+    Color strongSide;
+    const EndgameBase<Value>* evaluation;
+    const EndgameBase<ScaleFactor>* scaling;
+  };
 
-  void init();
-
-  template<typename T>
-  Map<T>& map() {
-    return std::get<std::is_same<T, ScaleFactor>::value>(maps);
-  }
+  extern Slot Table[1 << TableBits];
+  extern Key Multiplier;
 
-  template<EndgameCode E, typename T = eg_type<E>>
-  void add(const std::string& code) {
+  void init();
 
-    StateInfo st;
-    map<T>()[Position().set(code, WHITE, &st).material_key()] = Ptr<T>(new Endgame<E>(WHITE));
-    map<T>()[Position().set(code, BLACK, &st).material_key()] = Ptr<T>(new Endgame<E>(BLACK));
+  inline unsigned index(Key key) {
+    return unsigned((key * Multiplier) >> (64 - TableBits));
   }
 
   template<typename T>
   const EndgameBase<T>* probe(Key key) {
-    auto it = map<T>().find(key);
-    return it != map<T>().end() ? it->second.get() : nullptr;
+    const Slot& s = Table[index(key)];
+    const EndgameBase<T>* f;
+
+    if constexpr (std::is_same<T, Value>::value)
+        f = s.evaluation;
+    else
+        f = s.scaling;
+
+    return s.key == key ? f : nullptr;
   }
 }
 
@@ -22,18 +22,32 @@
 #include <cassert>
 #include <cstring>   // For std::memset
 #include <iomanip>
+#include <iostream>
 #include <sstream>
 
+#if defined(USE_AVX2) && defined(USE_SIMD_ATTACKS)
+#  include <immintrin.h>
+#  define VECTOR_ATTACKS
+#endif
+
 #include "bitboard.h"
+#include "cpu.h"
 #include "evaluate.h"
 #include "material.h"
 #include "pawns.h"
 #include "thread.h"
+#include "uci.h"
 
 namespace stockfish {
+
+// Everything up to the kernel entry point has internal linkage, so that each
+// instruction set level compiles its own, see cpu.h
+
+namespace {
+
 namespace Trace {
 
-  enum Tracing { NO_TRACE, TRACE };
+  enum Tracing { NO_TRACE, TRACE, TIMING };
 
   enum Term { // The first 8 entries are reserved for PieceType
     MATERIAL = 8, IMBALANCE, MOBILITY, THREAT, PASSED, SPACE, INITIATIVE, TOTAL, TERM_NB
@@ -41,8 +55,6 @@ namespace Trace {
 
   Score scores[TERM_NB][COLOR_NB];
 
-  double to_cp(Value v) { return double(v) / PawnValueEg; }
-
   void add(int idx, Color c, Score s) {
     scores[idx][c] = s;
   }
@@ -52,6 +64,10 @@ namespace Trace {
     scores[idx][BLACK] = b;
   }
 
+#ifndef KERNELS_ONLY // Only trace() prints
+
+  double to_cp(Value v) { return double(v) / PawnValueEg; }
+
   std::ostream& operator<<(std::ostream& os, Score s) {
     os << std::setw(5) << to_cp(mg_value(s)) << " "
        << std::setw(5) << to_cp(eg_value(s));
@@ -68,6 +84,8 @@ namespace Trace {
     os << " | " << scores[t][WHITE] - scores[t][BLACK] << "\n";
     return os;
   }
+
+#endif
 }
 
 using namespace Trace;
@@ -149,18 +167,186 @@ using namespace Trace;
 
 #undef S
 
+#ifdef VECTOR_ATTACKS
+
+  // PieceAttacks are the knights, bishops, rooks and queens of a color, in this
+  // order, with the attacks, the mobility and the attacks next to the enemy
+  // king that piece_attacks() finds for all of them at once. The occupancy of
+  // each piece type lets bishops and rooks x-ray, and when some of the pieces
+  // are pinned the line restricts them: piece i of type pt then attacks
+  // attacks_bb(pt, s, occupied[pt]) & line[i].
+
+  constexpr int MaxPieces = 16; // 15 at most, rounded up to whole vectors
+
+  struct PieceAttacks {
+    int first[KING + 1]; // Index of the first piece of each type, first[KING] is the count
+    Square square[MaxPieces];
+    Bitboard occupied[KING];
+    Bitboard line[MaxPieces]; // Only set when pinned
+    bool pinned;
+    alignas(32) Bitboard attacks[MaxPieces];
+    int mobility[MaxPieces];
+    int kingAttacks[MaxPieces];
+  };
+
+  // With AVX2 a vector holds the bitboards of four pieces, and the sliders get
+  // their attacks from Kogge-Stone fills of the eight directions, without the
+  // tables. lane_shift() moves each lane by D, positive towards the 8th rank.
+
+  template<int D>
+  inline __m256i lane_shift(__m256i b) {
+    if constexpr (D > 0)
+        return _mm256_slli_epi64(b, D);
+    else
+        return _mm256_srli_epi64(b, -D);
+  }
+
+  // fill() returns the attacks in direction D of the sliders in gen, stopped by
+  // the first occupied square. NotWrap masks the squares of the file that a
+  // step in direction D would wrap to.
+
+  template<int D, Bitboard NotWrap>
+  inline __m256i fill(__m256i gen, __m256i empty) {
+
+    const __m256i notWrap = _mm256_set1_epi64x(int64_t(NotWrap));
+    __m256i pro = _mm256_and_si256(empty, notWrap);
+
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, lane_shift<D>(gen)));
+    pro = _mm256_and_si256(pro, lane_shift<D>(pro));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, lane_shift<2 * D>(gen)));
+    pro = _mm256_and_si256(pro, lane_shift<2 * D>(pro));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, lane_shift<4 * D>(gen)));
+
+    return _mm256_and_si256(lane_shift<D>(gen), notWrap);
+  }
+
+  // popcount4() counts the bits of each lane, with nibble lookups
+
+  inline __m256i popcount4(__m256i b) {
+
+    const __m256i counts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    __m256i lo = _mm256_shuffle_epi8(counts, _mm256_and_si256(b, nibble));
+    __m256i hi = _mm256_shuffle_epi8(counts, _mm256_and_si256(_mm256_srli_epi16(b, 4), nibble));
+    return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+  }
+
+  // piece_attacks() builds the vectors in registers rather than loading them
+  // from the arrays that attacks() has just written, which would stall on store
+  // forwarding. Lanes past the last piece have no generator, so no attacks.
+
+  void piece_attacks(PieceAttacks& pa, Bitboard mobilityArea, Bitboard kingZone) {
+
+    constexpr Bitboard NotA = ~FileABB, NotH = ~FileHBB;
+    constexpr Bitboard NotAB = ~(FileABB | FileBBB), NotGH = ~(FileGBB | FileHBB);
+
+    alignas(32) int64_t mobility[4], kingAttacks[4];
+
+    const int n = pa.first[KING];
+    const __m256i area = _mm256_set1_epi64x(int64_t(mobilityArea));
+    const __m256i zone = _mm256_set1_epi64x(int64_t(kingZone));
+    const __m256i firstBishop = _mm256_set1_epi64x(pa.first[BISHOP]);
+    const __m256i firstRook   = _mm256_set1_epi64x(pa.first[ROOK]);
+    const __m256i firstQueen  = _mm256_set1_epi64x(pa.first[QUEEN]);
+    const __m256i count       = _mm256_set1_epi64x(n);
+
+    for (int i = n; i < (n + 3) / 4 * 4; ++i)
+        pa.square[i] = SQ_A1, pa.line[i] = AllSquares;
+
+    for (int i = 0; i < n; i += 4)
+    {
+        // Masks of the lanes of each piece type
+        __m256i idx = _mm256_add_epi64(_mm256_set1_epi64x(i), _mm256_setr_epi64x(0, 1, 2, 3));
+        __m256i isKnight = _mm256_cmpgt_epi64(firstBishop, idx);
+        __m256i isMinor  = _mm256_cmpgt_epi64(firstRook, idx);
+        __m256i isQueen  = _mm256_andnot_si256(_mm256_cmpgt_epi64(firstQueen, idx),
+                                               _mm256_cmpgt_epi64(count, idx));
+        __m256i isBishop = _mm256_andnot_si256(isKnight, isMinor);
+        __m256i isRook   = _mm256_andnot_si256(isMinor, _mm256_cmpgt_epi64(firstQueen, idx));
+
+        __m256i sq = _mm256_setr_epi64x(int64_t(square_bb(pa.square[i])),
+                                        int64_t(square_bb(pa.square[i + 1])),
+                                        int64_t(square_bb(pa.square[i + 2])),
+                                        int64_t(square_bb(pa.square[i + 3])));
+
+        __m256i occupied = _mm256_or_si256(
+            _mm256_or_si256(_mm256_and_si256(isBishop, _mm256_set1_epi64x(int64_t(pa.occupied[BISHOP]))),
+                            _mm256_and_si256(isRook,   _mm256_set1_epi64x(int64_t(pa.occupied[ROOK])))),
+            _mm256_andnot_si256(_mm256_or_si256(isBishop, isRook),
+                                _mm256_set1_epi64x(int64_t(pa.occupied[KNIGHT]))));
+        __m256i empty = _mm256_xor_si256(occupied, _mm256_set1_epi64x(-1));
+
+        __m256i b = _mm256_setzero_si256();
+        __m256i g = _mm256_and_si256(sq, isKnight);
+
+        if (!_mm256_testz_si256(g, g))
+        {
+            __m256i l1 = _mm256_and_si256(lane_shift<-1>(g), _mm256_set1_epi64x(int64_t(NotH)));
+            __m256i l2 = _mm256_and_si256(lane_shift<-2>(g), _mm256_set1_epi64x(int64_t(NotGH)));
+            __m256i r1 = _mm256_and_si256(lane_shift< 1>(g), _mm256_set1_epi64x(int64_t(NotA)));
+            __m256i r2 = _mm256_and_si256(lane_shift< 2>(g), _mm256_set1_epi64x(int64_t(NotAB)));
+            __m256i h1 = _mm256_or_si256(l1, r1), h2 = _mm256_or_si256(l2, r2);
+
+            b = _mm256_or_si256(_mm256_or_si256(lane_shift<16>(h1), lane_shift<-16>(h1)),
+                                _mm256_or_si256(lane_shift< 8>(h2), lane_shift< -8>(h2)));
+        }
+
+        g = _mm256_and_si256(sq, _mm256_or_si256(isBishop, isQueen));
+
+        if (!_mm256_testz_si256(g, g))
+            b = _mm256_or_si256(b, _mm256_or_si256(
+                    _mm256_or_si256(fill< 9, NotA>(g, empty), fill< 7, NotH>(g, empty)),
+                    _mm256_or_si256(fill<-7, NotA>(g, empty), fill<-9, NotH>(g, empty))));
+
+        g = _mm256_and_si256(sq, _mm256_or_si256(isRook, isQueen));
+
+        if (!_mm256_testz_si256(g, g))
+            b = _mm256_or_si256(b, _mm256_or_si256(
+                    _mm256_or_si256(fill< 8, AllSquares>(g, empty), fill<-8, AllSquares>(g, empty)),
+                    _mm256_or_si256(fill< 1, NotA>(g, empty), fill<-1, NotH>(g, empty))));
+
+        if (pa.pinned)
+            b = _mm256_and_si256(b, _mm256_setr_epi64x(int64_t(pa.line[i]),     int64_t(pa.line[i + 1]),
+                                                       int64_t(pa.line[i + 2]), int64_t(pa.line[i + 3])));
+
+        _mm256_store_si256((__m256i*)&pa.attacks[i], b);
+        _mm256_store_si256((__m256i*)mobility, popcount4(_mm256_and_si256(b, area)));
+        _mm256_store_si256((__m256i*)kingAttacks, popcount4(_mm256_and_si256(b, zone)));
+
+        for (int j = 0; j < 4; ++j)
+        {
+            pa.mobility[i + j] = int(mobility[j]);
+            pa.kingAttacks[i + j] = int(kingAttacks[j]);
+        }
+    }
+
+#ifndef NDEBUG
+    for (PieceType pt = KNIGHT; pt <= QUEEN; ++pt)
+        for (int i = pa.first[pt]; i < pa.first[pt + 1]; ++i)
+            assert(pa.attacks[i] == (attacks_bb(pt, pa.square[i], pa.occupied[pt])
+                                     & (pa.pinned ? pa.line[i] : AllSquares)));
+#endif
+  }
+
+#endif // VECTOR_ATTACKS
+
   // Evaluation class computes and stores attacks tables and other working data
   template<Tracing T>
   class Evaluation {
 
   public:
     Evaluation() = delete;
-    explicit Evaluation(const Position& p) : pos(p) {}
+    explicit Evaluation(const Position& p, Eval::StepTimes* t = nullptr) : pos(p), times(t) {}
     Evaluation& operator=(const Evaluation&) = delete;
     Value value();
 
   private:
     template<Color Us> void initialize();
+#ifdef VECTOR_ATTACKS
+    template<Color Us> void attacks();
+#endif
     template<Color Us, PieceType Pt> Score pieces();
     template<Color Us> Score king() const;
     template<Color Us> Score threats() const;
@@ -170,10 +356,14 @@ using namespace Trace;
     Score initiative(Score score) const;
 
     const Position& pos;
+    Eval::StepTimes* times;
     Material::Entry* me;
     Pawns::Entry* pe;
     Bitboard mobilityArea[COLOR_NB];
     Score mobility[COLOR_NB] = { SCORE_ZERO, SCORE_ZERO };
+#ifdef VECTOR_ATTACKS
+    PieceAttacks pieceAttacks[COLOR_NB];
+#endif
 
     // attackedBy[color][piece type] is a bitboard representing all squares
     // attacked by a given color and piece type. Special "piece types" which
@@ -247,6 +437,74 @@ using namespace Trace;
   }
 
 
+#ifdef VECTOR_ATTACKS
+
+  // Evaluation::attacks() finds the attacks of all the knights, bishops, rooks
+  // and queens of a given color at once, including x-ray attacks for bishops
+  // and rooks, and adds them to the attack tables, the king attackers and the
+  // mobility, as pieces() does one piece at a time otherwise. The pieces are in
+  // the order of the piece lists, so that pieces() finds them in its own.
+  template<Tracing T> template<Color Us>
+  void Evaluation<T>::attacks() {
+
+    constexpr Color Them = ~Us;
+
+    PieceAttacks& pa = pieceAttacks[Us];
+    PieceType pt = KNIGHT;
+    int n = 0;
+
+    pa.occupied[KNIGHT] = pa.occupied[QUEEN] = pos.pieces();
+    pa.occupied[BISHOP] = pos.pieces() ^ pos.pieces(QUEEN);
+    pa.occupied[ROOK]   = pos.pieces() ^ pos.pieces(QUEEN) ^ pos.pieces(Us, ROOK);
+    pa.pinned = pos.blockers_for_king(Us) & pos.pieces(Us) & ~pos.pieces(PAWN, KING);
+
+    for (const Square* pl : { pos.squares<KNIGHT>(Us), pos.squares<BISHOP>(Us),
+                              pos.squares<ROOK  >(Us), pos.squares<QUEEN >(Us) })
+    {
+        pa.first[pt] = n;
+        attackedBy[Us][pt] = 0;
+        ++pt;
+
+        for (Square s = *pl; s != SQ_NONE; s = *++pl)
+        {
+            assert(n < MaxPieces);
+
+            pa.square[n++] = s;
+        }
+    }
+
+    pa.first[KING] = n;
+
+    // Pinned pieces only attack along the line of the pin
+    if (pa.pinned)
+        for (int i = 0; i < n; ++i)
+            pa.line[i] = pos.blockers_for_king(Us) & pa.square[i] ? LineBB[pos.square<KING>(Us)][pa.square[i]]
+                                                                   : AllSquares;
+
+    piece_attacks(pa, mobilityArea[Us], attackedBy[Them][KING]);
+
+    for (pt = KNIGHT; pt <= QUEEN; ++pt)
+        for (int i = pa.first[pt]; i < pa.first[pt + 1]; ++i)
+        {
+            Bitboard b = pa.attacks[i];
+
+            attackedBy2[Us] |= attackedBy[Us][ALL_PIECES] & b;
+            attackedBy[Us][pt] |= b;
+            attackedBy[Us][ALL_PIECES] |= b;
+
+            if (b & kingRing[Them])
+            {
+                kingAttackersCount[Us]++;
+                kingAttackersWeight[Us] += KingAttackWeights[pt];
+                kingAttacksCount[Us] += pa.kingAttacks[i];
+            }
+
+            mobility[Us] += MobilityBonus[pt - 2][pa.mobility[i]];
+        }
+  }
+
+#endif // VECTOR_ATTACKS
+
   // Evaluation::pieces() scores pieces of a given color and type
   template<Tracing T> template<Color Us, PieceType Pt>
   Score Evaluation<T>::pieces() {
@@ -260,10 +518,22 @@ using namespace Trace;
     Bitboard b, bb;
     Score score = SCORE_ZERO;
 
+#ifdef VECTOR_ATTACKS
+    const PieceAttacks& pa = pieceAttacks[Us];
+    int i = pa.first[Pt];
+#else
     attackedBy[Us][Pt] = 0;
+#endif
 
     for (Square s = *pl; s != SQ_NONE; s = *++pl)
     {
+#ifdef VECTOR_ATTACKS
+        // attacks() did the attacks and mobility of all the pieces already
+        assert(pa.square[i] == s);
+
+        b = pa.attacks[i];
+        int mob = pa.mobility[i++];
+#else
         // Find attacked squares, including x-ray attacks for bishops and rooks
         b = Pt == BISHOP ? attacks_bb<BISHOP>(s, pos.pieces() ^ pos.pieces(QUEEN))
           : Pt ==   ROOK ? attacks_bb<  ROOK>(s, pos.pieces() ^ pos.pieces(QUEEN) ^ pos.pieces(Us, ROOK))
@@ -286,6 +556,7 @@ using namespace Trace;
         int mob = popcount(b & mobilityArea[Us]);
 
         mobility[Us] += MobilityBonus[Pt - 2][mob];
+#endif
 
         if (Pt == BISHOP || Pt == KNIGHT)
         {
@@ -360,7 +631,7 @@ using namespace Trace;
                 score -= WeakQueen;
         }
     }
-    if (T)
+    if (T == TRACE)
         Trace::add(Pt, Us, score);
 
     return score;
@@ -467,7 +738,7 @@ using namespace Trace;
     // Penalty if king flank is under attack, potentially moving toward the king
     score -= FlankAttacks * kingFlankAttack;
 
-    if (T)
+    if (T == TRACE)
         Trace::add(KING, Us, score);
 
     return score;
@@ -563,7 +834,7 @@ using namespace Trace;
         score += SliderOnQueen * popcount(b & safe & attackedBy2[Us]);
     }
 
-    if (T)
+    if (T == TRACE)
         Trace::add(THREAT, Us, score);
 
     return score;
@@ -640,7 +911,7 @@ using namespace Trace;
         score += bonus - PassedFile * edge_distance(file_of(s));
     }
 
-    if (T)
+    if (T == TRACE)
         Trace::add(PASSED, Us, score);
 
     return score;
@@ -680,7 +951,7 @@ using namespace Trace;
     int weight = pos.count<ALL_PIECES>(Us) - 1;
     Score score = make_score(bonus * weight * weight / 16, 0);
 
-    if (T)
+    if (T == TRACE)
         Trace::add(SPACE, Us, score);
 
     return score;
@@ -725,7 +996,7 @@ using namespace Trace;
     int u = ((mg > 0) - (mg < 0)) * std::max(std::min(complexity + 50, 0), -abs(mg));
     int v = ((eg > 0) - (eg < 0)) * std::max(complexity, -abs(eg));
 
-    if (T)
+    if (T == TRACE)
         Trace::add(INITIATIVE, make_score(u, v));
 
     return make_score(u, v);
@@ -765,6 +1036,18 @@ using namespace Trace;
 
     assert(!pos.checkers());
 
+    // When timing, lap() adds the ticks since the previous lap to a step
+    uint64_t start = T == TIMING ? timestamp() : 0;
+    auto lap = [&](Eval::Step step) {
+        if (T == TIMING)
+        {
+            uint64_t now = timestamp();
+            times->ticks[step] += now - start;
+            times->runs[step]++;
+            start = now;
+        }
+    };
+
     // Probe the material hash table
     me = Material::probe(pos);
 
@@ -781,6 +1064,7 @@ using namespace Trace;
     // Probe the pawn hash table
     pe = Pawns::probe(pos);
     score += pe->pawn_score(WHITE) - pe->pawn_score(BLACK);
+    lap(Eval::STEP_PROBES);
 
     // Early exit if score is high
     Value v = (mg_value(score) + eg_value(score)) / 2;
@@ -791,19 +1075,32 @@ using namespace Trace;
 
     initialize<WHITE>();
     initialize<BLACK>();
+    lap(Eval::STEP_INITIALIZE);
 
     // Pieces should be evaluated first (populate attack tables)
+#ifdef VECTOR_ATTACKS
+    attacks<WHITE>();
+    attacks<BLACK>();
+#endif
     score +=  pieces<WHITE, KNIGHT>() - pieces<BLACK, KNIGHT>()
             + pieces<WHITE, BISHOP>() - pieces<BLACK, BISHOP>()
             + pieces<WHITE, ROOK  >() - pieces<BLACK, ROOK  >()
             + pieces<WHITE, QUEEN >() - pieces<BLACK, QUEEN >();
 
     score += mobility[WHITE] - mobility[BLACK];
+    lap(Eval::STEP_PIECES);
+
+    score += king<WHITE>() - king<BLACK>();
+    lap(Eval::STEP_KING);
+
+    score += threats<WHITE>() - threats<BLACK>();
+    lap(Eval::STEP_THREATS);
+
+    score += passed<WHITE>() - passed<BLACK>();
+    lap(Eval::STEP_PASSED);
 
-    score +=  king<   WHITE>() - king<   BLACK>()
-            + threats<WHITE>() - threats<BLACK>()
-            + passed< WHITE>() - passed< BLACK>()
-            + space<  WHITE>() - space<  BLACK>();
+    score += space<WHITE>() - space<BLACK>();
+    lap(Eval::STEP_SPACE);
 
     score += initiative(score);
 
@@ -813,9 +1110,10 @@ using namespace Trace;
        + eg_value(score) * int(PHASE_MIDGAME - me->game_phase()) * sf / SCALE_FACTOR_NORMAL;
 
     v /= PHASE_MIDGAME;
+    lap(Eval::STEP_INITIATIVE);
 
     // In case of tracing add all remaining individual evaluation terms
-    if (T)
+    if (T == TRACE)
     {
         Trace::add(MATERIAL, pos.psq_score());
         Trace::add(IMBALANCE, me->imbalance());
@@ -827,13 +1125,120 @@ using namespace Trace;
     return  (pos.side_to_move() == WHITE ? v : -v) + Tempo; // Side to move point of view
   }
 
+} // namespace
+
+
+/// Eval::ISA_NAMESPACE::evaluate() is the classical evaluation of the kernels,
+/// and time_steps() the same with the time of each step added to 'times'
+
+namespace Eval::ISA_NAMESPACE {
+
+Value evaluate(const Position& pos) {
+  return Evaluation<NO_TRACE>(pos).value();
+}
+
+Value time_steps(const Position& pos, StepTimes& times) {
+  return Evaluation<TIMING>(pos, &times).value();
+}
+
+}
+
+#ifndef KERNELS_ONLY
+
+bool Eval::useNNUE = false;
+
+
+/// init_NNUE() loads the network of the "EvalFile" option when "Use NNUE" is
+/// set, unless it's the one loaded already. If that fails the classical
+/// evaluation stays in use, and the GUI is told why.
+
+void Eval::init_NNUE() {
+
+  static std::string loadedFile;
+
+  useNNUE = false;
+
+  if (!Options["Use NNUE"])
+      return;
+
+  std::string file = Options["EvalFile"];
+  std::string error;
+
+  if (file != loadedFile)
+  {
+      loadedFile.clear();
+
+      if (file == "<empty>")
+          error = "EvalFile is not set";
+
+      if (!error.empty() || !NNUE::load(file, error))
+      {
+          sync_cout << "info string ERROR: " << error
+                    << ", using the classical evaluation" << sync_endl;
+          return;
+      }
+
+      loadedFile = file;
+  }
+
+  useNNUE = true;
+  sync_cout << "info string NNUE evaluation using " << file
+            << " (" << NNUE::description() << ")" << sync_endl;
+}
 
 
 /// evaluate() is the evaluator for the outer world. It returns a static
-/// evaluation of the position from the point of view of the side to move.
+/// evaluation of the position from the point of view of the side to move,
+/// from the network when "Use NNUE" is set, else from the classical kernel of
+/// the instruction set in use. With an "Eval Hash" size, evaluations are
+/// cached in the thread's Eval::Cache. Besides the position they depend on the
+/// thread's contempt and on the rule 50 counter (through the scale factor), so
+/// both are mixed into the cache key.
 
 Value Eval::evaluate(const Position& pos) {
-  return Evaluation<NO_TRACE>(pos).value();
+
+  Thread* th = pos.this_thread();
+  CacheEntry* e = nullptr;
+  Key key = 0;
+
+  if (th->evalCache.size())
+  {
+      Key salt = (Key(uint32_t(th->contempt)) << 16) | unsigned(pos.rule50_count());
+      key = pos.key() ^ (salt * 0x9E3779B97F4A7C15ULL);
+      e = th->evalCache[key];
+
+      th->evalCache.probes++;
+
+      if (e->key32 == uint32_t(key >> 32))
+      {
+          th->evalCache.hits++;
+          return Value(e->value);
+      }
+  }
+
+  Value v = useNNUE ? Utility::clamp(NNUE::evaluate(pos) + Tempo, VALUE_TB_LOSS_IN_MAX_PLY + 1,
+                                                                VALUE_TB_WIN_IN_MAX_PLY - 1)
+                    : Cpu::kernels->evaluate(pos);
+
+  if (e)
+  {
+      e->key32 = uint32_t(key >> 32);
+      e->value = v;
+  }
+  return v;
+}
+
+
+/// time_steps() is the classical evaluation of the kernels in use, without
+/// the cache, adding the time of each of its steps to 'times'. The total of
+/// the steps includes the overhead of timing them.
+
+const char* const Eval::StepNames[STEP_NB] = {
+  "Probes", "Initialize", "Pieces", "King", "Threats", "Passed", "Space", "Initiative"
+};
+
+Value Eval::time_steps(const Position& pos, StepTimes& times) {
+  return Cpu::kernels->time_steps(pos, times);
 }
 
 
@@ -877,7 +1282,16 @@ std::string Eval::trace(const Position& pos) {
 
   ss << "\nTotal evaluation: " << to_cp(v) << " (white side)\n";
 
+  if (useNNUE)
+  {
+      v = NNUE::evaluate(pos) + Tempo;
+      v = pos.side_to_move() == WHITE ? v : -v;
+      ss << "NNUE evaluation : " << to_cp(v) << " (white side), used by the search\n";
+  }
+
   return ss.str();
 }
 
+#endif // KERNELS_ONLY
+
 } // namespace
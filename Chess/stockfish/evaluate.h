@@ -23,6 +23,7 @@
 
 #include <string>
 
+#include "misc.h"
 #include "types.h"
 
 namespace stockfish {
@@ -34,6 +35,50 @@ namespace Eval {
 std::string trace(const Position& pos);
 
 Value evaluate(const Position& pos);
+
+/// Step is a step of the classical evaluation, in the order it runs them, and
+/// StepTimes the time spent in each step and the number of runs of it, that
+/// time_steps() adds to while evaluating. Steps after an early exit don't run.
+
+enum Step {
+  STEP_PROBES, STEP_INITIALIZE, STEP_PIECES, STEP_KING, STEP_THREATS,
+  STEP_PASSED, STEP_SPACE, STEP_INITIATIVE, STEP_NB
+};
+
+extern const char* const StepNames[STEP_NB];
+
+struct StepTimes {
+  uint64_t ticks[STEP_NB]; // In timestamp() units
+  uint64_t runs[STEP_NB];
+};
+
+Value time_steps(const Position& pos, StepTimes& times);
+
+extern bool useNNUE;
+void init_NNUE();
+
+namespace NNUE {
+
+bool load(const std::string& path, std::string& error);
+std::string description();
+size_t memory();
+Value evaluate(const Position& pos);
+
+} // namespace NNUE
+
+/// CacheEntry is an entry of the per-thread evaluation cache: the upper 32 bits
+/// of the key, and the evaluation it got from the side to move's point of view.
+
+struct CacheEntry {
+  uint32_t key32;
+  int32_t value;
+};
+
+typedef HashTable<CacheEntry> Cache;
+
+/// Off by default: the TT already remembers most positions evaluated again,
+/// the cache hit on 0.23% of the probes of a depth 11 bench.
+constexpr int DefaultCacheKB = 0;
 }
 }
 #endif // #ifndef EVALUATE_H_INCLUDED
@@ -0,0 +1,494 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "mate.h"
+#include "movegen.h"
+#include "thread.h"
+#include "uci.h"
+
+namespace stockfish::Mate {
+
+namespace {
+
+  /// Proof and disproof numbers count the leaves still to be solved to prove
+  /// and to disprove a node. A proven node has pn 0 and dn Infinite, and a
+  /// disproven one the opposite. Sums saturate below Infinite, so that many
+  /// unsolved children never read as solved.
+
+  constexpr uint32_t Infinite = 0xFFFFFFFF;
+
+  uint32_t add(uint32_t a, uint32_t b) {
+    return a == Infinite || b == Infinite ? Infinite
+                                          : uint32_t(std::min(uint64_t(a) + b, uint64_t(Infinite - 1)));
+  }
+
+  /// Bounds are what is known of a node. The length of a proven node is the
+  /// number of plies to the mate along its proof.
+
+  struct Bounds {
+    uint32_t pn, dn;
+    int length;
+  };
+
+  constexpr Bounds Proven    = { 0, Infinite, 0 };
+  constexpr Bounds Disproven = { Infinite, 0, 0 };
+
+
+  /// Entry is a node of the table. As in the perft hash, the check field is
+  /// the key xor'ed with the other fields, so that an entry torn by another
+  /// thread doesn't verify and reads as a miss. Work is the number of nodes
+  /// spent on the node, the bigger subtrees are kept on collisions.
+
+  struct alignas(32) Entry {
+    Key check;
+    uint32_t pn, dn, work;
+    int32_t length;
+  };
+
+  static_assert(sizeof(Entry) == 32, "Two entries should fill a cache line");
+
+  Key checksum(Key key, const Entry& e) {
+    return key ^ (e.pn | Key(e.dn) << 32) ^ (e.work | Key(uint32_t(e.length)) << 32);
+  }
+
+  /// Table is the df-pn hash, separate from the TT. It's sized by the "Mate
+  /// Hash" option and cleared when a solve starts. The remaining depth is
+  /// mixed into the key: a node disproven to some depth may well be proven
+  /// deeper, so each depth has its own entries.
+
+  class Table {
+  public:
+    void resize(size_t mbSize) {
+      size_t size = 1;
+      while (size * 2 * sizeof(Cluster) <= mbSize * 1024 * 1024)
+          size *= 2;
+      if (size != clusters.size())
+          clusters = std::vector<Cluster>(size);
+      else
+          std::fill(clusters.begin(), clusters.end(), Cluster());
+    }
+
+    static Key key(const Position& pos, int depth) {
+      return pos.key() ^ (Key(depth) * 0x9E3779B97F4A7C15ULL);
+    }
+
+    bool probe(Key key, Bounds& b) const {
+      const Cluster& c = clusters[key & (clusters.size() - 1)];
+      for (const Entry& entry : c.entry)
+      {
+          Entry e = entry;
+          if (checksum(key, e) == e.check)
+          {
+              b = { e.pn, e.dn, e.length };
+              return true;
+          }
+      }
+      return false;
+    }
+
+    // An entry of the same key is overwritten, else the one of less work
+    void save(Key key, const Bounds& b, uint64_t work) {
+      Cluster& c = clusters[key & (clusters.size() - 1)];
+      Entry* replace = &c.entry[0];
+      for (Entry& entry : c.entry)
+      {
+          Entry e = entry;
+          if (checksum(key, e) == e.check)
+          {
+              replace = &entry;
+              break;
+          }
+          if (e.work < replace->work)
+              replace = &entry;
+      }
+
+      Entry e = { 0, b.pn, b.dn, uint32_t(std::min(work, uint64_t(Infinite))), b.length };
+      e.check = checksum(key, e);
+      *replace = e;
+    }
+
+  private:
+    struct Cluster {
+      Entry entry[2];
+    };
+
+    std::vector<Cluster> clusters;
+  };
+
+  Table MateTable;
+
+  // The threads solve the root to rootDepth plies, the first to solve it
+  // moves all of them to the next depth, or ends the solve by setting it
+  // past maxDepth. A mate to an odd number of plies is the shortest one,
+  // as the shallower depths were all disproven.
+  std::atomic<int> rootDepth;
+  std::atomic<int> provenDepth;
+  int maxDepth;
+  Result LastResult;
+
+
+  /// Child is a move of the node being solved, with the key of the node it
+  /// leads to and its bounds last known.
+
+  struct Child {
+    Move move;
+    Key key;
+    Bounds bounds;
+  };
+
+
+  /// Solver runs the df-pn search of one thread. Nodes to an odd depth are
+  /// OR nodes, where the attacker plays its checks, and the others are AND
+  /// nodes, where the defender answers them. Draws aren't looked at: the
+  /// shortest mate never repeats a position, and one within the 50-move
+  /// rule is all puzzles and endgames ask for.
+
+  class Solver {
+  public:
+    Solver(Thread* th, bool interruptible) : thisThread(th), interruptible(interruptible) {
+      index = size_t(std::find(Threads.begin(), Threads.end(), th) - Threads.begin());
+    }
+
+    Bounds mid(Position& pos, int depth, uint32_t thpn, uint32_t thdn, Move* best = nullptr);
+
+    int solving = 0; // The root depth, the search gives up when it changes
+
+  private:
+    Bounds expand(Position& pos, Move m, int depth, Key& key);
+    size_t select(const Child* children, size_t count, bool orNode, uint32_t threshold, uint32_t& second) const;
+    void count_node();
+
+    Thread* thisThread;
+    size_t index;
+    bool interruptible;
+  };
+
+
+  // Solver::count_node() counts a node of the thread. The main thread also
+  // checks the budget of the solve every 1024 nodes.
+
+  void Solver::count_node() {
+
+    uint64_t nodes = thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+
+    if (thisThread == Threads.main() && (nodes & 1023) == 0)
+    {
+        const Search::LimitsType& limits = Search::Limits;
+
+        if (   (limits.nodes && Threads.nodes_searched() >= uint64_t(limits.nodes))
+            || (limits.movetime && now() - limits.startTime >= limits.movetime))
+            Threads.stop = true;
+    }
+  }
+
+
+  // Solver::expand() gives the bounds of the node the move m leads to, solved
+  // to depth plies. Unless the table knows better, a defender with no move
+  // is mated and otherwise its moves are the proof number, one attacker move
+  // costs as much to prove as to disprove.
+
+  Bounds Solver::expand(Position& pos, Move m, int depth, Key& key) {
+
+    StateInfo st;
+    Bounds b;
+
+    pos.do_move(m, st);
+    count_node();
+    key = Table::key(pos, depth);
+
+    if (!MateTable.probe(key, b))
+    {
+        if (depth & 1)
+            b = { 1, 1, 0 };
+        else
+        {
+            size_t evasions = MoveList<LEGAL>(pos).size();
+            b =  evasions == 0 ? Proven
+               : depth < 2     ? Disproven
+                               : Bounds{ uint32_t(evasions), 1, 0 };
+        }
+    }
+
+    pos.undo_move(m);
+    return b;
+  }
+
+
+  // Solver::select() picks the child to search next: the easiest to prove at
+  // an OR node, to disprove at an AND node. The value of the runner-up goes
+  // to second. Helper threads take one of the children within a quarter of
+  // the best value, spread by their index, so that they don't all walk the
+  // same path of the shared table. The pick stays below the threshold of
+  // the node, else its search would return at once.
+
+  size_t Solver::select(const Child* children, size_t count, bool orNode, uint32_t threshold, uint32_t& second) const {
+
+    auto value = [&](size_t i) { return orNode ? children[i].bounds.pn : children[i].bounds.dn; };
+
+    size_t best = 0;
+    for (size_t i = 1; i < count; ++i)
+        if (value(i) < value(best))
+            best = i;
+
+    if (index > 0)
+    {
+        uint64_t margin = std::min(uint64_t(value(best)) + value(best) / 4, uint64_t(threshold) - 1);
+        size_t candidates = 0;
+        for (size_t i = 0; i < count; ++i)
+            candidates += value(i) <= margin;
+
+        size_t pick = index % candidates;
+        for (size_t i = 0; i < count; ++i)
+            if (value(i) <= margin && pick-- == 0)
+            {
+                best = i;
+                break;
+            }
+    }
+
+    second = Infinite;
+    for (size_t i = 0; i < count; ++i)
+        if (i != best)
+            second = std::min(second, value(i));
+
+    return best;
+  }
+
+
+  // Solver::mid() is the df-pn search. It works on pos until its proof or
+  // disproof number reaches the threshold, always in the child that decides
+  // its bounds, and saves them to the table. The threshold of the child is
+  // the bound of the runner-up scaled by 1 + 1/4, so that the search doesn't
+  // switch back and forth between children of close bounds. When best is
+  // given, a proven node leaves there the move that mates the quickest, or
+  // that delays the mate the most.
+
+  Bounds Solver::mid(Position& pos, int depth, uint32_t thpn, uint32_t thdn, Move* best) {
+
+    const bool orNode = depth & 1;
+    const Key key = Table::key(pos, depth);
+    const uint64_t startNodes = thisThread->nodes;
+    Child children[MAX_MOVES];
+    size_t count = 0;
+
+    for (const auto& m : MoveList<LEGAL>(pos))
+        if (!orNode || pos.gives_check(m))
+        {
+            children[count].move = m;
+            children[count].bounds = expand(pos, m, depth - 1, children[count].key);
+            ++count;
+        }
+
+    if (count == 0)
+    {
+        Bounds b = orNode ? Disproven : Proven;
+        MateTable.save(key, b, 1);
+        return b;
+    }
+
+    Bounds b;
+
+    while (true)
+    {
+        // Other threads and transpositions may have solved more of them
+        for (size_t i = 0; i < count; ++i)
+            MateTable.probe(children[i].key, children[i].bounds);
+
+        b = orNode ? Bounds{ Infinite, 0, 0 } : Bounds{ 0, Infinite, 0 };
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Bounds& c = children[i].bounds;
+            if (orNode)
+            {
+                if (c.pn == 0 && (b.pn != 0 || c.length + 1 < b.length))
+                    b.length = c.length + 1;
+                b.pn = std::min(b.pn, c.pn);
+                b.dn = add(b.dn, c.dn);
+            }
+            else
+            {
+                b.pn = add(b.pn, c.pn);
+                b.dn = std::min(b.dn, c.dn);
+                b.length = std::max(b.length, c.length + 1);
+            }
+        }
+
+        if (   b.pn >= thpn
+            || b.dn >= thdn
+            || (interruptible && (Threads.stop || rootDepth != solving)))
+            break;
+
+        uint32_t second;
+        size_t i = select(children, count, orNode, orNode ? thpn : thdn, second);
+        Child& c = children[i];
+        uint32_t scaled = uint32_t(std::min(uint64_t(second) + second / 4 + 1, uint64_t(Infinite)));
+        uint32_t childPn, childDn;
+
+        if (orNode)
+        {
+            childPn = std::min(thpn, std::max(scaled, c.bounds.pn + 1));
+            childDn = thdn == Infinite ? Infinite : thdn - b.dn + c.bounds.dn;
+        }
+        else
+        {
+            childPn = thpn == Infinite ? Infinite : thpn - b.pn + c.bounds.pn;
+            childDn = std::min(thdn, std::max(scaled, c.bounds.dn + 1));
+        }
+
+        StateInfo st;
+        pos.do_move(c.move, st);
+        c.bounds = mid(pos, depth - 1, childPn, childDn);
+        pos.undo_move(c.move);
+    }
+
+    if (best && b.pn == 0)
+    {
+        const Child* pick = nullptr;
+        for (size_t i = 0; i < count; ++i)
+            if (   children[i].bounds.pn == 0
+                && (  !pick
+                    || (orNode ? children[i].bounds.length < pick->bounds.length
+                               : children[i].bounds.length > pick->bounds.length)))
+                pick = &children[i];
+        *best = pick->move;
+    }
+
+    MateTable.save(key, b, thisThread->nodes - startNodes);
+    return b;
+  }
+
+} // namespace
+
+
+/// start() prepares a solve of the root position of the main thread, to the
+/// mate length of "go dfpn mate <moves>" or else to MaxMoves
+
+void start() {
+
+  int moves = Search::Limits.mate ? std::min(Search::Limits.mate, MaxMoves) : MaxMoves;
+
+  MateTable.resize(size_t(Options["Mate Hash"]));
+  maxDepth = 2 * moves - 1;
+  rootDepth = 1;
+  provenDepth = 0;
+}
+
+
+/// work() solves the root to one depth after the other, together with the
+/// other threads, until a mate is proven, none is left within maxDepth or
+/// the solve is stopped.
+
+void work(Thread* th) {
+
+  Solver solver(th, true);
+  Position& pos = th->rootPos;
+
+  while (!Threads.stop)
+  {
+      int depth = solver.solving = rootDepth;
+      if (depth > maxDepth)
+          break;
+
+      Bounds b = solver.mid(pos, depth, Infinite, Infinite);
+
+      if (b.pn == 0 && rootDepth.compare_exchange_strong(depth, maxDepth + 2))
+          provenDepth = depth;
+
+      else if (b.dn == 0)
+          rootDepth.compare_exchange_strong(depth, depth + 2);
+  }
+}
+
+
+/// report() finds the mating line of a proven mate, following the proof in
+/// the table, and prints it like the search does, or prints how far the
+/// mates by checks were ruled out.
+
+void report() {
+
+  Thread* th = Threads.main();
+  Position& pos = th->rootPos;
+  const int depth = provenDepth;
+
+  LastResult.proven = depth > 0;
+  LastResult.moves = depth > 0 ? (depth + 1) / 2 : (std::min(int(rootDepth), maxDepth + 2) - 1) / 2;
+  LastResult.pv.clear();
+  LastResult.nodes = Threads.nodes_searched();
+  LastResult.time = std::max(now() - Search::Limits.startTime, TimePoint(1));
+
+  // Any part of the proof evicted from the table is solved again, the nodes
+  // of that don't count in the result
+  if (LastResult.proven)
+  {
+      Solver solver(th, false);
+      StateInfo states[2 * MaxMoves];
+
+      for (int d = depth; d > 0; --d)
+      {
+          Move m = MOVE_NONE;
+          solver.mid(pos, d, Infinite, Infinite, &m);
+          if (m == MOVE_NONE)
+              break;
+
+          LastResult.pv.push_back(m);
+          pos.do_move(m, states[depth - d]);
+      }
+
+      for (auto it = LastResult.pv.rbegin(); it != LastResult.pv.rend(); ++it)
+          pos.undo_move(*it);
+  }
+
+  std::stringstream ss;
+  ss << "info";
+
+  if (LastResult.proven)
+      ss << " depth " << depth << " score mate " << LastResult.moves;
+
+  ss << " nodes " << LastResult.nodes
+     << " nps "   << LastResult.nodes * 1000 / LastResult.time
+     << " time "  << LastResult.time;
+
+  if (LastResult.proven)
+  {
+      ss << " pv";
+      for (Move m : LastResult.pv)
+          ss << " " << UCI::move(m, pos.is_chess960());
+  }
+  else
+      ss << "\ninfo string no mate by checks in " << LastResult.moves
+         << (Threads.stop ? " moves, stopped" : " moves");
+
+  sync_cout << ss.str() << sync_endl;
+}
+
+
+/// result() is the outcome of the last solve, once report() is done
+
+const Result& result() {
+  return LastResult;
+}
+
+} // namespace stockfish::Mate
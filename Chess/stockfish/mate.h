@@ -0,0 +1,70 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MATE_H_INCLUDED
+#define MATE_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+#include "misc.h"
+#include "types.h"
+
+namespace stockfish {
+
+class Thread;
+
+namespace Mate {
+
+/// Mate is a solver for mates by checks, a depth-first proof-number (df-pn)
+/// search started by "go dfpn [mate <moves>] [nodes <n>] [movetime <ms>]".
+/// The side to move only plays checks, the other side every evasion, so the
+/// trees are narrow and a best-first search proves long mates that the
+/// alpha-beta search only finds deep in its iterations. Quiet moves of the
+/// attacker are never tried: mates that need one are out of its reach.
+///
+/// Like perft, it runs on all threads of the pool: the main thread calls
+/// start(), every thread calls work() on a shared table of its own, and once
+/// the root is solved or the budget spent the main thread calls report().
+
+constexpr int MaxMoves = 60;
+
+/// Result is the outcome of the last solve. A proven mate comes with its
+/// length in moves, the shortest by checks, and a mating line along its
+/// proof. Otherwise moves is the length up to which no mate was found.
+
+struct Result {
+  bool proven;
+  int moves;
+  std::vector<Move> pv;
+  uint64_t nodes;
+  TimePoint time;
+};
+
+void start();
+void work(Thread* th);
+void report();
+const Result& result();
+
+} // namespace Mate
+
+} // namespace stockfish
+
+#endif // #ifndef MATE_H_INCLUDED
@@ -79,14 +79,80 @@ namespace stockfish {
           && pos.count<PAWN>(~us) >= 1;
   }
 
+  /// own_imbalance() is the part of the imbalance that depends only on the
+  /// side's own pieces, the QuadraticOurs terms.
+  constexpr int own_imbalance(const int pieceCount[PIECE_TYPE_NB]) {
+
+    int bonus = 0;
+
+    for (int pt1 = NO_PIECE_TYPE; pt1 <= QUEEN; ++pt1)
+    {
+        int v = 0;
+
+        for (int pt2 = NO_PIECE_TYPE; pt2 <= pt1; ++pt2)
+            v += QuadraticOurs[pt1][pt2] * pieceCount[pt2];
+
+        bonus += pieceCount[pt1] * v;
+    }
+
+    return bonus;
+  }
+
+  /// The own imbalance of the usual piece sets, up to 8 pawns, 2 knights, 2
+  /// bishops, 2 rooks and a queen, computed at compile time. Only sets with
+  /// promoted pieces miss it. The index counts the pieces in mixed radix.
+  constexpr int OwnRadix[PIECE_TYPE_NB] = { 1, 9, 3, 3, 3, 2 };
+  constexpr int OwnSets = 9 * 3 * 3 * 3 * 2;
+
+  struct OwnTable { int value[OwnSets]; };
+
+  constexpr OwnTable make_own_table() {
+
+    OwnTable t = {};
+
+    for (int idx = 0; idx < OwnSets; ++idx)
+    {
+        int pieceCount[PIECE_TYPE_NB] = {};
+
+        for (int pt = PAWN, rest = idx; pt <= QUEEN; rest /= OwnRadix[pt++])
+            pieceCount[pt] = rest % OwnRadix[pt];
+
+        pieceCount[NO_PIECE_TYPE] = pieceCount[BISHOP] > 1;
+        t.value[idx] = own_imbalance(pieceCount);
+    }
+
+    return t;
+  }
+
+  constexpr OwnTable OwnImbalance = make_own_table();
+
+  /// own_index() returns the index of the side's pieces in OwnImbalance, -1
+  /// if they aren't a usual set
+  int own_index(const int pieceCount[PIECE_TYPE_NB]) {
+
+    int idx = 0;
+
+    for (int pt = QUEEN; pt >= PAWN; --pt)
+    {
+        if (pieceCount[pt] >= OwnRadix[pt])
+            return -1;
+
+        idx = idx * OwnRadix[pt] + pieceCount[pt];
+    }
+
+    return idx;
+  }
+
   /// imbalance() calculates the imbalance by comparing the piece count of each
-  /// piece type for both colors.
+  /// piece type for both colors. The own part comes from OwnImbalance for the
+  /// usual sets, only the QuadraticTheirs terms are computed then.
   template<Color Us>
   int imbalance(const int pieceCount[][PIECE_TYPE_NB]) {
 
     constexpr Color Them = ~Us;
 
-    int bonus = 0;
+    const int idx = own_index(pieceCount[Us]);
+    int bonus = idx >= 0 ? OwnImbalance.value[idx] : own_imbalance(pieceCount[Us]);
 
     // Second-degree polynomial material imbalance, by Tord Romstad
     for (int pt1 = NO_PIECE_TYPE; pt1 <= QUEEN; ++pt1)
@@ -97,8 +163,7 @@ namespace stockfish {
         int v = 0;
 
         for (int pt2 = NO_PIECE_TYPE; pt2 <= pt1; ++pt2)
-            v +=  QuadraticOurs[pt1][pt2] * pieceCount[Us][pt2]
-                + QuadraticTheirs[pt1][pt2] * pieceCount[Them][pt2];
+            v += QuadraticTheirs[pt1][pt2] * pieceCount[Them][pt2];
 
         bonus += pieceCount[Us][pt1] * v;
     }
@@ -110,18 +175,13 @@ namespace stockfish {
 
 namespace stockfish::Material {
 
-/// Material::probe() looks up the current position's material configuration in
-/// the material hash table. It returns a pointer to the Entry if the position
-/// is found. Otherwise a new Entry is computed and stored there, so we don't
-/// have to recompute all when the same material configuration occurs again.
+SharedHashTable<Entry> SharedTable;
 
-Entry* probe(const Position& pos) {
+namespace {
 
-  Key key = pos.material_key();
-  Entry* e = pos.this_thread()->materialTable[key];
+/// compute() fills the entry of the current position's material configuration
 
-  if (e->key == key)
-      return e;
+void compute(const Position& pos, Key key, Entry* e) {
 
   std::memset(e, 0, sizeof(Entry));
   e->key = key;
@@ -138,13 +198,13 @@ Entry* probe(const Position& pos) {
   // material configuration. Firstly we look for a fixed configuration one, then
   // for a generic one if the previous search failed.
   if ((e->evaluationFunction = Endgames::probe<Value>(key)) != nullptr)
-      return e;
+      return;
 
   for (Color c : { WHITE, BLACK })
       if (is_KXK(pos, c))
       {
           e->evaluationFunction = &EvaluateKXK[c];
-          return e;
+          return;
       }
 
   // OK, we didn't find any special evaluation function for the current material
@@ -154,7 +214,7 @@ Entry* probe(const Position& pos) {
   if (sf)
   {
       e->scalingFunction[sf->strongSide] = sf; // Only strong color assigned
-      return e;
+      return;
   }
 
   // We didn't find any specialized scaling function, so fall back on generic
@@ -213,6 +273,39 @@ Entry* probe(const Position& pos) {
     pos.count<BISHOP>(BLACK)    , pos.count<ROOK>(BLACK), pos.count<QUEEN >(BLACK) } };
 
   e->value = int16_t((imbalance<WHITE>(pieceCount) - imbalance<BLACK>(pieceCount)) / 16);
+}
+
+} // namespace
+
+
+/// Material::probe() looks up the current position's material configuration in
+/// the material hash table of the thread, then in the shared one. It returns a
+/// pointer to the Entry if the position is found. Otherwise a new Entry is
+/// computed and stored in both, so we don't have to recompute all when the same
+/// material configuration occurs again.
+
+Entry* probe(const Position& pos) {
+
+  Key key = pos.material_key();
+  Table& table = pos.this_thread()->materialTable;
+  Entry* e = table[key];
+
+  ++table.probes;
+
+  if (e->key == key)
+  {
+      ++table.hits;
+      return e;
+  }
+
+  if (SharedTable.load(key, *e))
+  {
+      ++table.sharedHits;
+      return e;
+  }
+
+  compute(pos, key, e);
+  SharedTable.store(key, *e);
   return e;
 }
 
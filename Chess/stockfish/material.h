@@ -64,7 +64,12 @@ struct Entry {
   Phase gamePhase;
 };
 
-typedef HashTable<Entry, 8192> Table;
+typedef HashTable<Entry> Table;
+
+/// The default size of a thread's table, in KB, and the table shared by all
+/// threads, disabled unless the "Shared Material Hash" option is set
+constexpr int DefaultTableKB = 8192 * sizeof(Entry) / 1024;
+extern SharedHashTable<Entry> SharedTable;
 
 Entry* probe(const Position& pos);
 
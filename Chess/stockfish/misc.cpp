@@ -41,17 +41,26 @@ typedef bool(*fun3_t)(HANDLE, CONST GROUP_AFFINITY*, PGROUP_AFFINITY);
 }
 #endif
 
+#include <algorithm>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <vector>
 
 #if defined(__linux__) && !defined(__ANDROID__)
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #endif
 
+#include "cpu.h"
 #include "misc.h"
 #include "thread.h"
 
@@ -130,7 +139,7 @@ public:
 /// engine_info() returns the full name of the current Stockfish version. This
 /// will be either "Stockfish <Tag> DD-MM-YY" (where DD-MM-YY is the date when
 /// the program was compiled) or "Stockfish <Version>", depending on whether
-/// Version is empty.
+/// Version is empty. The instruction set of the kernels in use follows.
 
 const string engine_info(bool to_uci) {
 
@@ -147,7 +156,8 @@ const string engine_info(bool to_uci) {
   }
 
   ss << (Is64Bit ? " 64" : "")
-     << (HasPext ? " BMI2" : (HasPopCnt ? " POPCNT" : ""))
+     << (Cpu::level() != Cpu::GENERIC ? std::string(" ") + Cpu::name(Cpu::level())
+         : HasPext ? " BMI2" : HasPopCnt ? " POPCNT" : "")
      << (to_uci  ? "\nid author ": " by ")
      << "T. Romstad, M. Costalba, J. Kiiski, G. Linscott";
 
@@ -293,40 +303,457 @@ void prefetch(void* addr) {
 #endif
 
 
-/// aligned_ttmem_alloc will return suitably aligned memory, and if possible use large pages.
-/// The returned pointer is the aligned one, while the mem argument is the one that needs to be passed to free.
-/// With c++17 some of this functionality can be simplified.
+/// large_page_alloc() returns memory aligned to at least a cache line, backed
+/// by the largest pages it can get. On Linux it tries, for allocations big
+/// enough, explicit huge pages of 1 GB then 2 MB (MAP_HUGETLB, which need pages
+/// reserved in /proc/sys/vm/nr_hugepages), then transparent huge pages with
+/// madvise(), then normal pages. Elsewhere it uses normal pages. The memory is
+/// zeroed, and when it comes fresh from the system, its pages are only backed
+/// when first touched. Returns nullptr if it can't allocate at all. The memory
+/// must be released by large_page_free().
+
+namespace {
+
+enum PageKind { PAGES_1G, PAGES_2M, PAGES_THP, PAGES_NORMAL, PAGE_KIND_NB };
+
+struct Allocation {
+  void* mem;   // What to release
+  size_t size; // Mapped size
+  PageKind kind;
+};
+
+struct Allocations {
+  std::mutex mutex;
+  std::map<void*, Allocation> map; // By the returned pointer
+};
+
+// Never destroyed: the global TT frees its table at exit, maybe after this
+// translation unit's statics are gone
+Allocations& allocations() {
+
+  static Allocations* a = new Allocations();
+  return *a;
+}
+
 #if defined(__linux__) && !defined(__ANDROID__)
 
-void* aligned_ttmem_alloc(size_t allocSize, void*& mem) {
+constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+bool thp_enabled() {
 
-  constexpr size_t alignment = 2 * 1024 * 1024; // assumed 2MB page sizes
-  size_t size = ((allocSize + alignment - 1) / alignment) * alignment; // multiple of alignment
-  mem = aligned_alloc(alignment, size);
-  madvise(mem, allocSize, MADV_HUGEPAGE);
-  return mem;
+  std::ifstream f("/sys/kernel/mm/transparent_hugepage/enabled");
+  string modes;
+  return std::getline(f, modes) && modes.find("[never]") == string::npos;
+}
+
+Allocation map_pages(size_t size) {
+
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+  for (int shift : { 30, 21 })
+  {
+      size_t page = size_t(1) << shift;
+      if (size < page)
+          continue;
+
+      size_t len = (size + page - 1) & ~(page - 1);
+      void* mem = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+      if (mem != MAP_FAILED)
+          return { mem, len, shift == 30 ? PAGES_1G : PAGES_2M };
+  }
+#endif
+
+  if (size >= HugePageSize && thp_enabled())
+  {
+      // Map a huge page more than needed and trim it to a huge page boundary
+      size_t len = (size + HugePageSize - 1) & ~(HugePageSize - 1);
+      char* mem = static_cast<char*>(mmap(nullptr, len + HugePageSize, PROT_READ | PROT_WRITE,
+                                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+      if (mem != MAP_FAILED)
+      {
+          char* aligned = reinterpret_cast<char*>((uintptr_t(mem) + HugePageSize - 1) & ~uintptr_t(HugePageSize - 1));
+
+          if (aligned > mem)
+              munmap(mem, aligned - mem);
+          if (mem + HugePageSize > aligned)
+              munmap(aligned + len, mem + HugePageSize - aligned);
+
+          madvise(aligned, len, MADV_HUGEPAGE);
+          return { aligned, len, PAGES_THP };
+      }
+  }
+
+  void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return { mem == MAP_FAILED ? nullptr : mem, size, PAGES_NORMAL };
+}
+
+void unmap_pages(const Allocation& a) { munmap(a.mem, a.size); }
+
+
+/// thp_backed() returns how much of the transparent huge page allocations the
+/// kernel actually backed with huge pages, from /proc/self/smaps
+
+size_t thp_backed() {
+
+  std::ifstream f("/proc/self/smaps");
+  string line;
+  size_t backed = 0;
+  bool ours = false;
+
+  while (std::getline(f, line))
+  {
+      unsigned long begin, end, kb;
+
+      if (sscanf(line.c_str(), "%lx-%lx", &begin, &end) == 2)
+          ours = std::any_of(allocations().map.begin(), allocations().map.end(), [&](const auto& a) {
+              uintptr_t mem = uintptr_t(a.second.mem);
+              return a.second.kind == PAGES_THP && mem < end && mem + a.second.size > begin;
+          });
+
+      else if (ours && sscanf(line.c_str(), "AnonHugePages: %lu kB", &kb) == 1)
+          backed += kb * 1024;
+  }
+
+  return backed;
 }
 
 #else
 
-void* aligned_ttmem_alloc(size_t allocSize, void*& mem) {
+Allocation map_pages(size_t size) {
 
   constexpr size_t alignment = 64; // assumed cache line size
-  size_t size = allocSize + alignment - 1; // allocate some extra space
-  mem = malloc(size);
-  void* ret = reinterpret_cast<void*>((uintptr_t(mem) + alignment - 1) & ~uintptr_t(alignment - 1));
+  void* mem = calloc(size + alignment - 1, 1);
+  return { mem, size, PAGES_NORMAL };
+}
+
+void unmap_pages(const Allocation& a) { free(a.mem); }
+
+size_t thp_backed() { return 0; }
+
+#endif
+
+} // namespace
+
+void* large_page_alloc(size_t size) {
+
+  Allocation a = map_pages(size);
+
+  if (!a.mem)
+      return nullptr;
+
+  constexpr size_t alignment = 64;
+  void* ret = reinterpret_cast<void*>((uintptr_t(a.mem) + alignment - 1) & ~uintptr_t(alignment - 1));
+
+  std::lock_guard<std::mutex> lk(allocations().mutex);
+  allocations().map[ret] = a;
   return ret;
 }
 
+
+/// large_page_free() releases memory from large_page_alloc(). Accepts nullptr.
+
+void large_page_free(void* mem) {
+
+  if (!mem)
+      return;
+
+  std::lock_guard<std::mutex> lk(allocations().mutex);
+  auto it = allocations().map.find(mem);
+
+  assert(it != allocations().map.end());
+
+  unmap_pages(it->second);
+  allocations().map.erase(it);
+}
+
+
+/// large_page_report() tells how the memory from large_page_alloc() in use is
+/// backed, like "Memory: 16 MB in 2 MB pages, 24 MB in transparent huge pages
+/// (20 MB backed)". Call it once the memory has been touched, the kernel backs
+/// transparent huge pages only then.
+
+string large_page_report() {
+
+  std::lock_guard<std::mutex> lk(allocations().mutex);
+  size_t total[PAGE_KIND_NB] = {};
+
+  for (const auto& a : allocations().map)
+      total[a.second.kind] += a.second.size;
+
+  const char* names[PAGE_KIND_NB] = { "in 1 GB pages", "in 2 MB pages",
+                                      "in transparent huge pages", "in normal pages" };
+  auto mb = [](size_t bytes) { return std::to_string((bytes + 512 * 1024) / (1024 * 1024)) + " MB "; };
+  std::ostringstream ss;
+  const char* sep = " ";
+
+  ss << "Memory:";
+  for (int k = PAGES_1G; k < PAGE_KIND_NB; ++k)
+  {
+      if (!total[k])
+          continue;
+
+      ss << sep << mb(total[k]) << names[k];
+      sep = ", ";
+      if (k == PAGES_THP)
+          ss << " (" << mb(std::min(thp_backed(), total[k])) << "backed)";
+  }
+
+  return ss.str();
+}
+
+
+/// page_faults() returns the number of page faults, minor and major, of the
+/// calling thread so far. Differences tell the faults of a piece of code. It
+/// costs a system call, and returns 0 where the count isn't available.
+
+uint64_t page_faults() {
+
+#if defined(__linux__) && !defined(__ANDROID__)
+  rusage ru;
+  return getrusage(RUSAGE_THREAD, &ru) ? 0 : uint64_t(ru.ru_minflt + ru.ru_majflt);
+#else
+  return 0;
+#endif
+}
+
+
+/// lower_thread_priority() makes the calling thread run only when the cores
+/// have nothing else to do, for the work in the background.
+
+void lower_thread_priority() {
+
+#if defined(_WIN32)
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+#elif defined(__linux__) && !defined(__ANDROID__)
+  setpriority(PRIO_PROCESS, 0, 19); // On Linux, of the calling thread only
 #endif
+}
 
 
 namespace WinProcGroup {
 
-#ifndef _WIN32
+/// thread_ranges() describes where each of the given number of threads goes,
+/// merging consecutive threads with the same destination: "0-7 on node 0".
+
+string thread_ranges(size_t threads, const std::function<string(size_t)>& where) {
+
+  std::ostringstream ss;
+
+  for (size_t i = 0, j; i < threads; i = j)
+  {
+      string w = where(i);
+      for (j = i + 1; j < threads && where(j) == w; ++j) {}
+
+      ss << (i ? ", " : "") << i;
+      if (j - 1 > i)
+          ss << "-" << j - 1;
+      ss << " " << w;
+  }
+
+  return ss.str();
+}
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+namespace {
+
+/// A NUMA node with the logical CPUs the process is allowed to run on
+
+struct NumaNode {
+  int id;
+  std::vector<int> cpus;
+  int cores;
+};
+
+
+/// read_cpu_list() parses a sysfs CPU list like "0-3,8-11". Returns an empty
+/// list if the file can't be read.
+
+std::vector<int> read_cpu_list(const string& path) {
+
+  std::vector<int> cpus;
+  std::ifstream file(path);
+  string range;
+
+  while (std::getline(file, range, ','))
+  {
+      std::istringstream ss(range);
+      int first, last;
+      char dash;
+
+      if (!(ss >> first))
+          continue;
+
+      if (!(ss >> dash >> last))
+          last = first;
+
+      for (int c = first; c <= last; ++c)
+          cpus.push_back(c);
+  }
+
+  return cpus;
+}
+
+
+/// cpu_ranges() is the inverse of read_cpu_list(), for sorted lists
+
+string cpu_ranges(const std::vector<int>& cpus) {
+
+  std::ostringstream ss;
+
+  for (size_t i = 0, j; i < cpus.size(); i = j)
+  {
+      for (j = i + 1; j < cpus.size() && cpus[j] == cpus[j - 1] + 1; ++j) {}
+
+      ss << (i ? "," : "") << cpus[i];
+      if (j - 1 > i)
+          ss << "-" << cpus[j - 1];
+  }
+
+  return ss.str();
+}
+
+
+/// numa_nodes() reads the CPU topology from sysfs, restricted to the CPUs of
+/// the process affinity mask, so that taskset and cgroups are respected. A
+/// core is counted once however many logical CPUs (SMT siblings) it has.
+
+std::vector<NumaNode> numa_nodes() {
+
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed))
+      return {};
+
+  auto is_allowed = [&](int c) { return c < CPU_SETSIZE && CPU_ISSET(c, &allowed); };
+
+  // Without NUMA support in the kernel, all the CPUs make a single node
+  std::vector<int> ids = read_cpu_list("/sys/devices/system/node/online");
+  if (ids.empty())
+      ids.push_back(-1);
+
+  std::vector<NumaNode> nodes;
+
+  for (int id : ids)
+  {
+      NumaNode node = { id, {}, 0 };
+      string list = id >= 0 ? "/sys/devices/system/node/node" + std::to_string(id) + "/cpulist"
+                            : "/sys/devices/system/cpu/online";
+
+      for (int c : read_cpu_list(list))
+      {
+          if (!is_allowed(c))
+              continue;
+
+          // The lowest allowed sibling stands for the core
+          std::vector<int> siblings = read_cpu_list("/sys/devices/system/cpu/cpu"
+                                     + std::to_string(c) + "/topology/thread_siblings_list");
+          auto first = std::find_if(siblings.begin(), siblings.end(), is_allowed);
+
+          node.cpus.push_back(c);
+          node.cores += first == siblings.end() || *first == c;
+      }
+
+      if (!node.cpus.empty())
+          nodes.push_back(node);
+  }
+
+  return nodes;
+}
+
+
+/// topology() returns the nodes, read once
+
+const std::vector<NumaNode>& topology() {
+
+  static const std::vector<NumaNode> nodes = numa_nodes();
+  return nodes;
+}
+
+
+/// best_node() returns the index in topology() of the node for the thread with
+/// index idx, with the same policy as best_group() on Windows: fill the cores
+/// of a node before moving on to the next one, then spread the threads that
+/// are left evenly across the nodes, on the SMT siblings. Returns -1 when
+/// there are more threads than logical CPUs, or a single node.
+
+int best_node(size_t idx) {
+
+  const std::vector<NumaNode>& nodes = topology();
+
+  if (nodes.size() < 2)
+      return -1;
+
+  std::vector<int> groups;
+
+  for (size_t n = 0; n < nodes.size(); ++n)
+      for (int i = 0; i < nodes[n].cores; ++i)
+          groups.push_back(int(n));
+
+  for (size_t sibling = 0, added = 1; added; ++sibling)
+  {
+      added = 0;
+      for (size_t n = 0; n < nodes.size(); ++n)
+          if (nodes[n].cpus.size() - nodes[n].cores > sibling)
+              groups.push_back(int(n)), ++added;
+  }
+
+  return idx < groups.size() ? groups[idx] : -1;
+}
+
+} // namespace
+
+
+/// bindThisThread() sets the affinity of the current thread to the CPUs of its
+/// NUMA node, so that the memory it touches first is allocated on that node.
+
+void bindThisThread(size_t idx) {
+
+  int node = best_node(idx);
+
+  if (node == -1)
+      return;
+
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+
+  for (int c : topology()[node].cpus)
+      CPU_SET(c, &mask);
+
+  pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+}
+
+
+/// layout() describes the NUMA nodes and which node each thread is bound to
+
+string layout(size_t threads) {
+
+  const std::vector<NumaNode>& nodes = topology();
+  std::ostringstream ss;
+
+  ss << nodes.size() << " NUMA node(s):";
+  for (size_t n = 0; n < nodes.size(); ++n)
+      ss << (n ? "," : "") << " node " << nodes[n].id << " cpus " << cpu_ranges(nodes[n].cpus)
+         << " (" << nodes[n].cores << " cores)";
+
+  if (nodes.size() < 2)
+      return ss.str() + ", threads not bound";
+
+  ss << "; threads " << thread_ranges(threads, [&](size_t idx) {
+      int n = best_node(idx);
+      return n == -1 ? string("unbound") : "on node " + std::to_string(nodes[n].id);
+  });
+
+  return ss.str();
+}
+
+#elif !defined(_WIN32)
 
 void bindThisThread(size_t) {}
 
+string layout(size_t) { return "threads not bound"; }
+
 #else
 
 /// best_group() retrieves logical processor information using Windows specific
@@ -423,6 +850,17 @@ void bindThisThread(size_t idx) {
       fun3(GetCurrentThread(), &affinity, nullptr);
 }
 
+
+/// layout() describes which processor group each thread is bound to
+
+string layout(size_t threads) {
+
+  return "threads " + thread_ranges(threads, [](size_t idx) {
+      int group = best_group(idx);
+      return group == -1 ? string("unbound") : "in group " + std::to_string(group);
+  });
+}
+
 #endif
 
 } // namespace WinProcGroup
@@ -21,21 +21,36 @@
 #ifndef MISC_H_INCLUDED
 #define MISC_H_INCLUDED
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
 #include <ostream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "types.h"
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <intrin.h> // For __rdtsc()
+#endif
+
 namespace stockfish {
 
 const std::string engine_info(bool to_uci = false);
 const std::string compiler_info();
 void prefetch(void* addr);
 void start_logger(const std::string& fname);
-void* aligned_ttmem_alloc(size_t size, void*& mem);
+void* large_page_alloc(size_t size);
+void large_page_free(void* mem);
+std::string large_page_report();
+uint64_t page_faults();
+void lower_thread_priority();
 
 void dbg_hit_on(bool b);
 void dbg_hit_on(bool c, bool b);
@@ -51,12 +66,149 @@ inline TimePoint now() {
         (std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-template<class Entry, int Size>
+/// timestamp() is a cheap timer for short code: the time stamp counter on x86,
+/// else a clock in nanoseconds. Only differences between two calls make sense.
+
+inline uint64_t timestamp() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  return __rdtsc();
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  return __builtin_ia32_rdtsc();
+#else
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>
+                 (std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/// HashTable is a thread's table of Entry, a power of 2 number of them, used
+/// for the pawn, material and evaluation hashes. resize() allocates it on the
+/// heap, zeroed, with calloc() that gets big blocks as fresh pages from the
+/// system: they are only backed when first touched, so resizing is cheap and
+/// the memory is local to the thread probing it on systems with a first-touch
+/// policy. resize() also resets the counters of probes, hits, and hits in the
+/// SharedHashTable behind it, if any. It keeps the entries when the size
+/// doesn't change, clear() empties them. A size of 0 frees the table.
+
+template<class Entry>
 struct HashTable {
-  Entry* operator[](Key key) { return &table[(uint32_t)key & (Size - 1)]; }
+
+  static_assert(std::is_trivial<Entry>::value, "A zeroed Entry must be an empty one");
+
+  Entry* operator[](Key key) { return &table[(uint32_t)key & (count - 1)]; }
+  size_t size() const { return count; }
+  size_t memory() const { return count * sizeof(Entry); }
+
+  void resize(size_t kbSize) {
+
+    size_t n = kbSize ? 1 : 0;
+    while (n && n * 2 * sizeof(Entry) <= kbSize * 1024)
+        n *= 2;
+
+    if (n != count)
+    {
+        table.reset(n ? static_cast<Entry*>(std::calloc(n, sizeof(Entry))) : nullptr);
+        count = table ? n : 0;
+        if (n && !table)
+            throw std::bad_alloc();
+    }
+
+    probes = hits = sharedHits = 0;
+  }
+
+  void clear() { std::fill(table.get(), table.get() + count, Entry()); }
+
+  uint64_t probes = 0, hits = 0, sharedHits = 0;
+
+private:
+  struct Free { void operator()(Entry* p) const { std::free(p); } };
+
+  std::unique_ptr<Entry[], Free> table;
+  size_t count = 0;
+};
+
+
+/// SharedHashTable is a lockless table of Entry shared by all the threads,
+/// behind their HashTable. Each slot is a seqlock: its sequence number is odd
+/// while a writer copies an entry in, and a reader copies the entry out and
+/// checks that the number didn't change meanwhile. Writers never wait, a store
+/// into a slot being written is dropped. Entry must have a key member, and be
+/// trivially copyable. It is disabled, the default, with a size of 0.
+
+template<class Entry>
+class SharedHashTable {
+
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    Entry entry;
+  };
+
+public:
+ ~SharedHashTable() { large_page_free(slots); }
+
+  bool enabled() const { return slots != nullptr; }
+  size_t memory() const { return slots ? (mask + 1) * sizeof(Slot) : 0; }
+
+  /// resize() sets the size in megabytes, and clears the table. It stays
+  /// disabled if it can't be allocated. No thread may be searching.
+  void resize(size_t mbSize) {
+
+    large_page_free(slots);
+    slots = nullptr;
+    mask = 0;
+
+    if (!mbSize)
+        return;
+
+    size_t count = 1;
+    while (count * 2 * sizeof(Slot) <= mbSize * 1024 * 1024)
+        count *= 2;
+
+    // The memory from large_page_alloc() is zeroed
+    slots = static_cast<Slot*>(large_page_alloc(count * sizeof(Slot)));
+    if (slots)
+        mask = count - 1;
+  }
+
+  /// load() copies the entry of the key into e, and returns whether it was
+  /// there. Otherwise e is left with garbage.
+  bool load(Key key, Entry& e) const {
+
+    if (!slots)
+        return false;
+
+    const Slot& s = slots[key & mask];
+    uint32_t seq = s.sequence.load(std::memory_order_acquire);
+
+    if (seq & 1)
+        return false;
+
+    std::memcpy(static_cast<void*>(&e), &s.entry, sizeof(Entry));
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return s.sequence.load(std::memory_order_relaxed) == seq && e.key == key;
+  }
+
+  void store(Key key, const Entry& e) {
+
+    if (!slots)
+        return;
+
+    Slot& s = slots[key & mask];
+    uint32_t seq = s.sequence.load(std::memory_order_relaxed);
+
+    if ((seq & 1) || !s.sequence.compare_exchange_strong(seq, seq + 1, std::memory_order_acq_rel))
+        return;
+
+    // The odd sequence must be visible before any byte of the new entry, or
+    // a reader could take them with the old even one
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(static_cast<void*>(&s.entry), &e, sizeof(Entry));
+    s.sequence.store(seq + 2, std::memory_order_release);
+  }
 
 private:
-  std::vector<Entry> table = std::vector<Entry>(Size); // Allocate on the heap
+  Slot* slots = nullptr;
+  size_t mask = 0;
 };
 
 
@@ -119,10 +271,12 @@ public:
 /// logical processor group. This usually means to be limited to use max 64
 /// cores. To overcome this, some special platform specific API should be
 /// called to set group affinity for each thread. Original code from Texel by
-/// Peter Österlund.
+/// Peter Österlund. On Linux the threads are bound to NUMA nodes instead, read
+/// from sysfs, so that the tables they initialize are local to them.
 
 namespace WinProcGroup {
   void bindThisThread(size_t idx);
+  std::string layout(size_t threads);
 }
 
 }
@@ -20,11 +20,17 @@
 
 #include <cassert>
 
+#include "cpu.h"
 #include "movegen.h"
 #include "position.h"
 
 namespace stockfish {
 
+// The generators are kernels, compiled once per instruction set level in the
+// namespace of the level, see cpu.h
+
+namespace ISA_NAMESPACE {
+
   template<GenType Type, Direction D>
   ExtMove* make_promotions(ExtMove* moveList, Square to, Square ksq) {
 
@@ -348,8 +354,9 @@ ExtMove* generate<LEGAL>(const Position& pos, ExtMove* moveList) {
   Square ksq = pos.square<KING>(us);
   ExtMove* cur = moveList;
 
-  moveList = pos.checkers() ? generate<EVASIONS    >(pos, moveList)
-                            : generate<NON_EVASIONS>(pos, moveList);
+  // Qualified, as argument dependent lookup finds the public generate() too
+  moveList = pos.checkers() ? ISA_NAMESPACE::generate<EVASIONS    >(pos, moveList)
+                            : ISA_NAMESPACE::generate<NON_EVASIONS>(pos, moveList);
   while (cur != moveList)
       if (   (pinned || from_sq(*cur) == ksq || type_of(*cur) == ENPASSANT)
           && !pos.legal(*cur))
@@ -360,4 +367,24 @@ ExtMove* generate<LEGAL>(const Position& pos, ExtMove* moveList) {
   return moveList;
 }
 
+} // namespace ISA_NAMESPACE
+
+#ifndef KERNELS_ONLY
+
+/// generate<Type>() runs the generator of the kernels in use
+
+template<GenType Type>
+ExtMove* generate(const Position& pos, ExtMove* moveList) {
+  return Cpu::kernels->generate[Type](pos, moveList);
+}
+
+template ExtMove* generate<CAPTURES>(const Position&, ExtMove*);
+template ExtMove* generate<QUIETS>(const Position&, ExtMove*);
+template ExtMove* generate<QUIET_CHECKS>(const Position&, ExtMove*);
+template ExtMove* generate<EVASIONS>(const Position&, ExtMove*);
+template ExtMove* generate<NON_EVASIONS>(const Position&, ExtMove*);
+template ExtMove* generate<LEGAL>(const Position&, ExtMove*);
+
+#endif // KERNELS_ONLY
+
 } // namespace
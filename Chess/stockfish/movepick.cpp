@@ -18,9 +18,15 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <cassert>
+#include <mutex>
+#include <new>
+#include <vector>
 
+#include "misc.h"
 #include "movepick.h"
+#include "search.h"
 
 namespace stockfish {
 
@@ -269,4 +275,138 @@ top:
   assert(false);
   return MOVE_NONE; // Silence warning
 }
+
+
+namespace {
+
+  // Released blocks of histories, by compact. A block is only reused by the
+  // thread of the same index, which is bound to the same NUMA node, so that
+  // its memory stays local to the thread that first touched it.
+  std::mutex poolMutex;
+  std::vector<Histories*> pool[2];
+
+  // The continuation histories follow the Histories struct
+  constexpr size_t ContinuationOffset = (sizeof(Histories) + 63) / 64 * 64;
+
+  size_t block_size(bool compact) {
+    return ContinuationOffset + (compact ? 1 : 4) * sizeof(ContinuationHistory);
+  }
+}
+
+
+/// Histories::acquire() returns cleared histories, from the pool when it has
+/// a block of the right kind released by a thread of the same index, else
+/// newly allocated. It should be called by the thread that will use them, so
+/// that they are local to it on NUMA systems.
+
+Histories* Histories::acquire(size_t idx, bool compact) {
+
+  Histories* h = nullptr;
+  std::vector<Histories*> unused;
+
+  {
+      std::lock_guard<std::mutex> lk(poolMutex);
+      auto it = std::find_if(pool[compact].begin(), pool[compact].end(),
+                             [idx](Histories* b) { return b->owner == idx; });
+      if (it != pool[compact].end())
+      {
+          h = *it;
+          pool[compact].erase(it);
+      }
+
+      // Blocks of the other kind are left from before the mode changed
+      unused.swap(pool[!compact]);
+  }
+
+  for (Histories* u : unused)
+      large_page_free(u);
+
+  if (!h)
+  {
+      char* mem = static_cast<char*>(large_page_alloc(block_size(compact)));
+      if (!mem)
+          throw std::bad_alloc();
+
+      h = new (mem) Histories();
+      h->compact = compact;
+      h->owner = idx;
+
+      auto ch = reinterpret_cast<ContinuationHistory*>(mem + ContinuationOffset);
+      for (bool inCheck : { false, true })
+          for (StatsType c : { NoCaptures, Captures })
+              h->continuationHistory[inCheck][c] = compact ? ch : ch + 2 * inCheck + c;
+  }
+
+  h->clear();
+  return h;
+}
+
+
+/// Histories::release() gives histories back to the pool. Accepts nullptr.
+
+void Histories::release(Histories* h) {
+
+  if (!h)
+      return;
+
+  std::lock_guard<std::mutex> lk(poolMutex);
+  pool[h->compact].push_back(h);
+}
+
+
+/// Histories::release_pool() frees the blocks in the pool of the threads of
+/// index threads and above, which no longer exist. Zero frees all of them.
+
+void Histories::release_pool(size_t threads) {
+
+  std::lock_guard<std::mutex> lk(poolMutex);
+
+  for (auto& blocks : pool)
+  {
+      auto gone = std::partition(blocks.begin(), blocks.end(),
+                                 [threads](Histories* h) { return h->owner < threads; });
+      for (auto it = gone; it != blocks.end(); ++it)
+          large_page_free(*it);
+
+      blocks.erase(gone, blocks.end());
+  }
+}
+
+
+/// Histories::pooled_memory() returns the bytes held by the pool
+
+size_t Histories::pooled_memory() {
+
+  std::lock_guard<std::mutex> lk(poolMutex);
+  return pool[false].size() * block_size(false) + pool[true].size() * block_size(true);
+}
+
+
+/// Histories::memory() returns the bytes of the block
+
+size_t Histories::memory() const { return block_size(compact); }
+
+
+/// Histories::clear() resets the tables, the shared one of compact mode once
+
+void Histories::clear() {
+
+  counterMoves.fill(MOVE_NONE);
+  mainHistory.fill(0);
+  lowPlyHistory.fill(0);
+  captureHistory.fill(0);
+
+  for (bool inCheck : { false, true })
+      for (StatsType c : { NoCaptures, Captures })
+      {
+          if (compact && (inCheck || c))
+              continue;
+
+          for (auto& to : *continuationHistory[inCheck][c])
+                for (auto& h : to)
+                      h->fill(0);
+          (*continuationHistory[inCheck][c])[NO_PIECE][0]->fill(Search::CounterMovePruneThreshold - 1);
+      }
+}
+
 } // namespace
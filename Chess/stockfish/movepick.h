@@ -97,8 +97,8 @@ constexpr int MAX_LPH = 4;
 typedef Stats<int16_t, 10692, MAX_LPH, int(SQUARE_NB) * int(SQUARE_NB)> LowPlyHistory;
 
 /// CounterMoveHistory stores counter moves indexed by [piece][to] of the previous
-/// move, see www.chessprogramming.org/Countermove_Heuristic
-typedef Stats<Move, NOT_USED, PIECE_NB, SQUARE_NB> CounterMoveHistory;
+/// move, see www.chessprogramming.org/Countermove_Heuristic. A move fits in 16 bits.
+typedef Stats<uint16_t, NOT_USED, PIECE_NB, SQUARE_NB> CounterMoveHistory;
 
 /// CapturePieceToHistory is addressed by a move's [piece][to][captured piece type]
 typedef Stats<int16_t, 10692, PIECE_NB, SQUARE_NB, PIECE_TYPE_NB> CapturePieceToHistory;
@@ -112,6 +112,35 @@ typedef Stats<int16_t, 29952, PIECE_NB, SQUARE_NB> PieceToHistory;
 typedef Stats<PieceToHistory, NOT_USED, PIECE_NB, SQUARE_NB> ContinuationHistory;
 
 
+/// Histories holds the history tables of a thread. They are allocated as one
+/// block, by acquire(), which takes it from a pool of released blocks when the
+/// thread of the same index released one. In compact mode the four continuation histories, by [inCheck][capture],
+/// are the same table, which takes a quarter of the memory of the histories.
+
+struct Histories {
+
+  static Histories* acquire(size_t idx, bool compact);
+  static void release(Histories* h);
+  static void release_pool(size_t threads = 0);
+  static size_t pooled_memory();
+
+  void clear();
+  size_t memory() const;
+
+  PieceToHistory* continuation(bool inCheck, bool capture, Piece pc, Square to) {
+    return &(*continuationHistory[inCheck][capture])[pc][to];
+  }
+
+  bool compact;
+  size_t owner; // Index of the thread that first touched the block
+  CounterMoveHistory counterMoves;
+  ButterflyHistory mainHistory;
+  LowPlyHistory lowPlyHistory;
+  CapturePieceToHistory captureHistory;
+  ContinuationHistory* continuationHistory[2][2]; // In the same block
+};
+
+
 /// MovePicker class is used to pick one pseudo legal move at a time from the
 /// current position. The most important method is next_move(), which returns a
 /// new pseudo legal move each time it is called, until there are no moves left,
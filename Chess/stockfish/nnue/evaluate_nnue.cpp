@@ -0,0 +1,566 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// NNUE evaluation: an efficiently updatable neural network, that evaluates a
+// position from the pieces placed relative to each king. The architecture is
+// HalfKP[41024->256x2]-32-32-1, the one of the first Stockfish networks, whose
+// .nnue files load as they are.
+
+#include <cstring>   // For std::memcpy
+#include <string>
+
+#if defined(USE_AVX2)
+#  include <immintrin.h>
+#elif defined(USE_SSE41)
+#  include <smmintrin.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#define WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#  define NOMINMAX // Disable macros min() and max()
+#endif
+#include <windows.h>
+#endif
+
+#include "../bitboard.h"
+#include "../cpu.h"
+#include "../evaluate.h"
+#include "../misc.h"
+#include "../position.h"
+
+namespace stockfish::Eval::NNUE {
+
+namespace {
+
+  // HalfKP features: a piece other than a king on a square, relative to the
+  // king of the perspective, with the board rotated for black. Piece-square
+  // indices start at 1 (0 was a "no piece" slot), and kings aren't features.
+  constexpr int PieceSquares = 1 + 10 * SQUARE_NB;
+  constexpr int InputDimensions = SQUARE_NB * PieceSquares;
+
+  constexpr int L1 = 2 * HalfDimensions; // Both perspectives, side to move first
+  constexpr int L2 = 32;
+  constexpr int L3 = 32;
+
+  constexpr int WeightScaleBits = 6;
+  constexpr int OutputScale = 16;
+
+  // The file header holds hashes of the architecture, computed as the trainer
+  // does, so that files of other architectures are refused
+  constexpr uint32_t Version = 0x7AF32F16u;
+
+  constexpr uint32_t affine_hash(uint32_t outputs, uint32_t previous) {
+    return (0xCC03DAE4u + outputs) ^ (previous >> 1) ^ (previous << 31);
+  }
+
+  constexpr uint32_t relu_hash(uint32_t previous) { return 0x538D24C7u + previous; }
+
+  constexpr uint32_t TransformerHash = (0x5D69D5B9u ^ 1) ^ L1;
+  constexpr uint32_t NetworkHash = affine_hash(1, relu_hash(affine_hash(L3,
+                                   relu_hash(affine_hash(L2, 0xEC42E90Du ^ L1)))));
+
+  static_assert((TransformerHash ^ NetworkHash) == 0x3E5AA6EEu, "Not the HalfKP 256x2-32-32 hash");
+
+  constexpr size_t TransformerSize = (HalfDimensions + size_t(InputDimensions) * HalfDimensions) * sizeof(int16_t);
+
+} // namespace
+
+
+// The network, shared by the kernels of all the instruction set levels. The
+// feature transformer, about 20 MB, is in large pages. The rest is small.
+
+struct Layers {
+  alignas(64) int32_t biases1[L2];
+  alignas(64) int8_t  weights1[L2 * L1]; // Row major, a row per output
+  alignas(64) int32_t biases2[L3];
+  alignas(64) int8_t  weights2[L3 * L2];
+  alignas(64) int32_t bias3;
+  alignas(64) int8_t  weights3[L3];
+};
+
+extern int16_t* ftBiases;
+extern int16_t* ftWeights; // InputDimensions columns of HalfDimensions
+extern Layers layers;
+
+
+// The kernels, compiled once per instruction set level. All but the entry
+// point have internal linkage, so that the levels don't share any.
+
+namespace {
+
+
+  // Index of the feature for the piece pc on s, seen from perspective, with
+  // its king on ksq. Black sees the board rotated.
+
+  inline int orient(Color perspective, Square s) {
+    return int(s) ^ (perspective == WHITE ? 0 : 63);
+  }
+
+  inline int feature_index(Color perspective, Square s, Piece pc, Square ksq) {
+
+    int pieceIndex = 2 * (type_of(pc) - 1) + (color_of(pc) != perspective);
+    return orient(perspective, s) + 1 + SQUARE_NB * pieceIndex
+          + PieceSquares * orient(perspective, ksq);
+  }
+
+  inline const int16_t* column(int index) { return ftWeights + index * HalfDimensions; }
+
+
+  // Kernels. The vector ones need USE_AVX2 or USE_SSE41 with the matching
+  // compiler flags, as arch/ sets them, the scalar ones are the reference.
+
+#if defined(USE_AVX2)
+  typedef __m256i vec_t;
+  constexpr int VecBytes = 32;
+  inline vec_t vec_add_16(vec_t a, vec_t b) { return _mm256_add_epi16(a, b); }
+  inline vec_t vec_sub_16(vec_t a, vec_t b) { return _mm256_sub_epi16(a, b); }
+#elif defined(USE_SSE41)
+  typedef __m128i vec_t;
+  constexpr int VecBytes = 16;
+  inline vec_t vec_add_16(vec_t a, vec_t b) { return _mm_add_epi16(a, b); }
+  inline vec_t vec_sub_16(vec_t a, vec_t b) { return _mm_sub_epi16(a, b); }
+#endif
+
+  // Adds (Add) or subtracts a column of the feature transformer to acc
+
+  template<bool Add>
+  void update_column(int16_t* acc, const int16_t* col) {
+
+#if defined(USE_AVX2) || defined(USE_SSE41)
+    vec_t* a = reinterpret_cast<vec_t*>(acc);
+    const vec_t* c = reinterpret_cast<const vec_t*>(col);
+
+    for (int j = 0; j < HalfDimensions * 2 / VecBytes; ++j)
+        a[j] = Add ? vec_add_16(a[j], c[j]) : vec_sub_16(a[j], c[j]);
+#else
+    for (int j = 0; j < HalfDimensions; ++j)
+        acc[j] = Add ? acc[j] + col[j] : acc[j] - col[j];
+#endif
+  }
+
+  // Clamps the accumulation of a perspective to [0, 127], as bytes
+
+  void clamp_accumulation(const int16_t* acc, uint8_t* out) {
+
+#if defined(USE_AVX2)
+    const __m256i zero = _mm256_setzero_si256();
+    for (int j = 0; j < HalfDimensions / 32; ++j)
+    {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc) + 2 * j);
+        __m256i b = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc) + 2 * j + 1);
+        // Packing works within 128 bit lanes, the permutation restores the order
+        __m256i packed = _mm256_max_epi8(_mm256_packs_epi16(a, b), zero);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(out) + j, _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+#elif defined(USE_SSE41)
+    const __m128i zero = _mm_setzero_si128();
+    for (int j = 0; j < HalfDimensions / 16; ++j)
+    {
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc) + 2 * j);
+        __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(acc) + 2 * j + 1);
+        _mm_store_si128(reinterpret_cast<__m128i*>(out) + j, _mm_max_epi8(_mm_packs_epi16(a, b), zero));
+    }
+#else
+    for (int j = 0; j < HalfDimensions; ++j)
+        out[j] = uint8_t(Utility::clamp(int(acc[j]), 0, 127));
+#endif
+  }
+
+  // Affine layer: out = biases + weights * in, with Inputs a multiple of 32.
+  // The products of bytes fit in 16 bits, as inputs are at most 127.
+
+  template<int Inputs, int Outputs>
+  void affine(const uint8_t* in, int32_t* out, const int8_t* weights, const int32_t* biases) {
+
+    static_assert(Inputs % 32 == 0, "Inputs must fill whole vectors");
+
+#if defined(USE_AVX2)
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i* input = reinterpret_cast<const __m256i*>(in);
+
+    for (int i = 0; i < Outputs; ++i)
+    {
+        const __m256i* row = reinterpret_cast<const __m256i*>(weights + i * Inputs);
+        __m256i sum = _mm256_setzero_si256();
+
+        for (int j = 0; j < Inputs / 32; ++j)
+        {
+            __m256i product = _mm256_maddubs_epi16(_mm256_load_si256(input + j),
+                                                   _mm256_load_si256(row + j));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(product, ones));
+        }
+
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+        out[i] = biases[i] + _mm_cvtsi128_si32(s);
+    }
+#elif defined(USE_SSE41)
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i* input = reinterpret_cast<const __m128i*>(in);
+
+    for (int i = 0; i < Outputs; ++i)
+    {
+        const __m128i* row = reinterpret_cast<const __m128i*>(weights + i * Inputs);
+        __m128i sum = _mm_setzero_si128();
+
+        for (int j = 0; j < Inputs / 16; ++j)
+        {
+            __m128i product = _mm_maddubs_epi16(_mm_load_si128(input + j),
+                                                _mm_load_si128(row + j));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(product, ones));
+        }
+
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        out[i] = biases[i] + _mm_cvtsi128_si32(sum);
+    }
+#else
+    for (int i = 0; i < Outputs; ++i)
+    {
+        int32_t sum = biases[i];
+        for (int j = 0; j < Inputs; ++j)
+            sum += weights[i * Inputs + j] * in[j];
+        out[i] = sum;
+    }
+#endif
+  }
+
+  // Clipped ReLU: scales the outputs of an affine layer back, and clamps them
+  // to [0, 127] as the bytes the next layer takes
+
+  template<int Size>
+  void clipped_relu(const int32_t* in, uint8_t* out) {
+    for (int i = 0; i < Size; ++i)
+        out[i] = uint8_t(Utility::clamp(in[i] >> WeightScaleBits, 0, 127));
+  }
+
+
+  // refresh() computes the accumulation of perspective from scratch
+
+  void refresh(const Position& pos, Color perspective, Accumulator& acc) {
+
+    int16_t* a = acc.accumulation[perspective];
+    Square ksq = pos.square<KING>(perspective);
+
+    std::memcpy(a, ftBiases, HalfDimensions * sizeof(int16_t));
+
+    Bitboard b = pos.pieces() & ~pos.pieces(KING);
+    while (b)
+    {
+        Square s = pop_lsb(&b);
+        update_column<true>(a, column(feature_index(perspective, s, pos.piece_on(s), ksq)));
+    }
+
+    acc.computed[perspective] = true;
+  }
+
+
+  // update_accumulator() brings the accumulation of perspective up to date.
+  // It looks for the closest earlier state where it was computed, and applies
+  // the pieces that changed since, as long as this is cheaper than a refresh,
+  // and the king of perspective didn't move. The states in between are updated
+  // too, for the siblings of this position.
+
+  void update_accumulator(const Position& pos, Color perspective) {
+
+    StateInfo* path[32];
+    int n = 0;
+    int budget = popcount(pos.pieces()) - 2; // Columns a refresh adds
+    Piece ourKing = make_piece(perspective, KING);
+
+    StateInfo* st = pos.state();
+
+    while (!st->accumulator.computed[perspective])
+    {
+        const DirtyPiece& dp = st->dirtyPiece;
+
+        if (   dp.dirtyNum < 0
+            || !st->previous
+            || dp.piece[0] == ourKing
+            || (budget -= 2 * dp.dirtyNum + 1) < 0)
+        {
+            refresh(pos, perspective, pos.state()->accumulator);
+            return;
+        }
+
+        path[n++] = st;
+        st = st->previous;
+    }
+
+    Square ksq = pos.square<KING>(perspective);
+
+    while (n--)
+    {
+        const int16_t* from = st->accumulator.accumulation[perspective];
+        st = path[n];
+        int16_t* a = st->accumulator.accumulation[perspective];
+        const DirtyPiece& dp = st->dirtyPiece;
+
+        std::memcpy(a, from, HalfDimensions * sizeof(int16_t));
+
+        for (int i = 0; i < dp.dirtyNum; ++i)
+        {
+            if (type_of(dp.piece[i]) == KING)
+                continue;
+
+            if (dp.from[i] != SQ_NONE)
+                update_column<false>(a, column(feature_index(perspective, dp.from[i], dp.piece[i], ksq)));
+
+            if (dp.to[i] != SQ_NONE)
+                update_column<true>(a, column(feature_index(perspective, dp.to[i], dp.piece[i], ksq)));
+        }
+
+        st->accumulator.computed[perspective] = true;
+    }
+  }
+
+} // namespace
+
+
+namespace ISA_NAMESPACE {
+
+/// ISA_NAMESPACE::evaluate() returns the network evaluation of the position,
+/// from the point of view of the side to move. The accumulators of the position
+/// are updated first, incrementally when possible.
+
+Value evaluate(const Position& pos) {
+
+  assert(ftBiases);
+
+  alignas(64) uint8_t transformed[L1];
+  alignas(64) int32_t out1[L2];
+  alignas(64) uint8_t in2[L2];
+  alignas(64) int32_t out2[L3];
+  alignas(64) uint8_t in3[L3];
+  int32_t out3;
+
+  update_accumulator(pos, WHITE);
+  update_accumulator(pos, BLACK);
+
+  const Accumulator& acc = pos.state()->accumulator;
+  Color us = pos.side_to_move();
+
+  clamp_accumulation(acc.accumulation[us], transformed);
+  clamp_accumulation(acc.accumulation[~us], transformed + HalfDimensions);
+
+  affine<L1, L2>(transformed, out1, layers.weights1, layers.biases1);
+  clipped_relu<L2>(out1, in2);
+  affine<L2, L3>(in2, out2, layers.weights2, layers.biases2);
+  clipped_relu<L3>(out2, in3);
+  affine<L3, 1>(in3, &out3, layers.weights3, &layers.bias3);
+
+  return Value(out3 / OutputScale);
+}
+
+} // namespace ISA_NAMESPACE
+
+#ifndef KERNELS_ONLY
+
+int16_t* ftBiases;
+int16_t* ftWeights;
+Layers layers;
+
+namespace {
+
+  std::string netDescription;
+
+
+  // MappedFile maps a whole file in memory, read only
+
+  class MappedFile {
+  public:
+    explicit MappedFile(const std::string& path) {
+
+#ifndef _WIN32
+      int fd = ::open(path.c_str(), O_RDONLY);
+      if (fd == -1)
+          return;
+
+      struct stat statbuf;
+      if (!fstat(fd, &statbuf) && statbuf.st_size > 0)
+      {
+          void* p = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (p != MAP_FAILED)
+          {
+              madvise(p, statbuf.st_size, MADV_SEQUENTIAL);
+              base = static_cast<const char*>(p);
+              length = statbuf.st_size;
+          }
+      }
+      ::close(fd);
+#else
+      HANDLE fd = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+      if (fd == INVALID_HANDLE_VALUE)
+          return;
+
+      DWORD sizeHigh;
+      DWORD sizeLow = GetFileSize(fd, &sizeHigh);
+      mapping = ::CreateFileMapping(fd, nullptr, PAGE_READONLY, sizeHigh, sizeLow, nullptr);
+      ::CloseHandle(fd);
+
+      if (mapping)
+      {
+          base = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+          length = base ? size_t(uint64_t(sizeHigh) << 32 | sizeLow) : 0;
+      }
+#endif
+    }
+
+   ~MappedFile() {
+#ifndef _WIN32
+      if (base)
+          munmap(const_cast<char*>(base), length);
+#else
+      if (base)
+          UnmapViewOfFile(base);
+      if (mapping)
+          CloseHandle(mapping);
+#endif
+    }
+
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+
+  private:
+    const char* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE mapping = nullptr;
+#endif
+  };
+
+
+  // Reader reads little endian values in sequence from a mapped file, as the
+  // hosts we build for are. It fails, and keeps failing, past the end.
+
+  struct Reader {
+    const char* cur;
+    const char* end;
+
+    template<typename T>
+    bool read(T* out, size_t count = 1) {
+      if (!cur || size_t(end - cur) < count * sizeof(T))
+          return cur = nullptr, false;
+
+      std::memcpy(out, cur, count * sizeof(T));
+      cur += count * sizeof(T);
+      return true;
+    }
+
+    bool expect(uint32_t value) {
+      uint32_t v;
+      return read(&v) && v == value;
+    }
+  };
+
+} // namespace
+
+
+/// load() reads a network from a .nnue file, through a memory mapping. On
+/// failure the previous network, if any, stays loaded and error tells why.
+
+bool load(const std::string& path, std::string& error) {
+
+  MappedFile file(path);
+
+  if (!file.data())
+  {
+      error = "can't read the network file " + path;
+      return false;
+  }
+
+  Reader r = { file.data(), file.data() + file.size() };
+  uint32_t descriptionSize;
+
+  if (   !r.expect(Version)
+      || !r.expect(TransformerHash ^ NetworkHash)
+      || !r.read(&descriptionSize)
+      || size_t(r.end - r.cur) < descriptionSize)
+  {
+      error = path + " is not a HalfKP 256x2-32-32 network";
+      return false;
+  }
+
+  std::string description(r.cur, descriptionSize);
+  r.cur += descriptionSize;
+
+  int16_t* ft = static_cast<int16_t*>(large_page_alloc(TransformerSize));
+  Layers* l = new Layers();
+
+  bool ok =   ft
+           && r.expect(TransformerHash)
+           && r.read(ft, HalfDimensions)
+           && r.read(ft + HalfDimensions, size_t(InputDimensions) * HalfDimensions)
+           && r.expect(NetworkHash)
+           && r.read(l->biases1, L2) && r.read(l->weights1, L2 * L1)
+           && r.read(l->biases2, L3) && r.read(l->weights2, L3 * L2)
+           && r.read(&l->bias3)      && r.read(l->weights3, L3)
+           && r.cur == r.end;
+
+  if (ok)
+  {
+      large_page_free(ftBiases);
+      ftBiases = ft;
+      ftWeights = ft + HalfDimensions;
+      layers = *l;
+      netDescription = description;
+  }
+  else
+  {
+      large_page_free(ft);
+      error = ft ? path + " is truncated or corrupted" : "no memory for the network";
+  }
+
+  delete l;
+  return ok;
+}
+
+
+/// description() is the description stored in the loaded network file
+
+std::string description() {
+  return netDescription;
+}
+
+
+/// memory() is the size of the loaded network, 0 if none
+
+size_t memory() {
+  return ftBiases ? TransformerSize + sizeof(Layers) : 0;
+}
+
+
+/// evaluate() runs the network evaluation of the kernels in use
+
+Value evaluate(const Position& pos) {
+  return Cpu::kernels->evaluate_nnue(pos);
+}
+
+#endif // KERNELS_ONLY
+
+} // namespace stockfish::Eval::NNUE
@@ -0,0 +1,57 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NNUE_ACCUMULATOR_H_INCLUDED
+#define NNUE_ACCUMULATOR_H_INCLUDED
+
+#include <cstdint>
+
+#include "../types.h"
+
+namespace stockfish::Eval::NNUE {
+
+/// Size of the feature transformer output for one perspective
+constexpr int HalfDimensions = 256;
+
+/// Accumulator holds the feature transformer output of a position, for each
+/// perspective. It lives in the StateInfo, so that the next position can be
+/// updated from it with the few pieces the move changed instead of computed
+/// from scratch.
+
+struct alignas(64) Accumulator {
+  std::int16_t accumulation[COLOR_NB][HalfDimensions];
+  bool computed[COLOR_NB];
+};
+
+/// DirtyPiece lists the pieces a move changed: piece[i] went from from[i] to
+/// to[i], where SQ_NONE stands for off the board. At most 3 of them change,
+/// with a promotion that captures. dirtyNum is -1 when the state doesn't follow
+/// its previous one by a known move, like a search root.
+
+struct DirtyPiece {
+  int dirtyNum;
+  Piece piece[3];
+  Square from[3];
+  Square to[3];
+};
+
+} // namespace stockfish::Eval::NNUE
+
+#endif // #ifndef NNUE_ACCUMULATOR_H_INCLUDED
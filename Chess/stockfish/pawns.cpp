@@ -159,23 +159,40 @@ namespace stockfish {
 
 namespace Pawns {
 
+SharedHashTable<Entry> SharedTable;
+
+
 /// Pawns::probe() looks up the current position's pawns configuration in
-/// the pawns hash table. It returns a pointer to the Entry if the position
-/// is found. Otherwise a new Entry is computed and stored there, so we don't
-/// have to recompute all when the same pawns configuration occurs again.
+/// the pawns hash table of the thread, then in the shared one. It returns a
+/// pointer to the Entry if the position is found. Otherwise a new Entry is
+/// computed and stored in both, so we don't have to recompute all when the
+/// same pawns configuration occurs again.
 
 Entry* probe(const Position& pos) {
 
   Key key = pos.pawn_key();
-  Entry* e = pos.this_thread()->pawnsTable[key];
+  Table& table = pos.this_thread()->pawnsTable;
+  Entry* e = table[key];
+
+  ++table.probes;
 
   if (e->key == key)
+  {
+      ++table.hits;
       return e;
+  }
+
+  if (SharedTable.load(key, *e))
+  {
+      ++table.sharedHits;
+      return e;
+  }
 
   e->key = key;
   e->scores[WHITE] = evaluate<WHITE>(pos, e);
   e->scores[BLACK] = evaluate<BLACK>(pos, e);
 
+  SharedTable.store(key, *e);
   return e;
 }
 
@@ -61,7 +61,12 @@ struct Entry {
   int castlingRights[COLOR_NB];
 };
 
-typedef HashTable<Entry, 131072> Table;
+typedef HashTable<Entry> Table;
+
+/// The default size of a thread's table, in KB, and the table shared by all
+/// threads, disabled unless the "Shared Pawn Hash" option is set
+constexpr int DefaultTableKB = 131072 * sizeof(Entry) / 1024;
+extern SharedHashTable<Entry> SharedTable;
 
 Entry* probe(const Position& pos);
 
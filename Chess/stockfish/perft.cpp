@@ -0,0 +1,257 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "movegen.h"
+#include "perft.h"
+#include "thread.h"
+#include "uci.h"
+
+namespace stockfish::Perft {
+
+namespace {
+
+  /// Entry caches the counts of a subtree. The check field is the key xor'ed
+  /// with the counts, so that an entry torn by a concurrent write doesn't
+  /// verify and reads as a miss. Four counts would not need a cache line,
+  /// but the breakdown fills it exactly.
+
+  struct alignas(64) Entry {
+    Key check;
+    Counts counts;
+  };
+
+  static_assert(sizeof(Entry) == 64, "Entry should fill a cache line");
+
+  Key checksum(Key key, const Counts& c) {
+    return key ^ c.nodes ^ c.captures ^ c.enPassants ^ c.castles
+               ^ c.promotions ^ c.checks ^ c.mates;
+  }
+
+  /// Table is the perft hash, separate from the TT so that a perft neither
+  /// clobbers nor is confused by search entries. It's sized by the "Perft
+  /// Hash" option when a perft starts, and persists between runs, so that
+  /// following a divide down the tree finds the subtrees already counted.
+
+  class Table {
+  public:
+    void resize(size_t mbSize) {
+      size_t size = 0;
+      if (mbSize)
+          for (size = 1; size * 2 * sizeof(Entry) <= mbSize * 1024 * 1024; size *= 2) {}
+      if (size != entries.size())
+          entries = std::vector<Entry>(size);
+    }
+
+    // Depth and mode are mixed into the key, so that the same position
+    // counted to another depth or without breakdown is another entry
+    static Key key(const Position& pos, Depth depth, bool details) {
+      return pos.key() ^ (Key(depth) * 0x9E3779B97F4A7C15ULL) ^ (details ? 0xD1B54A32D192ED03ULL : 0);
+    }
+
+    bool probe(Key key, Counts& c) const {
+      if (entries.empty())
+          return false;
+      const Entry& e = entries[key & (entries.size() - 1)];
+      Counts tmp = e.counts;
+      if (checksum(key, tmp) != e.check)
+          return false;
+      c = tmp;
+      return true;
+    }
+
+    void save(Key key, const Counts& c) {
+      if (entries.empty())
+          return;
+      Entry& e = entries[key & (entries.size() - 1)];
+      e.counts = c;
+      e.check = checksum(key, c);
+    }
+
+  private:
+    std::vector<Entry> entries;
+  };
+
+  Table PerftTable;
+
+  // The root moves are handed out in order, the counts of each are kept
+  // for the divide output
+  std::atomic<size_t> nextRootMove;
+  std::vector<Counts> rootCounts;
+
+
+  // count_move() counts the leaf reached by the legal move m, with the
+  // breakdown. Telling a mate needs the move made, but only for checks.
+
+  void count_move(Position& pos, Move m, Counts& c) {
+
+    c.nodes++;
+    c.captures   += pos.capture(m);
+    c.enPassants += type_of(m) == ENPASSANT;
+    c.castles    += type_of(m) == CASTLING;
+    c.promotions += type_of(m) == PROMOTION;
+
+    if (pos.gives_check(m))
+    {
+        StateInfo st;
+        c.checks++;
+        pos.do_move(m, st, true);
+        c.mates += MoveList<LEGAL>(pos).size() == 0;
+        pos.undo_move(m);
+    }
+  }
+
+
+  // perft() counts the leaves depth plies below pos. Without details the
+  // last ply is bulk counted: the size of the move list is the number of
+  // leaves, and the moves are never made.
+
+  template<bool Details>
+  Counts perft(Position& pos, Depth depth) {
+
+    Counts c = {};
+
+    if (depth == 1)
+    {
+        if (Details)
+            for (const auto& m : MoveList<LEGAL>(pos))
+                count_move(pos, m, c);
+        else
+            c.nodes = MoveList<LEGAL>(pos).size();
+        return c;
+    }
+
+    Key key = Table::key(pos, depth, Details);
+    if (PerftTable.probe(key, c))
+        return c;
+
+    StateInfo st;
+    for (const auto& m : MoveList<LEGAL>(pos))
+    {
+        pos.do_move(m, st);
+        c += perft<Details>(pos, depth - 1);
+        pos.undo_move(m);
+    }
+
+    PerftTable.save(key, c);
+    return c;
+  }
+
+} // namespace
+
+
+Counts& Counts::operator+=(const Counts& c) {
+
+  nodes      += c.nodes;
+  captures   += c.captures;
+  enPassants += c.enPassants;
+  castles    += c.castles;
+  promotions += c.promotions;
+  checks     += c.checks;
+  mates      += c.mates;
+  return *this;
+}
+
+
+/// start() prepares a perft of the root moves of the main thread
+
+void start() {
+
+  PerftTable.resize(size_t(Options["Perft Hash"]));
+  rootCounts.assign(Threads.main()->rootMoves.size(), Counts());
+  nextRootMove = 0;
+}
+
+
+/// work() counts root moves until all are taken or the search is stopped.
+/// The nodes of each go to the thread that counted them, so that
+/// Threads.nodes_searched() is the total as usual.
+
+void work(Thread* th) {
+
+  Position& pos = th->rootPos;
+  const Depth depth = Search::Limits.perft;
+  const bool details = Search::Limits.perftDetails;
+  StateInfo st;
+
+  while (!Threads.stop)
+  {
+      size_t i = nextRootMove++;
+      if (i >= th->rootMoves.size())
+          break;
+
+      Move m = th->rootMoves[i].pv[0];
+      Counts c = {};
+
+      if (depth <= 1)
+          count_move(pos, m, c);
+      else
+      {
+          pos.do_move(m, st);
+          c = details ? perft<true>(pos, depth - 1) : perft<false>(pos, depth - 1);
+          pos.undo_move(m);
+      }
+
+      rootCounts[i] = c;
+      th->nodes += c.nodes;
+  }
+}
+
+
+/// report() prints the count of each root move, then the totals, the time
+/// and the speed, and the breakdown if it was asked for
+
+void report() {
+
+  const Search::RootMoves& rootMoves = Threads.main()->rootMoves;
+  const bool chess960 = Threads.main()->rootPos.is_chess960();
+  Counts total = {};
+
+  for (size_t i = 0; i < rootMoves.size(); ++i)
+  {
+      sync_cout << UCI::move(rootMoves[i].pv[0], chess960) << ": " << rootCounts[i].nodes << sync_endl;
+      total += rootCounts[i];
+  }
+
+  TimePoint elapsed = std::max(now() - Search::Limits.startTime, TimePoint(1));
+
+  std::stringstream ss;
+  ss << "\nNodes searched: " << total.nodes
+     << "\nTime (ms)     : " << elapsed
+     << "\nMnps          : " << std::fixed << std::setprecision(2)
+                             << total.nodes / (1000.0 * elapsed);
+
+  if (Search::Limits.perftDetails)
+      ss << "\nCaptures      : " << total.captures
+         << "\nEn passants   : " << total.enPassants
+         << "\nCastles       : " << total.castles
+         << "\nPromotions    : " << total.promotions
+         << "\nChecks        : " << total.checks
+         << "\nMates         : " << total.mates;
+
+  sync_cout << ss.str() << "\n" << sync_endl;
+}
+
+} // namespace stockfish::Perft
@@ -0,0 +1,57 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PERFT_H_INCLUDED
+#define PERFT_H_INCLUDED
+
+#include <cstdint>
+
+#include "types.h"
+
+namespace stockfish {
+
+class Thread;
+
+namespace Perft {
+
+/// Counts holds the leaf counts of a perft. Only nodes is filled unless the
+/// breakdown was asked for with "go perft <depth> details", because without
+/// it the last ply is bulk counted and its moves are never made.
+
+struct Counts {
+
+  Counts& operator+=(const Counts& c);
+
+  uint64_t nodes, captures, enPassants, castles, promotions, checks, mates;
+};
+
+/// The perft runs on all threads of the pool: the main thread calls start(),
+/// every thread calls work() to take root moves until none is left, and once
+/// all are done the main thread prints the results with report().
+
+void start();
+void work(Thread* th);
+void report();
+
+} // namespace Perft
+
+} // namespace stockfish
+
+#endif // #ifndef PERFT_H_INCLUDED
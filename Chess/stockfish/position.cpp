@@ -26,6 +26,7 @@
 #include <sstream>
 
 #include "bitboard.h"
+#include "evaluate.h"
 #include "misc.h"
 #include "movegen.h"
 #include "position.h"
@@ -718,6 +719,14 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
   assert(captured == NO_PIECE || color_of(captured) == (type_of(m) != CASTLING ? them : us));
   assert(type_of(captured) != KING);
 
+  // Record the pieces the move changes, to update the NNUE accumulators
+  auto& dp = st->dirtyPiece;
+  dp.dirtyNum = 1;
+  dp.piece[0] = pc;
+  dp.from[0] = from;
+  dp.to[0] = to;
+  st->accumulator.computed[WHITE] = st->accumulator.computed[BLACK] = false;
+
   if (type_of(m) == CASTLING)
   {
       assert(pc == make_piece(us, KING));
@@ -757,6 +766,11 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
       // Update board and piece lists
       remove_piece(capsq);
 
+      dp.dirtyNum = 2; // The captured piece goes off the board
+      dp.piece[1] = captured;
+      dp.from[1] = capsq;
+      dp.to[1] = SQ_NONE;
+
       if (type_of(m) == ENPASSANT)
           board[capsq] = NO_PIECE;
 
@@ -812,6 +826,12 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
           remove_piece(to);
           put_piece(promotion, to);
 
+          dp.to[0] = SQ_NONE; // The pawn is replaced by the promoted piece
+          dp.piece[dp.dirtyNum] = promotion;
+          dp.from[dp.dirtyNum] = SQ_NONE;
+          dp.to[dp.dirtyNum] = to;
+          dp.dirtyNum++;
+
           // Update hash keys
           k ^= Zobrist::psq[pc][to] ^ Zobrist::psq[promotion][to];
           st->pawnKey ^= Zobrist::psq[pc][to];
@@ -940,6 +960,18 @@ void Position::do_castling(Color us, Square from, Square& to, Square& rfrom, Squ
   rto = relative_square(us, kingSide ? SQ_F1 : SQ_D1);
   to = relative_square(us, kingSide ? SQ_G1 : SQ_C1);
 
+  if (Do)
+  {
+      auto& dp = st->dirtyPiece;
+      dp.dirtyNum = 2;
+      dp.piece[0] = make_piece(us, KING);
+      dp.from[0] = from;
+      dp.to[0] = to;
+      dp.piece[1] = make_piece(us, ROOK);
+      dp.from[1] = rfrom;
+      dp.to[1] = rto;
+  }
+
   // Remove both pieces first since squares could overlap in Chess960
   remove_piece(Do ? from : to);
   remove_piece(Do ? rfrom : rto);
@@ -957,10 +989,16 @@ void Position::do_null_move(StateInfo& newSt) {
   assert(!checkers());
   assert(&newSt != st);
 
-  std::memcpy(&newSt, st, sizeof(StateInfo));
+  // A null move changes no piece, so the NNUE accumulators are copied as they
+  // are when in use. Otherwise skip them, they're over a kilobyte.
+  std::memcpy(&newSt, st, Eval::useNNUE ? sizeof(StateInfo) : offsetof(StateInfo, accumulator));
   newSt.previous = st;
   st = &newSt;
 
+  st->dirtyPiece.dirtyNum = 0;
+  if (!Eval::useNNUE)
+      st->accumulator.computed[WHITE] = st->accumulator.computed[BLACK] = false;
+
   if (st->epSquare != SQ_NONE)
   {
       st->key ^= Zobrist::enpassant[file_of(st->epSquare)];
@@ -29,6 +29,8 @@
 #include "bitboard.h"
 #include "types.h"
 
+#include "nnue/nnue_accumulator.h"
+
 namespace stockfish {
 
 /// StateInfo struct stores information needed to restore a Position object to
@@ -55,6 +57,10 @@ struct StateInfo {
   Bitboard   pinners[COLOR_NB];
   Bitboard   checkSquares[PIECE_TYPE_NB];
   int        repetition;
+
+  // Used by the NNUE evaluation
+  Eval::NNUE::DirtyPiece  dirtyPiece;
+  Eval::NNUE::Accumulator accumulator;
 };
 
 /// A list to keep track of the position states along the setup moves (from the
@@ -154,6 +160,7 @@ public:
   int game_ply() const;
   bool is_chess960() const;
   Thread* this_thread() const;
+  StateInfo* state() const;
   bool is_draw(int ply) const;
   bool has_game_cycle(int ply) const;
   bool has_repeated() const;
@@ -397,6 +404,10 @@ inline Thread* Position::this_thread() const {
   return thisThread;
 }
 
+inline StateInfo* Position::state() const {
+  return st;
+}
+
 inline void Position::put_piece(Piece pc, Square s) {
 
   board[s] = pc;
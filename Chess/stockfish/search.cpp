@@ -26,11 +26,14 @@
 #include <sstream>
 
 #include "evaluate.h"
+#include "mate.h"
 #include "misc.h"
 #include "movegen.h"
 #include "movepick.h"
+#include "perft.h"
 #include "position.h"
 #include "search.h"
+#include "searchtree.h"
 #include "thread.h"
 #include "timeman.h"
 #include "tt.h"
@@ -66,6 +69,10 @@ namespace {
   constexpr uint64_t ttHitAverageWindow     = 4096;
   constexpr uint64_t ttHitAverageResolution = 1024;
 
+  // Under the fast-move policy, in time managed searches, a root TT entry at
+  // least this deep is trusted enough to move without searching
+  constexpr Depth FastMoveDepth = 20;
+
   // Razor and futility margins
   constexpr int RazorMargin = 531;
   Value futility_margin(Depth d, bool improving) {
@@ -115,9 +122,10 @@ namespace {
   // ThreadHolding structure keeps track of which thread left breadcrumbs at the given
   // node for potential reductions. A free node will be marked upon entering the moves
   // loop by the constructor, and unmarked upon leaving that loop by the destructor.
+  // Deterministic searches leave none, as what they'd find depends on timing.
   struct ThreadHolding {
     explicit ThreadHolding(Thread* thisThread, Key posKey, int ply) {
-       location = ply < 8 ? &breadcrumbs[posKey & (breadcrumbs.size() - 1)] : nullptr;
+       location = ply < 8 && !Threads.deterministic ? &breadcrumbs[posKey & (breadcrumbs.size() - 1)] : nullptr;
        otherThread = false;
        owning = false;
        if (location)
@@ -154,6 +162,19 @@ namespace {
   template <NodeType NT>
   Value qsearch(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth = 0);
 
+  // In deterministic mode every thread writes to its own overlay of the TT
+  TTEntry* probe_tt(Thread* th, Key key, bool& found) {
+    return Threads.deterministic ? th->ttOverlay.probe(key, found) : TT.probe(key, found);
+  }
+
+  // Saves to a probed entry, counting the entries of other positions it overwrites
+  void save_tt([[maybe_unused]] Thread* th, TTEntry* tte, Key key, Value v, bool pv,
+               Bound b, Depth d, Move m, Value ev) {
+    if (tte->replaces(key))
+        dbg_stat(th, ttReplacements);
+    tte->save(key, v, pv, b, d, m, ev);
+  }
+
   Value value_to_tt(Value v, int ply);
   Value value_from_tt(Value v, int ply, int r50c);
   void update_pv(Move* pv, Move move, Move* childPv);
@@ -162,32 +183,6 @@ namespace {
   void update_all_stats(const Position& pos, Stack* ss, Move bestMove, Value bestValue, Value beta, Square prevSq,
                         Move* quietsSearched, int quietCount, Move* capturesSearched, int captureCount, Depth depth);
 
-  // perft() is our utility to verify move generation. All the leaf nodes up
-  // to the given depth are generated and counted, and the sum is returned.
-  template<bool Root>
-  uint64_t perft(Position& pos, Depth depth) {
-
-    StateInfo st;
-    uint64_t cnt, nodes = 0;
-    const bool leaf = (depth == 2);
-
-    for (const auto& m : MoveList<LEGAL>(pos))
-    {
-        if (Root && depth <= 1)
-            cnt = 1, nodes++;
-        else
-        {
-            pos.do_move(m, st);
-            cnt = leaf ? MoveList<LEGAL>(pos).size() : perft<false>(pos, depth - 1);
-            nodes += cnt;
-            pos.undo_move(m);
-        }
-        if (Root)
-            sync_cout << UCI::move(m, pos.is_chess960()) << ": " << cnt << sync_endl;
-    }
-    return nodes;
-  }
-
 } // namespace
 
 
@@ -218,17 +213,87 @@ void Search::clear() {
 
 void MainThread::search() {
 
+  // perft is our utility to verify move generation, the root moves are
+  // split across the threads
   if (Limits.perft)
   {
-      nodes = perft<true>(rootPos, Limits.perft);
-      sync_cout << "\nNodes searched: " << nodes << "\n" << sync_endl;
+      Perft::start();
+
+      for (Thread* th : Threads)
+          if (th != this)
+              th->start_searching();
+
+      Perft::work(this);
+
+      for (Thread* th : Threads)
+          if (th != this)
+              th->wait_for_search_finished();
+
+      Perft::report();
+      return;
+  }
+
+  // The mate solver shares its table between the threads, and they all try
+  // the root until one of them solves it
+  if (Limits.dfpn)
+  {
+      Mate::start();
+
+      for (Thread* th : Threads)
+          if (th != this)
+              th->start_searching();
+
+      Mate::work(this);
+
+      for (Thread* th : Threads)
+          if (th != this)
+              th->wait_for_search_finished();
+
+      Mate::report();
+
+      // Like a search, end with the move, the first of the mating line
+      const std::vector<Move>& pv = Mate::result().pv;
+      sync_cout << "bestmove " << UCI::move(pv.empty() ? MOVE_NONE : pv[0], rootPos.is_chess960()) << sync_endl;
       return;
   }
 
   Color us = rootPos.side_to_move();
   Time.init(Limits, us, rootPos.game_ply());
+  SearchTree::start();
   TT.new_search();
 
+  bool ttHit;
+  TTEntry* tte = TT.probe(rootPos.key(), ttHit);
+  Move ttMove = ttHit ? tte->move() : MOVE_NONE; // Local copy to be SMP safe
+  Value ttValue = ttHit ? value_from_tt(tte->value(), 0, rootPos.rule50_count()) : VALUE_NONE;
+  auto ttRootMove = std::find(rootMoves.begin(), rootMoves.end(), ttMove);
+
+  // Fast-move policy: if the TT already holds an exact score for the root
+  // position, from a search at least FastMoveDepth deep, play its move right
+  // away. This typically happens when the game follows a line that has been
+  // searched deeply before. Not in depth limited searches: the TT doesn't
+  // tell which search an entry comes from, and one deeper than the limit
+  // would play above the strength it asks for.
+  bool fastMove =    Options["Fast Move"]
+                  && Options["MultiPV"] == 1
+                  && !Limits.infinite
+                  && !Limits.mate
+                  && !Limits.nodes
+                  && !Limits.depth
+                  && ttHit
+                  && ttValue != VALUE_NONE
+                  && tte->bound() == BOUND_EXACT
+                  && tte->depth() >= FastMoveDepth
+                  && ttRootMove != rootMoves.end()
+                  && ttRootMove->tbRank == rootMoves[0].tbRank;
+
+  // A forced move needs no thinking, a one ply search is enough for a score
+  if (   Options["Fast Move"]
+      && rootMoves.size() == 1
+      && !Limits.infinite
+      && !Limits.mate)
+      Limits.depth = 1;
+
   if (rootMoves.empty())
   {
       rootMoves.emplace_back(MOVE_NONE);
@@ -236,6 +301,13 @@ void MainThread::search() {
                 << UCI::value(rootPos.checkers() ? -VALUE_MATE : VALUE_DRAW)
                 << sync_endl;
   }
+  else if (fastMove)
+  {
+      std::rotate(rootMoves.begin(), ttRootMove, ttRootMove + 1);
+      rootMoves[0].score = ttValue;
+      completedDepth = selDepth = tte->depth();
+      sync_cout << UCI::pv(rootPos, completedDepth, -VALUE_INFINITE, VALUE_INFINITE) << sync_endl;
+  }
   else
   {
       for (Thread* th : Threads)
@@ -266,6 +338,19 @@ void MainThread::search() {
       if (th != this)
           th->wait_for_search_finished();
 
+  // Save what a stop in the middle of an iteration left unmerged
+  if (Threads.deterministic)
+      Threads.merge_tt();
+
+  SearchTree::finish(rootPos);
+
+  // Report once how the TT is backed, after a search touched it: the kernel
+  // backs transparent huge pages only then.
+  static bool reported = false;
+  if (!reported)
+      sync_cout << "info string " << large_page_report() << sync_endl;
+  reported = true;
+
   // When playing in 'nodes as time' mode, subtract the searched nodes from
   // the available ones before exiting.
   if (Limits.npmsec)
@@ -276,6 +361,7 @@ void MainThread::search() {
   // Check if there are threads with a better score than main thread
   if (    Options["MultiPV"] == 1
       && !Limits.depth
+      && !fastMove
       && !(Skill(Options["Skill Level"]).enabled() || Options["UCI_LimitStrength"])
       &&  rootMoves[0].pv[0] != MOVE_NONE)
   {
@@ -307,6 +393,29 @@ void MainThread::search() {
 
   previousScore = bestThread->rootMoves[0].score;
 
+  // Remember the best PV and the positions along it: if the game follows it,
+  // the next search can resume from this one (see ThreadPool::start_thinking).
+  lastPv = bestThread->rootMoves[0].pv;
+  lastPvScore = bestThread->rootMoves[0].score;
+  lastPvDepth = bestThread->completedDepth;
+  lastPvKeys.clear();
+
+  if (   lastPv[0] != MOVE_NONE
+      && lastPvScore != -VALUE_INFINITE
+      && lastPvDepth > 0)
+  {
+      std::vector<StateInfo> pvStates(lastPv.size());
+
+      for (size_t i = 0; i < lastPv.size(); ++i)
+      {
+          rootPos.do_move(lastPv[i], pvStates[i]);
+          lastPvKeys.push_back(rootPos.key());
+      }
+
+      for (size_t i = lastPv.size(); i > 0; --i)
+          rootPos.undo_move(lastPv[i - 1]);
+  }
+
   // Send again PV info if we have a new best thread
   if (bestThread != this)
       sync_cout << UCI::pv(bestThread->rootPos, bestThread->completedDepth, -VALUE_INFINITE, VALUE_INFINITE) << sync_endl;
@@ -327,6 +436,38 @@ void MainThread::search() {
 
 void Thread::search() {
 
+  // Helper threads of a perft take root moves like the main thread
+  if (Limits.perft)
+  {
+      Perft::work(this);
+      return;
+  }
+
+  if (Limits.dfpn)
+  {
+      Mate::work(this);
+      return;
+  }
+
+  // Acquired here, so that threads which never search don't take memory for
+  // them, and the memory is local to this thread.
+  bool compact = Options["Compact History"];
+
+  if (histories && histories->compact != compact)
+  {
+      Histories::release(histories);
+      histories = nullptr;
+  }
+
+  if (!histories)
+      histories = Histories::acquire(idx, compact);
+
+  histories->lowPlyHistory.fill(0);
+
+  // Sized here, so that the overlay is allocated local to this thread
+  if (Threads.deterministic)
+      ttOverlay.resize(std::max(size_t(Options["Hash"]) / Threads.size(), size_t(1)));
+
   // To allow access to (ss-7) up to (ss+2), the stack must be oversized.
   // The former is needed to allow update_continuation_histories(ss-1, ...),
   // which accesses its argument at ss-6, also near the root.
@@ -343,7 +484,7 @@ void Thread::search() {
 
   std::memset(ss-7, 0, 10 * sizeof(Stack));
   for (int i = 7; i > 0; i--)
-      (ss-i)->continuationHistory = &this->continuationHistory[0][0][NO_PIECE][0]; // Use as a sentinel
+      (ss-i)->continuationHistory = histories->continuation(false, false, NO_PIECE, SQ_A1); // Use as a sentinel
 
   ss->pv = pv;
 
@@ -361,6 +502,7 @@ void Thread::search() {
   }
 
   size_t multiPV = Options["MultiPV"];
+  bool fastFewMoves = Options["Fast Few Moves"];
 
   // Pick integer skill levels, but non-deterministically round up or down
   // such that the average integer skill corresponds to the input floating point one.
@@ -515,15 +657,26 @@ void Thread::search() {
       }
 
       if (!Threads.stop)
+      {
           completedDepth = rootDepth;
 
+          if (mainThread)
+              onIterationFinished(rootMoves, multiPV, completedDepth);
+      }
+
       if (rootMoves[0].pv[0] != lastBestMove) {
          lastBestMove = rootMoves[0].pv[0];
          lastBestMoveDepth = rootDepth;
       }
 
+      // In deterministic mode the helpers wait here while the main thread
+      // merges the TT writes and decides whether to stop
+      if (Threads.deterministic)
+          Threads.end_iteration(this);
+
       // Have we found a "mate in x"?
       if (   Limits.mate
+          && (mainThread || !Threads.deterministic)
           && bestValue >= VALUE_MATE_IN_MAX_PLY
           && VALUE_MATE - bestValue <= 2 * Limits.mate)
           Threads.stop = true;
@@ -556,9 +709,15 @@ void Thread::search() {
           }
           double bestMoveInstability = 1 + totBestMoveChanges / Threads.size();
 
+          // With only a few legal moves there is less to decide. Off by default,
+          // the bot turns it on for its clock.
+          double rootChoice = fastFewMoves ? Utility::clamp(0.5 + 0.05 * rootMoves.size(), 0.6, 1.0) : 1.0;
+
+          double totalTime = Time.optimum() * fallingEval * reduction * bestMoveInstability * rootChoice;
+
           // Stop the search if we have only one legal move, or if available time elapsed
           if (   rootMoves.size() == 1
-              || Time.elapsed() > Time.optimum() * fallingEval * reduction * bestMoveInstability)
+              || Time.elapsed() > totalTime)
           {
               // If we are allowed to ponder do not stop the search now but
               // keep pondering until the GUI sends "ponderhit" or "stop".
@@ -569,7 +728,7 @@ void Thread::search() {
           }
           else if (   Threads.increaseDepth
                    && !mainThread->ponder
-                   && Time.elapsed() > Time.optimum() * fallingEval * reduction * bestMoveInstability * 0.6)
+                   && Time.elapsed() > totalTime * 0.6)
                    Threads.increaseDepth = false;
           else
                    Threads.increaseDepth = true;
@@ -577,6 +736,20 @@ void Thread::search() {
 
       mainThread->iterValue[iterIdx] = bestValue;
       iterIdx = (iterIdx + 1) & 3;
+
+      // A deterministic search stops only here, never in check_time(), and
+      // counts time in nodes (see TimeManagement::init())
+      if (Threads.deterministic)
+      {
+          if (   !mainThread->ponder
+              && (   (Limits.depth && rootDepth >= Limits.depth)
+                  || (Limits.nodes && Threads.nodes_searched() >= uint64_t(Limits.nodes))
+                  || (Limits.movetime && Time.elapsed() >= Limits.movetime)
+                  || (Limits.use_time_management() && Time.elapsed() > Time.maximum() - 10)))
+              Threads.stop = true;
+
+          Threads.start_next_iteration();
+      }
   }
 
   if (!mainThread)
@@ -647,6 +820,10 @@ namespace {
     if (thisThread == Threads.main())
         static_cast<MainThread*>(thisThread)->check_time();
 
+    dbg_stat(thisThread, nodes);
+    tree_node(thisThread, ss, alpha, beta, depth,   (PvNode ? SearchTree::PvNode : 0) | (cutNode ? SearchTree::CutNode : 0)
+                                                  | (inCheck ? SearchTree::InCheck : 0) | (ss->excludedMove ? SearchTree::Excluded : 0));
+
     // Used to send selDepth info to GUI (selDepth counts from 1, ply from 0)
     if (PvNode && thisThread->selDepth < ss->ply + 1)
         thisThread->selDepth = ss->ply + 1;
@@ -694,14 +871,20 @@ namespace {
     // position key in case of an excluded move.
     excludedMove = ss->excludedMove;
     posKey = pos.key() ^ Key(excludedMove << 16); // Isn't a very good hash
-    tte = TT.probe(posKey, ttHit);
+    tte = probe_tt(thisThread, posKey, ttHit);
+    dbg_stat(thisThread, ttProbes);
+    if (ttHit)
+    {
+        dbg_stat(thisThread, ttHits);
+        tree_flag(SearchTree::TTHit);
+    }
     ttValue = ttHit ? value_from_tt(tte->value(), ss->ply, pos.rule50_count()) : VALUE_NONE;
     ttMove =  rootNode ? thisThread->rootMoves[thisThread->pvIdx].pv[0]
             : ttHit    ? tte->move() : MOVE_NONE;
     ttPv = PvNode || (ttHit && tte->is_pv());
 
     if (ttPv && depth > 12 && ss->ply - 1 < MAX_LPH && !pos.captured_piece() && is_ok((ss-1)->currentMove))
-        thisThread->lowPlyHistory[ss->ply - 1][from_to((ss-1)->currentMove)] << stat_bonus(depth - 5);
+        thisThread->histories->lowPlyHistory[ss->ply - 1][from_to((ss-1)->currentMove)] << stat_bonus(depth - 5);
 
     // thisThread->ttHitAverage can be used to approximate the running average of ttHit
     thisThread->ttHitAverage =   (ttHitAverageWindow - 1) * thisThread->ttHitAverage / ttHitAverageWindow
@@ -731,7 +914,7 @@ namespace {
             else if (!pos.capture_or_promotion(ttMove))
             {
                 int penalty = -stat_bonus(depth);
-                thisThread->mainHistory[us][from_to(ttMove)] << penalty;
+                thisThread->histories->mainHistory[us][from_to(ttMove)] << penalty;
                 update_continuation_histories(ss, pos.moved_piece(ttMove), to_sq(ttMove), penalty);
             }
         }
@@ -774,9 +957,9 @@ namespace {
                 if (    b == BOUND_EXACT
                     || (b == BOUND_LOWER ? value >= beta : value <= alpha))
                 {
-                    tte->save(posKey, value_to_tt(value, ss->ply), ttPv, b,
-                              std::min(MAX_PLY - 1, depth + 6),
-                              MOVE_NONE, VALUE_NONE);
+                    save_tt(thisThread, tte, posKey, value_to_tt(value, ss->ply), ttPv, b,
+                            std::min(MAX_PLY - 1, depth + 6),
+                            MOVE_NONE, VALUE_NONE);
 
                     return value;
                 }
@@ -792,7 +975,7 @@ namespace {
         }
     }
 
-    CapturePieceToHistory& captureHistory = thisThread->captureHistory;
+    CapturePieceToHistory& captureHistory = thisThread->histories->captureHistory;
 
     // Step 6. Static evaluation of the position
     if (inCheck)
@@ -827,9 +1010,11 @@ namespace {
         else
             ss->staticEval = eval = -(ss-1)->staticEval + 2 * Tempo;
 
-        tte->save(posKey, VALUE_NONE, ttPv, BOUND_NONE, DEPTH_NONE, MOVE_NONE, eval);
+        save_tt(thisThread, tte, posKey, VALUE_NONE, ttPv, BOUND_NONE, DEPTH_NONE, MOVE_NONE, eval);
     }
 
+    tree_set(staticEval, int16_t(ss->staticEval));
+
     // Step 7. Razoring (~1 Elo)
     if (   !rootNode // The required rootNode PV handling is not available in qsearch
         &&  depth == 1
@@ -863,7 +1048,9 @@ namespace {
         Depth R = (854 + 68 * depth) / 258 + std::min(int(eval - beta) / 192, 3);
 
         ss->currentMove = MOVE_NULL;
-        ss->continuationHistory = &thisThread->continuationHistory[0][0][NO_PIECE][0];
+        ss->continuationHistory = thisThread->histories->continuation(false, false, NO_PIECE, SQ_A1);
+
+        dbg_stat(thisThread, nullMoveTries);
 
         pos.do_null_move(st);
 
@@ -873,6 +1060,8 @@ namespace {
 
         if (nullValue >= beta)
         {
+            dbg_stat(thisThread, nullMoveCutoffs);
+
             // Do not return unproven mate or TB scores
             if (nullValue >= VALUE_TB_WIN_IN_MAX_PLY)
                 nullValue = beta;
@@ -893,6 +1082,8 @@ namespace {
 
             if (v >= beta)
                 return nullValue;
+
+            dbg_stat(thisThread, nullMoveVerifyFails);
         }
     }
 
@@ -918,10 +1109,7 @@ namespace {
                 probCutCount++;
 
                 ss->currentMove = move;
-                ss->continuationHistory = &thisThread->continuationHistory[inCheck]
-                                                                          [captureOrPromotion]
-                                                                          [pos.moved_piece(move)]
-                                                                          [to_sq(move)];
+                ss->continuationHistory = thisThread->histories->continuation(inCheck, captureOrPromotion, pos.moved_piece(move), to_sq(move));
 
                 pos.do_move(move, st);
 
@@ -944,7 +1132,7 @@ namespace {
     {
         search<NT>(pos, ss, alpha, beta, depth - 7, cutNode);
 
-        tte = TT.probe(posKey, ttHit);
+        tte = probe_tt(thisThread, posKey, ttHit);
         ttValue = ttHit ? value_from_tt(tte->value(), ss->ply, pos.rule50_count()) : VALUE_NONE;
         ttMove = ttHit ? tte->move() : MOVE_NONE;
     }
@@ -955,10 +1143,10 @@ moves_loop: // When in check, search starts from here
                                           nullptr                   , (ss-4)->continuationHistory,
                                           nullptr                   , (ss-6)->continuationHistory };
 
-    Move countermove = thisThread->counterMoves[pos.piece_on(prevSq)][prevSq];
+    Move countermove = Move(uint16_t(thisThread->histories->counterMoves[pos.piece_on(prevSq)][prevSq]));
 
-    MovePicker mp(pos, ttMove, depth, &thisThread->mainHistory,
-                                      &thisThread->lowPlyHistory,
+    MovePicker mp(pos, ttMove, depth, &thisThread->histories->mainHistory,
+                                      &thisThread->histories->lowPlyHistory,
                                       &captureHistory,
                                       contHist,
                                       countermove,
@@ -1074,9 +1262,11 @@ moves_loop: // When in check, search starts from here
           ss->excludedMove = move;
           value = search<NonPV>(pos, ss, singularBeta - 1, singularBeta, singularDepth, cutNode);
           ss->excludedMove = MOVE_NONE;
+          dbg_stat(thisThread, singularTries);
 
           if (value < singularBeta)
           {
+              dbg_stat(thisThread, singularExtensions);
               extension = 1;
               singularLMR = true;
           }
@@ -1087,7 +1277,10 @@ moves_loop: // When in check, search starts from here
           // that multiple moves fail high, and we can prune the whole subtree by returning
           // a soft bound.
           else if (singularBeta >= beta)
+          {
+              dbg_stat(thisThread, multiCuts);
               return singularBeta;
+          }
       }
 
       // Check extension (~2 Elo)
@@ -1125,10 +1318,7 @@ moves_loop: // When in check, search starts from here
 
       // Update the current move (this must be done after singular extension search)
       ss->currentMove = move;
-      ss->continuationHistory = &thisThread->continuationHistory[inCheck]
-                                                                [captureOrPromotion]
-                                                                [movedPiece]
-                                                                [to_sq(move)];
+      ss->continuationHistory = thisThread->histories->continuation(inCheck, captureOrPromotion, movedPiece, to_sq(move));
 
       // Step 15. Make the move
       pos.do_move(move, st, givesCheck);
@@ -1186,7 +1376,7 @@ moves_loop: // When in check, search starts from here
                        && !pos.see_ge(reverse_move(move)))
                   r -= 2 + ttPv;
 
-              ss->statScore =  thisThread->mainHistory[us][from_to(move)]
+              ss->statScore =  thisThread->histories->mainHistory[us][from_to(move)]
                              + (*contHist[0])[movedPiece][to_sq(move)]
                              + (*contHist[1])[movedPiece][to_sq(move)]
                              + (*contHist[3])[movedPiece][to_sq(move)]
@@ -1221,6 +1411,9 @@ moves_loop: // When in check, search starts from here
           doFullDepthSearch = value > alpha && d != newDepth;
 
           didLMR = true;
+          dbg_stat(thisThread, lmrSearches);
+          if (doFullDepthSearch)
+              dbg_stat(thisThread, lmrResearches);
       }
       else
       {
@@ -1315,6 +1508,8 @@ moves_loop: // When in check, search starts from here
               else
               {
                   assert(value >= beta); // Fail high
+                  dbg_stat(thisThread, cutoffs[std::min(moveCount, SearchStats::CutoffSlots) - 1]);
+                  tree_set(cutoffMove, uint8_t(std::min(moveCount, 255)));
                   ss->statScore = 0;
                   break;
               }
@@ -1363,10 +1558,10 @@ moves_loop: // When in check, search starts from here
         bestValue = std::min(bestValue, maxValue);
 
     if (!excludedMove && !(rootNode && thisThread->pvIdx))
-        tte->save(posKey, value_to_tt(bestValue, ss->ply), ttPv,
-                  bestValue >= beta ? BOUND_LOWER :
-                  PvNode && bestMove ? BOUND_EXACT : BOUND_UPPER,
-                  depth, bestMove, ss->staticEval);
+        save_tt(thisThread, tte, posKey, value_to_tt(bestValue, ss->ply), ttPv,
+                bestValue >= beta ? BOUND_LOWER :
+                PvNode && bestMove ? BOUND_EXACT : BOUND_UPPER,
+                depth, bestMove, ss->staticEval);
 
     assert(bestValue > -VALUE_INFINITE && bestValue < VALUE_INFINITE);
 
@@ -1408,6 +1603,10 @@ moves_loop: // When in check, search starts from here
     inCheck = pos.checkers();
     moveCount = 0;
 
+    dbg_stat(thisThread, qnodes);
+    tree_node(thisThread, ss, alpha, beta, depth,   SearchTree::QSearch | (PvNode ? SearchTree::PvNode : 0)
+                                                  | (inCheck ? SearchTree::InCheck : 0));
+
     // Check for an immediate draw or maximum ply reached
     if (   pos.is_draw(ss->ply)
         || ss->ply >= MAX_PLY)
@@ -1422,7 +1621,13 @@ moves_loop: // When in check, search starts from here
                                                   : DEPTH_QS_NO_CHECKS;
     // Transposition table lookup
     posKey = pos.key();
-    tte = TT.probe(posKey, ttHit);
+    tte = probe_tt(thisThread, posKey, ttHit);
+    dbg_stat(thisThread, ttProbes);
+    if (ttHit)
+    {
+        dbg_stat(thisThread, ttHits);
+        tree_flag(SearchTree::TTHit);
+    }
     ttValue = ttHit ? value_from_tt(tte->value(), ss->ply, pos.rule50_count()) : VALUE_NONE;
     ttMove = ttHit ? tte->move() : MOVE_NONE;
     pvHit = ttHit && tte->is_pv();
@@ -1459,12 +1664,14 @@ moves_loop: // When in check, search starts from here
             (ss-1)->currentMove != MOVE_NULL ? evaluate(pos)
                                              : -(ss-1)->staticEval + 2 * Tempo;
 
+        tree_set(staticEval, int16_t(ss->staticEval));
+
         // Stand pat. Return immediately if static value is at least beta
         if (bestValue >= beta)
         {
             if (!ttHit)
-                tte->save(posKey, value_to_tt(bestValue, ss->ply), false, BOUND_LOWER,
-                          DEPTH_NONE, MOVE_NONE, ss->staticEval);
+                save_tt(thisThread, tte, posKey, value_to_tt(bestValue, ss->ply), false, BOUND_LOWER,
+                        DEPTH_NONE, MOVE_NONE, ss->staticEval);
 
             return bestValue;
         }
@@ -1483,8 +1690,8 @@ moves_loop: // When in check, search starts from here
     // to search the moves. Because the depth is <= 0 here, only captures,
     // queen promotions and checks (only if depth >= DEPTH_QS_CHECKS) will
     // be generated.
-    MovePicker mp(pos, ttMove, depth, &thisThread->mainHistory,
-                                      &thisThread->captureHistory,
+    MovePicker mp(pos, ttMove, depth, &thisThread->histories->mainHistory,
+                                      &thisThread->histories->captureHistory,
                                       contHist,
                                       to_sq((ss-1)->currentMove));
 
@@ -1542,10 +1749,7 @@ moves_loop: // When in check, search starts from here
       }
 
       ss->currentMove = move;
-      ss->continuationHistory = &thisThread->continuationHistory[inCheck]
-                                                                [captureOrPromotion]
-                                                                [pos.moved_piece(move)]
-                                                                [to_sq(move)];
+      ss->continuationHistory = thisThread->histories->continuation(inCheck, captureOrPromotion, pos.moved_piece(move), to_sq(move));
 
       // Make and search the move
       pos.do_move(move, st, givesCheck);
@@ -1569,7 +1773,10 @@ moves_loop: // When in check, search starts from here
               if (PvNode && value < beta) // Update alpha here!
                   alpha = value;
               else
+              {
+                  tree_set(cutoffMove, uint8_t(std::min(moveCount, 255)));
                   break; // Fail high
+              }
           }
        }
     }
@@ -1579,10 +1786,10 @@ moves_loop: // When in check, search starts from here
     if (inCheck && bestValue == -VALUE_INFINITE)
         return mated_in(ss->ply); // Plies to mate from the root
 
-    tte->save(posKey, value_to_tt(bestValue, ss->ply), pvHit,
-              bestValue >= beta ? BOUND_LOWER :
-              PvNode && bestValue > oldAlpha  ? BOUND_EXACT : BOUND_UPPER,
-              ttDepth, bestMove, ss->staticEval);
+    save_tt(thisThread, tte, posKey, value_to_tt(bestValue, ss->ply), pvHit,
+            bestValue >= beta ? BOUND_LOWER :
+            PvNode && bestValue > oldAlpha  ? BOUND_EXACT : BOUND_UPPER,
+            ttDepth, bestMove, ss->staticEval);
 
     assert(bestValue > -VALUE_INFINITE && bestValue < VALUE_INFINITE);
 
@@ -1652,7 +1859,7 @@ moves_loop: // When in check, search starts from here
     int bonus1, bonus2;
     Color us = pos.side_to_move();
     Thread* thisThread = pos.this_thread();
-    CapturePieceToHistory& captureHistory = thisThread->captureHistory;
+    CapturePieceToHistory& captureHistory = thisThread->histories->captureHistory;
     Piece moved_piece = pos.moved_piece(bestMove);
     PieceType captured = type_of(pos.piece_on(to_sq(bestMove)));
 
@@ -1667,7 +1874,7 @@ moves_loop: // When in check, search starts from here
         // Decrease all the non-best quiet moves
         for (int i = 0; i < quietCount; ++i)
         {
-            thisThread->mainHistory[us][from_to(quietsSearched[i])] << -bonus2;
+            thisThread->histories->mainHistory[us][from_to(quietsSearched[i])] << -bonus2;
             update_continuation_histories(ss, pos.moved_piece(quietsSearched[i]), to_sq(quietsSearched[i]), -bonus2);
         }
     }
@@ -1712,20 +1919,20 @@ moves_loop: // When in check, search starts from here
 
     Color us = pos.side_to_move();
     Thread* thisThread = pos.this_thread();
-    thisThread->mainHistory[us][from_to(move)] << bonus;
+    thisThread->histories->mainHistory[us][from_to(move)] << bonus;
     update_continuation_histories(ss, pos.moved_piece(move), to_sq(move), bonus);
 
     if (type_of(pos.moved_piece(move)) != PAWN)
-        thisThread->mainHistory[us][from_to(reverse_move(move))] << -bonus;
+        thisThread->histories->mainHistory[us][from_to(reverse_move(move))] << -bonus;
 
     if (is_ok((ss-1)->currentMove))
     {
         Square prevSq = to_sq((ss-1)->currentMove);
-        thisThread->counterMoves[pos.piece_on(prevSq)][prevSq] = move;
+        thisThread->histories->counterMoves[pos.piece_on(prevSq)][prevSq] = move;
     }
 
     if (depth > 12 && ss->ply < MAX_LPH)
-        thisThread->lowPlyHistory[ss->ply][from_to(move)] << stat_bonus(depth - 7);
+        thisThread->histories->lowPlyHistory[ss->ply][from_to(move)] << stat_bonus(depth - 7);
   }
 
   // When playing with strength handicap, choose best move among a set of RootMoves
@@ -1785,8 +1992,9 @@ void MainThread::check_time() {
       dbg_print();
   }
 
-  // We should not stop pondering until told so by the GUI
-  if (ponder)
+  // We should not stop pondering until told so by the GUI, and a
+  // deterministic search stops only between iterations
+  if (ponder || Threads.deterministic)
       return;
 
   if (   (Limits.use_time_management() && (elapsed > Time.maximum() - 10 || stopOnPonderhit))
@@ -80,6 +80,10 @@ struct RootMove {
 
 typedef std::vector<RootMove> RootMoves;
 
+/// Called by the main thread each time an iteration of the iterative deepening
+/// loop completes, with the first multiPV root moves sorted by score.
+void onIterationFinished(const RootMoves& rootMoves, size_t multiPV, Depth depth);
+
 
 /// LimitsType struct stores information sent by GUI about available time to
 /// search the current move, maximum depth/time, or if we are in analysis mode.
@@ -90,16 +94,18 @@ struct LimitsType {
     time[WHITE] = time[BLACK] = inc[WHITE] = inc[BLACK] = npmsec = movetime = TimePoint(0);
     movestogo = depth = mate = perft = infinite = 0;
     nodes = 0;
+    perftDetails = dfpn = false;
   }
 
   bool use_time_management() const {
-    return !(mate | movetime | depth | nodes | perft | infinite);
+    return !(mate | movetime | depth | nodes | perft | infinite | dfpn);
   }
 
   std::vector<Move> searchmoves;
   TimePoint time[COLOR_NB], inc[COLOR_NB], npmsec, movetime, startTime;
   int movestogo, depth, mate, perft, infinite;
   int64_t nodes;
+  bool perftDetails, dfpn;
 };
 
 extern LimitsType Limits;
@@ -0,0 +1,175 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iomanip>
+#include <sstream>
+
+#include "searchstats.h"
+#include "thread.h"
+#include "tt.h"
+
+namespace stockfish::SearchStats {
+
+Counters& Counters::operator+=(const Counters& c) {
+
+  nodes               += c.nodes;
+  qnodes              += c.qnodes;
+  ttProbes            += c.ttProbes;
+  ttHits              += c.ttHits;
+  ttReplacements      += c.ttReplacements;
+  nullMoveTries       += c.nullMoveTries;
+  nullMoveCutoffs     += c.nullMoveCutoffs;
+  nullMoveVerifyFails += c.nullMoveVerifyFails;
+  lmrSearches         += c.lmrSearches;
+  lmrResearches       += c.lmrResearches;
+  singularTries       += c.singularTries;
+  singularExtensions  += c.singularExtensions;
+  multiCuts           += c.multiCuts;
+
+  for (int i = 0; i < CutoffSlots; ++i)
+      cutoffs[i] += c.cutoffs[i];
+
+  return *this;
+}
+
+namespace {
+
+  double percent(uint64_t part, uint64_t total) {
+    return total ? 100.0 * part / total : 0.0;
+  }
+
+} // namespace
+
+
+/// report() sums up the counters of all the threads, and of their evaluation
+/// caches, since the last Search::clear(), and scans the transposition table
+/// for the histograms of its entries. The result is either plain text or a
+/// JSON object.
+
+std::string report(bool json) {
+
+  if (!Enabled)
+      return json ? "{}" : "Search statistics are not collected in release builds";
+
+  Counters c = Counters();
+
+#ifndef NDEBUG
+  for (Thread* th : Threads)
+      c += th->stats;
+#endif
+
+  // The evaluation cache counts its probes itself, in all builds
+  uint64_t evalProbes = 0, evalHits = 0;
+  for (Thread* th : Threads)
+  {
+      evalProbes += th->evalCache.probes;
+      evalHits   += th->evalCache.hits;
+  }
+
+  uint64_t byDepth[256], byAge[32];
+  TT.histogram(byDepth, byAge);
+
+  uint64_t cutoffs = 0;
+  for (int i = 0; i < CutoffSlots; ++i)
+      cutoffs += c.cutoffs[i];
+
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1);
+
+  if (json)
+  {
+      ss << "{\"nodes\":" << c.nodes
+         << ",\"qnodes\":" << c.qnodes
+         << ",\"tt\":{\"probes\":" << c.ttProbes
+         << ",\"hits\":" << c.ttHits
+         << ",\"replacements\":" << c.ttReplacements << "}"
+         << ",\"evalCache\":{\"probes\":" << evalProbes
+         << ",\"hits\":" << evalHits << "}"
+         << ",\"cutoffs\":[";
+
+      for (int i = 0; i < CutoffSlots; ++i)
+          ss << (i ? "," : "") << c.cutoffs[i];
+
+      ss << "],\"nullMove\":{\"tries\":" << c.nullMoveTries
+         << ",\"cutoffs\":" << c.nullMoveCutoffs
+         << ",\"verifyFails\":" << c.nullMoveVerifyFails << "}"
+         << ",\"lmr\":{\"searches\":" << c.lmrSearches
+         << ",\"researches\":" << c.lmrResearches << "}"
+         << ",\"singular\":{\"tries\":" << c.singularTries
+         << ",\"extensions\":" << c.singularExtensions
+         << ",\"multiCuts\":" << c.multiCuts << "}"
+         << ",\"ttDepth\":{";
+
+      bool first = true;
+      for (int d = 0; d < 256; ++d)
+          if (byDepth[d])
+          {
+              ss << (first ? "" : ",") << "\"" << d + DEPTH_OFFSET << "\":" << byDepth[d];
+              first = false;
+          }
+
+      ss << "},\"ttAge\":[";
+
+      for (int a = 0; a < 32; ++a)
+          ss << (a ? "," : "") << byAge[a];
+
+      ss << "]}";
+      return ss.str();
+  }
+
+  ss << "Nodes            : " << c.nodes << " search, " << c.qnodes << " qsearch"
+     << "\nTT probes        : " << c.ttProbes
+     << "\nTT hits          : " << c.ttHits << " (" << percent(c.ttHits, c.ttProbes) << "%)"
+     << "\nTT replacements  : " << c.ttReplacements
+     << "\nEval cache       : " << evalProbes << " probes, " << evalHits << " hits ("
+                                << percent(evalHits, evalProbes) << "%)"
+     << "\nBeta cutoffs     : " << cutoffs
+     << "\nCutoff move      :";
+
+  for (int i = 0; i < CutoffSlots; ++i)
+      ss << " #" << i + 1 << (i == CutoffSlots - 1 ? "+ " : " ")
+         << percent(c.cutoffs[i], cutoffs) << "%";
+
+  ss << "\nNull move        : " << c.nullMoveTries << " tries, "
+                                << c.nullMoveCutoffs << " cutoffs ("
+                                << percent(c.nullMoveCutoffs, c.nullMoveTries) << "%), "
+                                << c.nullMoveVerifyFails << " failed verifications"
+     << "\nLMR              : " << c.lmrSearches << " reduced searches, "
+                                << c.lmrResearches << " re-searched ("
+                                << percent(c.lmrResearches, c.lmrSearches) << "%)"
+     << "\nSingular         : " << c.singularTries << " tries, "
+                                << c.singularExtensions << " extensions, "
+                                << c.multiCuts << " multi-cuts"
+     << "\nTT entries by depth:";
+
+  for (int d = 0; d < 256; ++d)
+      if (byDepth[d])
+          ss << "\n  " << std::setw(4) << d + DEPTH_OFFSET << " : " << byDepth[d];
+
+  ss << "\nTT entries by age (searches):";
+
+  for (int a = 0; a < 32; ++a)
+      if (byAge[a])
+          ss << "\n  " << std::setw(4) << a << " : " << byAge[a];
+
+  return ss.str();
+}
+
+} // namespace stockfish::SearchStats
@@ -0,0 +1,67 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SEARCHSTATS_H_INCLUDED
+#define SEARCHSTATS_H_INCLUDED
+
+#include <string>
+
+#include "types.h"
+
+namespace stockfish::SearchStats {
+
+/// Search statistics are collected only in debug builds. With -DNDEBUG the
+/// dbg_stat() macro expands to nothing and threads carry no counters.
+
+#ifdef NDEBUG
+constexpr bool Enabled = false;
+#else
+constexpr bool Enabled = true;
+#endif
+
+constexpr int CutoffSlots = 8; // Cutoffs from the 8th move on share the last slot
+
+/// Counters holds the statistics of one thread. It fills whole cache lines,
+/// so that threads updating their own counters never share a line.
+
+struct alignas(64) Counters {
+
+  void clear() { *this = Counters(); }
+  Counters& operator+=(const Counters& c);
+
+  uint64_t nodes, qnodes;
+  uint64_t ttProbes, ttHits, ttReplacements;
+  uint64_t cutoffs[CutoffSlots];
+  uint64_t nullMoveTries, nullMoveCutoffs, nullMoveVerifyFails;
+  uint64_t lmrSearches, lmrResearches;
+  uint64_t singularTries, singularExtensions, multiCuts;
+};
+
+std::string report(bool json = false);
+
+} // namespace stockfish::SearchStats
+
+#ifdef NDEBUG
+#define dbg_stat(th, counter) ((void)0)
+#else
+#define dbg_stat(th, counter) (++(th)->stats.counter)
+#endif
+
+#endif // #ifndef SEARCHSTATS_H_INCLUDED
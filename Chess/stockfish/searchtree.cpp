@@ -0,0 +1,98 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "searchtree.h"
+
+#ifdef SEARCH_TREE
+
+#include <fstream>
+#include <iostream>
+
+#include "position.h"
+#include "thread.h"
+#include "uci.h"
+
+namespace stockfish::SearchTree {
+
+thread_local Record Scope::dummy;
+
+namespace {
+
+  std::string path; // Of the file being recorded, empty if none
+
+} // namespace
+
+
+/// start() prepares the buffers of all threads before a search, they're
+/// left empty if no file is set
+
+void start() {
+
+  path = std::string(Options["Tree File"]);
+
+  for (Thread* th : Threads)
+  {
+      Buffer& buf = th->tree;
+      buf.records.clear();
+      buf.current = NoParent;
+      buf.maxPly = Options["Tree Plies"];
+      buf.capacity = path.empty() ? 0 : size_t(Options["Tree Nodes"]);
+      buf.records.reserve(buf.capacity);
+  }
+}
+
+
+/// finish() writes the records of all threads, once they're done searching
+
+void finish(const Position& root) {
+
+  if (path.empty())
+      return;
+
+  std::ofstream f(path, std::ios::binary);
+  if (!f)
+  {
+      sync_cout << "info string can't write the search tree to " << path << sync_endl;
+      return;
+  }
+
+  std::string fen = root.fen();
+  FileHeader header = { {'S', 'F', 'T', 'R'}, FileVersion, uint16_t(sizeof(Record)),
+                        uint32_t(Threads.size()), uint32_t(fen.size()) };
+
+  f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  f.write(fen.data(), fen.size());
+
+  uint64_t total = 0;
+  for (Thread* th : Threads)
+  {
+      const auto& records = th->tree.records;
+      uint64_t count = records.size();
+      f.write(reinterpret_cast<const char*>(&count), sizeof(count));
+      f.write(reinterpret_cast<const char*>(records.data()), count * sizeof(Record));
+      total += count;
+  }
+
+  sync_cout << "info string search tree of " << total << " nodes written to " << path << sync_endl;
+}
+
+} // namespace stockfish::SearchTree
+
+#endif // #ifdef SEARCH_TREE
@@ -0,0 +1,148 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SEARCHTREE_H_INCLUDED
+#define SEARCHTREE_H_INCLUDED
+
+#include <vector>
+
+#include "types.h"
+
+namespace stockfish {
+
+class Position;
+
+namespace SearchTree {
+
+/// The search tree recorder is compiled in only with -DSEARCH_TREE. Then, if
+/// the "Tree File" option is set, every search records the nodes of search()
+/// and qsearch() up to "Tree Plies" plies deep, and writes them to that file
+/// when it's done. Without -DSEARCH_TREE the tree_*() macros expand to
+/// nothing and threads carry no buffer. tools/TreeReader.cpp reads the files.
+
+enum NodeFlags : uint8_t {
+  PvNode   = 1,
+  CutNode  = 2,
+  QSearch  = 4,
+  TTHit    = 8,
+  InCheck  = 16,
+  Excluded = 32  // Singular extension search, which excludes the TT move
+};
+
+constexpr uint32_t NoParent = 0xFFFFFFFF;
+
+/// Record is a node of the tree. Records are stored in the order the nodes
+/// are entered, each pointing at its parent, so the children of a node
+/// follow it in search order.
+
+struct Record {
+  uint32_t parent;     // Index of the parent in the same thread, or NoParent
+  uint16_t move;       // The move leading to the node, MOVE_NONE at the root
+  int16_t  alpha, beta, staticEval;
+  int8_t   depth;      // Zero or less in qsearch
+  uint8_t  ply;
+  uint8_t  flags;      // NodeFlags
+  uint8_t  cutoffMove; // Number of the move that failed high, 0 if none did
+};
+
+static_assert(sizeof(Record) == 16, "Record should be 16 bytes");
+
+/// The file starts with a FileHeader, followed by the FEN of the root and,
+/// for each thread, the number of its records as an uint64_t and the records.
+
+struct FileHeader {
+  char     magic[4];   // "SFTR"
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t threads;
+  uint32_t fenLength;
+};
+
+constexpr uint16_t FileVersion = 1;
+
+/// Buffer is the append-only store of one thread. It's written only by its
+/// thread and preallocated before the search, so appending takes no lock
+/// and never moves the records.
+
+struct Buffer {
+  std::vector<Record> records;
+  size_t capacity = 0;
+  uint32_t current = NoParent; // The innermost node being searched
+  int maxPly = 0;
+};
+
+/// Scope records a node for as long as the search stays in it. Nodes past
+/// the maximum ply or beyond the capacity of the buffer get a dummy record.
+
+class Scope {
+public:
+  Scope(Buffer& buf, int ply, Move m, Value alpha, Value beta, Depth depth, int flags) : buffer(buf) {
+
+    if (ply > buf.maxPly || buf.records.size() >= buf.capacity)
+    {
+        rec = &dummy;
+        return;
+    }
+
+    buf.records.push_back({ buf.current, uint16_t(m), int16_t(alpha), int16_t(beta), int16_t(VALUE_NONE),
+                            int8_t(depth), uint8_t(ply), uint8_t(flags), 0 });
+    buf.current = uint32_t(buf.records.size() - 1);
+    rec = &buf.records.back();
+  }
+
+  ~Scope() {
+    if (rec != &dummy)
+        buffer.current = rec->parent;
+  }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+  Record* rec;
+
+private:
+  Buffer& buffer;
+  static thread_local Record dummy;
+};
+
+#ifdef SEARCH_TREE
+void start();
+void finish(const Position& root);
+#else
+inline void start() {}
+inline void finish(const Position&) {}
+#endif
+
+} // namespace SearchTree
+
+} // namespace stockfish
+
+#ifdef SEARCH_TREE
+#define tree_node(th, ss, alpha, beta, depth, flags) \
+        SearchTree::Scope treeNode((th)->tree, (ss)->ply, ((ss)-1)->currentMove, alpha, beta, depth, flags)
+#define tree_set(field, value) (treeNode.rec->field = (value))
+#define tree_flag(flag) (treeNode.rec->flags |= (flag))
+#else
+#define tree_node(th, ss, alpha, beta, depth, flags) ((void)0)
+#define tree_set(field, value) ((void)0)
+#define tree_flag(flag) ((void)0)
+#endif
+
+#endif // #ifndef SEARCHTREE_H_INCLUDED
@@ -30,9 +30,12 @@
 #include <mutex>
 
 #include "../bitboard.h"
+#include "../misc.h"
 #include "../movegen.h"
 #include "../position.h"
 #include "../search.h"
+#include "../tbgen.h"
+#include "../thread.h"
 #include "../types.h"
 #include "../uci.h"
 
@@ -290,6 +293,26 @@ public:
 #else
         UnmapViewOfFile(baseAddress);
         CloseHandle((HANDLE)mapping);
+#endif
+    }
+
+    // Get the mapped file into memory ahead of the probes. With madvise() the
+    // kernel reads it in the background, otherwise we touch every page, which
+    // takes as long as reading the file.
+    static void prefetch(void* baseAddress, uint64_t mapping) {
+
+#ifndef _WIN32
+        madvise(baseAddress, mapping, MADV_WILLNEED);
+#else
+        (void)mapping;
+        MEMORY_BASIC_INFORMATION mbi;
+        uint8_t sum = 0;
+
+        if (VirtualQuery(baseAddress, &mbi, sizeof(mbi)))
+            for (size_t i = 0; i < mbi.RegionSize; i += 4096)
+                sum += ((volatile uint8_t*)baseAddress)[i];
+
+        (void)sum;
 #endif
     }
 };
@@ -335,6 +358,7 @@ struct TBTable {
     void* baseAddress;
     uint8_t* map;
     uint64_t mapping;
+    std::string code; // Like "KRvK", the name of the file without extension
     Key key;
     Key key2;
     int pieceCount;
@@ -363,6 +387,7 @@ TBTable<WDL>::TBTable(const std::string& code) : TBTable() {
     StateInfo st;
     Position pos;
 
+    this->code = code;
     key = pos.set(code, WHITE, &st).material_key();
     pieceCount = pos.count<ALL_PIECES>();
     hasPawns = pos.pieces(PAWN);
@@ -389,6 +414,7 @@ template<>
 TBTable<DTZ>::TBTable(const TBTable<WDL>& wdl) : TBTable() {
 
     // Use the corresponding WDL table to avoid recalculating all from scratch
+    code = wdl.code;
     key = wdl.key;
     key2 = wdl.key2;
     pieceCount = wdl.pieceCount;
@@ -454,10 +480,23 @@ public:
     }
     size_t size() const { return wdlTable.size(); }
     void add(const std::vector<PieceType>& pieces);
+    void warm_up(int maxPieces);
 };
 
 TBTables TBTables;
 
+// The results of probe_wdl() and probe_dtz() by position key, shared by all
+// the threads. Those of probe_dtz() are under the key xored with DTZKey.
+struct CachedProbe {
+    Key key;
+    int value;
+    ProbeState state;
+};
+
+SharedHashTable<CachedProbe> ProbeCache;
+
+constexpr Key DTZKey = 0x9E3779B97F4A7C15ULL;
+
 // If the corresponding file exists two new objects TBTable<WDL> and TBTable<DTZ>
 // are created and added to the lists and hash table. Called at init time.
 void TBTables::add(const std::vector<PieceType>& pieces) {
@@ -1116,12 +1155,12 @@ void set(T& e, uint8_t* data) {
         }
 }
 
-// If the TB file corresponding to the given position is already memory mapped
-// then return its base address, otherwise try to memory map and init it. Called
-// at every probe, memory map and init only at first access. Function is thread
-// safe and can be called concurrently.
+// If the TB file is already memory mapped then return its base address,
+// otherwise try to memory map and init it. Called at every probe, memory map
+// and init only at first access. Function is thread safe and can be called
+// concurrently.
 template<TBType Type>
-void* mapped(TBTable<Type>& e, const Position& pos) {
+void* map_table(TBTable<Type>& e, const std::string& fname) {
 
     static std::mutex mutex;
 
@@ -1135,6 +1174,22 @@ void* mapped(TBTable<Type>& e, const Position& pos) {
     if (e.ready.load(std::memory_order_relaxed)) // Recheck under lock
         return e.baseAddress;
 
+    uint8_t* data = TBFile(fname).map(&e.baseAddress, &e.mapping, Type);
+
+    if (data)
+        set(e, data);
+
+    e.ready.store(true, std::memory_order_release);
+    return e.baseAddress;
+}
+
+// The table of the given position, mapped by map_table()
+template<TBType Type>
+void* mapped(TBTable<Type>& e, const Position& pos) {
+
+    if (e.ready.load(std::memory_order_acquire))
+        return e.baseAddress;
+
     // Pieces strings in decreasing order for each color, like ("KPP","KR")
     std::string fname, w, b;
     for (PieceType pt = KING; pt >= PAWN; --pt) {
@@ -1145,13 +1200,23 @@ void* mapped(TBTable<Type>& e, const Position& pos) {
     fname =  (e.key == pos.material_key() ? w + 'v' + b : b + 'v' + w)
            + (Type == WDL ? ".rtbw" : ".rtbz");
 
-    uint8_t* data = TBFile(fname).map(&e.baseAddress, &e.mapping, Type);
+    return map_table(e, fname);
+}
 
-    if (data)
-        set(e, data);
+// Map the tables of up to maxPieces pieces, and prefetch their files
+void TBTables::warm_up(int maxPieces) {
 
-    e.ready.store(true, std::memory_order_release);
-    return e.baseAddress;
+    for (size_t i = 0; i < wdlTable.size(); ++i)
+    {
+        if (wdlTable[i].pieceCount > maxPieces)
+            continue;
+
+        if (map_table(wdlTable[i], wdlTable[i].code + ".rtbw"))
+            TBFile::prefetch(wdlTable[i].baseAddress, wdlTable[i].mapping);
+
+        if (map_table(dtzTable[i], dtzTable[i].code + ".rtbz"))
+            TBFile::prefetch(dtzTable[i].baseAddress, dtzTable[i].mapping);
+    }
 }
 
 template<TBType Type, typename Ret = typename TBTable<Type>::Ret>
@@ -1245,17 +1310,56 @@ WDLScore search(Position& pos, ProbeState* result) {
 
 
 
+// Look up the result of a probe of pos in the cache, else run probe() and
+// cache its result unless it failed. The thread of pos counts the probes and
+// the cache hits. Builds with search statistics also count the page faults,
+// mostly first touches of the mapped files, of the probes that missed: two
+// system calls per miss are too many for the others.
+template<typename Probe>
+int probe_cached(Position& pos, Key key, ProbeState* result, Probe probe) {
+
+    Thread* th = pos.this_thread();
+    CachedProbe e;
+
+    if (th)
+        ++th->tbProbes;
+
+    if (ProbeCache.load(key, e))
+    {
+        if (th)
+            ++th->tbCacheHits;
+
+        *result = e.state;
+        return e.value;
+    }
+
+    uint64_t faults = SearchStats::Enabled ? page_faults() : 0;
+    int value = probe();
+
+    if (SearchStats::Enabled && th)
+        th->tbFaults += page_faults() - faults;
+
+    if (*result != FAIL)
+        ProbeCache.store(key, { key, value, *result });
+
+    return value;
+}
+
 /// Tablebases::init() is called at startup and after every change to
 /// "SyzygyPath" UCI option to (re)create the various tables. It is not thread
 /// safe, nor it needs to be.
 void Tablebases::init(const std::string& paths) {
 
     TBTables.clear();
-    MaxCardinality = 0;
+    ProbeCache.resize(0); // Its results are of the old tables
+    MaxCardinality = TBGen::max_pieces();
     TBFile::Paths = paths;
 
     if (paths.empty() || paths == "<empty>")
+    {
+        set_cache(size_t(Options["SyzygyCache"]));
         return;
+    }
 
     // MapB1H1H7[] encodes a square below a1-h8 diagonal to 0..27
     int code = 0;
@@ -1390,6 +1494,31 @@ void Tablebases::init(const std::string& paths) {
     }
 
     sync_cout << "info string Found " << TBTables.size() << " tablebases" << sync_endl;
+
+    set_cache(size_t(Options["SyzygyCache"]));
+
+    if (TBTables.size() && Options["SyzygyWarmup"])
+        warm_up(Options["SyzygyProbeLimit"]);
+}
+
+/// Tablebases::set_cache() sizes, in MB, the cache of the WDL and DTZ probe
+/// results shared by all the threads, and clears it. 0 disables it.
+void Tablebases::set_cache(size_t mbSize) {
+
+    ProbeCache.resize(MaxCardinality ? mbSize : 0);
+}
+
+size_t Tablebases::cache_memory() {
+
+    return ProbeCache.memory();
+}
+
+/// Tablebases::warm_up() maps the tables of up to maxPieces pieces and asks
+/// the OS to read them in ahead, so that the first probes of a game don't
+/// stall the search on disk reads.
+void Tablebases::warm_up(int maxPieces) {
+
+    TBTables.warm_up(maxPieces);
 }
 
 // Probe the WDL table for a particular position.
@@ -1402,8 +1531,16 @@ void Tablebases::init(const std::string& paths) {
 //  2 : win
 WDLScore Tablebases::probe_wdl(Position& pos, ProbeState* result) {
 
-    *result = OK;
-    return search<false>(pos, result);
+    return WDLScore(probe_cached(pos, pos.key(), result, [&] {
+        *result = OK;
+        WDLScore wdl = search<false>(pos, result);
+
+        // Else the tables generated in memory may have it
+        if (*result == FAIL)
+            wdl = TBGen::probe_wdl(pos, result);
+
+        return int(wdl);
+    }));
 }
 
 // Probe the DTZ table for a particular position.
@@ -1432,7 +1569,7 @@ WDLScore Tablebases::probe_wdl(Position& pos, ProbeState* result) {
 //
 // In short, if a move is available resulting in dtz + 50-move-counter <= 99,
 // then do not accept moves leading to dtz + 50-move-counter == 100.
-int Tablebases::probe_dtz(Position& pos, ProbeState* result) {
+int probe_dtz_uncached(Position& pos, ProbeState* result) {
 
     *result = OK;
     WDLScore wdl = search<true>(pos, result);
@@ -1494,6 +1631,11 @@ int Tablebases::probe_dtz(Position& pos, ProbeState* result) {
     return minDTZ == 0xFFFF ? -1 : minDTZ;
 }
 
+int Tablebases::probe_dtz(Position& pos, ProbeState* result) {
+
+    return probe_cached(pos, pos.key() ^ DTZKey, result, [&] { return probe_dtz_uncached(pos, result); });
+}
+
 
 // Use the DTZ tables to rank root moves.
 //
@@ -48,6 +48,9 @@ enum ProbeState {
 extern int MaxCardinality;
 
 void init(const std::string& paths);
+void set_cache(size_t mbSize);
+size_t cache_memory();
+void warm_up(int maxPieces);
 WDLScore probe_wdl(Position& pos, ProbeState* result);
 int probe_dtz(Position& pos, ProbeState* result);
 bool root_probe(Position& pos, Search::RootMoves& rootMoves);
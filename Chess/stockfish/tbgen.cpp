@@ -0,0 +1,905 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bitboard.h"
+#include "movegen.h"
+#include "position.h"
+#include "tbgen.h"
+#include "thread.h"
+
+namespace stockfish {
+
+using namespace Tablebases;
+
+namespace {
+
+  // The value of a position for the side to move, 2 bits in the tables
+  enum Wdl : uint8_t { VDRAW, VWIN, VLOSS };
+
+  // The states of the positions during the generation. The unknown ones below
+  // NO_LOSS count the moves to positions of the table not yet known to be won
+  // by the opponent, see weight(): the position is lost when none is left.
+  enum State : uint8_t { LOSS = 0, NO_LOSS = 252, DRAW, WIN, ILLEGAL };
+
+  enum Status { MISSING, QUEUED, READY };
+
+  constexpr int NoEnPassant = -2;
+
+  // A position of a table, with the squares of the pieces in the order of
+  // Table::pieces
+  struct Board {
+    Square sq[TBGen::MaxPieces];
+    Color stm;
+  };
+
+  struct Table {
+    std::string code;                // Like "KRvKN"
+    int pieceCount;
+    bool hasPawns;
+    Piece pieces[TBGen::MaxPieces];  // White king, black king, then the others
+    size_t size;                     // Number of indices, many of them illegal
+    std::vector<uint8_t> wdl;        // The Wdl value of each index, 4 per byte
+    std::atomic<int> status{MISSING};
+  };
+
+  // Materials are numbered by the counts of the kinds of pieces in base 3
+  constexpr int Pow3[] = { 1, 3, 9, 27, 81, 243, 729, 2187, 6561, 19683, 59049 };
+
+  std::deque<Table> Tables;
+  Table* BySignature[Pow3[10]];
+  Square TriangleSq[10];      // The squares of the a1-d1-d4 triangle
+  int TriangleIdx[SQUARE_NB];
+  std::once_flag TablesAdded;
+  std::atomic<int> PieceLimit;
+  std::string CachePath;
+  std::mutex CachePathMutex;  // Held to read or write CachePath
+  std::mutex BuildMutex;      // Held while building
+  std::atomic<bool> Stop;     // Aborts the builds at exit
+
+
+  int signature(const Piece* pc, int n, bool flip) {
+
+    int sig = 0;
+    for (int i = 0; i < n; ++i)
+        if (type_of(pc[i]) != KING)
+            sig += Pow3[(color_of(pc[i]) ^ flip) * 5 + type_of(pc[i]) - PAWN];
+
+    return sig;
+  }
+
+  // find() returns the table of the material of the n pieces pc, and whether
+  // it has the colors the other way round
+  Table* find(const Piece* pc, int n, bool& flip) {
+
+    Table* t = BySignature[signature(pc, n, false)];
+    flip = !t;
+    return t ? t : BySignature[signature(pc, n, true)];
+  }
+
+  Square flip_diagonal(Square s) { return Square(((s >> 3) | (s << 3)) & 63); }
+
+  // index() maps a board to its index in the table. The board is first moved
+  // by the symmetries of the chessboard so that the white king is on files A
+  // to D and, without pawns, in the a1-d1-d4 triangle with the first piece out
+  // of the a1-h8 diagonal below it. So each position has a single index, and
+  // the other indices are illegal.
+  size_t index(const Table& t, Board b) {
+
+    const int n = t.pieceCount;
+
+    if (file_of(b.sq[0]) > FILE_D)
+        for (int i = 0; i < n; ++i)
+            b.sq[i] = flip_file(b.sq[i]);
+
+    if (!t.hasPawns)
+    {
+        if (rank_of(b.sq[0]) > RANK_4)
+            for (int i = 0; i < n; ++i)
+                b.sq[i] = flip_rank(b.sq[i]);
+
+        int d = 0;
+        for (int i = 0; !d && i < n; ++i)
+            d = int(rank_of(b.sq[i])) - int(file_of(b.sq[i]));
+
+        if (d > 0)
+            for (int i = 0; i < n; ++i)
+                b.sq[i] = flip_diagonal(b.sq[i]);
+    }
+
+    size_t idx = t.hasPawns ? size_t(rank_of(b.sq[0]) * 4 + file_of(b.sq[0]))
+                            : size_t(TriangleIdx[b.sq[0]]);
+    for (int i = 1; i < n; ++i)
+        idx = idx * 64 + b.sq[i];
+
+    return idx * 2 + b.stm;
+  }
+
+  Board board(const Table& t, size_t idx) {
+
+    Board b;
+    b.stm = Color(idx & 1);
+    idx >>= 1;
+
+    for (int i = t.pieceCount - 1; i > 0; --i, idx >>= 6)
+        b.sq[i] = Square(idx & 63);
+
+    b.sq[0] = t.hasPawns ? make_square(File(idx % 4), Rank(idx / 4)) : TriangleSq[idx];
+    return b;
+  }
+
+  Wdl value(const Table& t, size_t idx) {
+    return Wdl((t.wdl[idx / 4] >> (2 * (idx % 4))) & 3);
+  }
+
+  int score(Wdl v) { return v == VWIN ? 1 : v == VLOSS ? -1 : 0; }
+
+  // attacked() tells whether square s is attacked by the pieces of color c,
+  // but the captured one if any
+  bool attacked(const Table& t, const Board& b, Square s, Color c, Bitboard occupied, int captured = -1) {
+
+    for (int i = 0; i < t.pieceCount; ++i)
+        if (i != captured && color_of(t.pieces[i]) == c)
+        {
+            PieceType pt = type_of(t.pieces[i]);
+
+            if ((pt == PAWN ? PawnAttacks[c][b.sq[i]] : attacks_bb(pt, b.sq[i], occupied)) & s)
+                return true;
+        }
+
+    return false;
+  }
+
+  // legal() tells whether the board is a legal position, and computes its
+  // occupied squares
+  bool legal(const Table& t, const Board& b, Bitboard& occupied) {
+
+    occupied = 0;
+
+    for (int i = 0; i < t.pieceCount; ++i)
+    {
+        if (   (occupied & b.sq[i])
+            || (type_of(t.pieces[i]) == PAWN && (rank_of(b.sq[i]) == RANK_1 || rank_of(b.sq[i]) == RANK_8)))
+            return false;
+
+        occupied |= b.sq[i];
+    }
+
+    // The king of the side not to move can't be in check
+    return !attacked(t, b, b.sq[b.stm == WHITE], b.stm, occupied);
+  }
+
+  // probe() returns the value of the position of the n pieces pc on the
+  // squares sq. The table of their material must be ready.
+  Wdl probe(const Piece* pc, const Square* sq, int n, Color stm) {
+
+    if (n == 2)
+        return VDRAW;
+
+    bool flip;
+    const Table& t = *find(pc, n, flip);
+    bool used[TBGen::MaxPieces] = {};
+    Board b;
+
+    b.stm = flip ? ~stm : stm;
+
+    for (int k = 0; k < n; ++k)
+        for (int i = 0; i < n; ++i)
+            if (!used[i] && (flip ? ~pc[i] : pc[i]) == t.pieces[k])
+            {
+                used[i] = true;
+                b.sq[k] = flip ? flip_rank(sq[i]) : sq[i];
+                break;
+            }
+
+    return value(t, index(t, b));
+  }
+
+  // probe_after() returns the value for the opponent of the move of piece i to
+  // square to, that leaves the table by a capture, a promotion or both
+  Wdl probe_after(const Table& t, const Board& b, int i, Square to, int captured, PieceType promotion) {
+
+    Piece pc[TBGen::MaxPieces];
+    Square sq[TBGen::MaxPieces];
+    int n = 0;
+
+    for (int k = 0; k < t.pieceCount; ++k)
+        if (k != captured)
+        {
+            pc[n] = k == i && promotion ? make_piece(b.stm, promotion) : t.pieces[k];
+            sq[n++] = k == i ? to : b.sq[k];
+        }
+
+    return probe(pc, sq, n, ~b.stm);
+  }
+
+  // ep_score() returns the best score for the side to move of its en passant
+  // captures of pawn i, which has just made a double push, if any. The table
+  // has the positions without en passant rights, so when such a capture draws
+  // or wins the double push doesn't lead to the position of the table.
+  int ep_score(const Table& t, const Board& b, int i, Bitboard occupied) {
+
+    const Color us = b.stm;
+    const Square epSquare = b.sq[i] - pawn_push(~us);
+    int best = NoEnPassant;
+
+    for (int k = 0; k < t.pieceCount; ++k)
+        if (t.pieces[k] == make_piece(us, PAWN) && (PawnAttacks[us][b.sq[k]] & epSquare))
+        {
+            Board c = b;
+            c.sq[k] = epSquare;
+
+            if (!attacked(t, c, c.sq[us == BLACK], ~us, (occupied ^ b.sq[k] ^ b.sq[i]) | epSquare, i))
+                best = std::max(best, -score(probe_after(t, b, k, epSquare, i, NO_PIECE_TYPE)));
+        }
+
+    return best;
+  }
+
+  // The weight of a position in the move counters. Without pawns, positions
+  // symmetric by the a1-h8 diagonal have half as many symmetric images as the
+  // others, so they count their moves once and the others twice. Then a
+  // position is decremented as much by the moves back from its successors,
+  // which subtract their own weight, as it counted moves to them.
+  int weight(const Table& t, const Board& b) {
+
+    if (t.hasPawns)
+        return 1;
+
+    for (int i = 0; i < t.pieceCount; ++i)
+        if (rank_of(b.sq[i]) != Rank(file_of(b.sq[i])))
+            return 2;
+
+    return 1;
+  }
+
+  // first_state() computes the state of a position before the iterations: the
+  // results of mates, stalemates and of the moves out of the table, or else
+  // its counter of the moves inside it.
+  State first_state(const Table& t, size_t idx) {
+
+    Board b = board(t, idx);
+    Bitboard occupied, ours = 0;
+
+    if (!legal(t, b, occupied) || index(t, b) != idx)
+        return ILLEGAL;
+
+    const Color us = b.stm;
+    const int w = weight(t, b);
+    int count = 0;
+    bool moves = false, escape = false;
+
+    for (int i = 0; i < t.pieceCount; ++i)
+        if (color_of(t.pieces[i]) == us)
+            ours |= b.sq[i];
+
+    for (int i = 0; i < t.pieceCount; ++i)
+    {
+        if (color_of(t.pieces[i]) != us)
+            continue;
+
+        const PieceType pt = type_of(t.pieces[i]);
+        const Square from = b.sq[i];
+        Bitboard targets;
+
+        if (pt == PAWN)
+        {
+            Square push = from + pawn_push(us);
+            targets = PawnAttacks[us][from] & (occupied ^ ours);
+
+            if (!(occupied & push))
+            {
+                targets |= push;
+
+                if (relative_rank(us, from) == RANK_2 && !(occupied & (push + pawn_push(us))))
+                    targets |= push + pawn_push(us);
+            }
+        }
+        else
+            targets = attacks_bb(pt, from, occupied) & ~ours;
+
+        while (targets)
+        {
+            Square to = pop_lsb(&targets);
+            int captured = -1;
+
+            for (int k = 0; k < t.pieceCount; ++k)
+                if (k != i && b.sq[k] == to)
+                    captured = k;
+
+            Board c = b;
+            c.sq[i] = to;
+            c.stm = ~us;
+            Bitboard occ = (occupied ^ from) | to;
+
+            if (attacked(t, c, c.sq[us == BLACK], ~us, occ, captured))
+                continue;
+
+            moves = true;
+
+            if (pt == PAWN && relative_rank(us, to) == RANK_8)
+            {
+                for (PieceType promotion : { QUEEN, ROOK, BISHOP, KNIGHT })
+                {
+                    Wdl v = probe_after(t, b, i, to, captured, promotion);
+
+                    if (v == VLOSS)
+                        return WIN;
+
+                    escape |= v == VDRAW;
+                }
+                continue;
+            }
+
+            if (captured >= 0)
+            {
+                Wdl v = probe_after(t, b, i, to, captured, NO_PIECE_TYPE);
+
+                if (v == VLOSS)
+                    return WIN;
+
+                escape |= v == VDRAW;
+                continue;
+            }
+
+            // The opponent wins by capturing en passant, the move loses
+            if (   pt == PAWN
+                && distance<Rank>(from, to) == 2
+                && ep_score(t, c, i, occ) == 1)
+                continue;
+
+            count += w;
+        }
+    }
+
+    if (!moves)
+        return attacked(t, b, b.sq[us == BLACK], ~us, occupied) ? LOSS : DRAW;
+
+    return escape ? NO_LOSS : count ? State(count) : LOSS;
+  }
+
+  // for_each_predecessor() calls f(idx, w, ep) for the positions of the table
+  // from which a move leads to the board of index idx, where w is the weight
+  // of idx and ep the en passant score of the move, NoEnPassant if none.
+  template<typename F>
+  void for_each_predecessor(const Table& t, size_t idx, const F& f) {
+
+    const Board b = board(t, idx);
+    const Color them = ~b.stm;
+    const int w = weight(t, b);
+    Bitboard occupied = 0;
+
+    for (int i = 0; i < t.pieceCount; ++i)
+        occupied |= b.sq[i];
+
+    for (int i = 0; i < t.pieceCount; ++i)
+    {
+        if (color_of(t.pieces[i]) != them)
+            continue;
+
+        const PieceType pt = type_of(t.pieces[i]);
+        const Square to = b.sq[i];
+        Bitboard froms = 0;
+
+        if (pt == PAWN)
+        {
+            Square from = to - pawn_push(them);
+
+            if (relative_rank(them, to) >= RANK_3 && !(occupied & from))
+            {
+                froms = square_bb(from);
+
+                if (relative_rank(them, to) == RANK_4 && !(occupied & (from - pawn_push(them))))
+                    froms |= from - pawn_push(them);
+            }
+        }
+        else
+            froms = attacks_bb(pt, to, occupied) & ~occupied;
+
+        while (froms)
+        {
+            Board p = b;
+            p.sq[i] = pop_lsb(&froms);
+            p.stm = them;
+
+            f(index(t, p), w, pt == PAWN && distance<Rank>(p.sq[i], to) == 2 ? ep_score(t, b, i, occupied)
+                                                                              : NoEnPassant);
+        }
+    }
+  }
+
+  // parallel() calls f(i, wins, losses) for i in [0, n) on all the cores, and
+  // returns false if aborted. f appends the positions it finds won and lost.
+  // The builds in the background run on the calling thread alone while a
+  // search runs, not to take its cores, and on low priority threads else.
+  template<typename F>
+  bool parallel(size_t n, std::vector<uint32_t>& wins, std::vector<uint32_t>& losses,
+                bool background, const F& f) {
+
+    const bool searching = background && !Threads.stop.load(std::memory_order_relaxed);
+    const size_t threadCount = searching ? 1 : std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<std::vector<uint32_t>> w(threadCount), l(threadCount);
+    std::vector<std::thread> threads;
+
+    auto work = [&](size_t th) {
+
+        if (background)
+            lower_thread_priority();
+
+        for (size_t i = n * th / threadCount; i < n * (th + 1) / threadCount; ++i)
+        {
+            if (Stop.load(std::memory_order_relaxed))
+                return;
+
+            f(i, w[th], l[th]);
+        }
+    };
+
+    if (threadCount == 1)
+        work(0);
+    else
+        for (size_t th = 0; th < threadCount; ++th)
+            threads.emplace_back(work, th);
+
+    for (std::thread& th : threads)
+        th.join();
+
+    wins.clear();
+    losses.clear();
+
+    for (size_t th = 0; th < threadCount; ++th)
+    {
+        wins.insert(wins.end(), w[th].begin(), w[th].end());
+        losses.insert(losses.end(), l[th].begin(), l[th].end());
+    }
+
+    return !Stop;
+  }
+
+  // generate() computes the table by retrograde analysis. Starting from the
+  // positions decided by mates and by the moves out of the table, each pass
+  // marks won the positions with a move to a position lost at the previous
+  // one, and lost those left with no move but to won positions. When nothing
+  // changes the unknown positions are draws.
+  bool generate(Table& t, bool background) {
+
+    std::unique_ptr<std::atomic<uint8_t>[]> state(new std::atomic<uint8_t>[t.size]);
+    std::vector<uint32_t> wins, losses, unused;
+
+    bool done = parallel(t.size, wins, losses, background, [&](size_t idx, auto& w, auto& l) {
+
+        State s = first_state(t, idx);
+        state[idx].store(s, std::memory_order_relaxed);
+
+        if (s == WIN)
+            w.push_back(uint32_t(idx));
+        else if (s == LOSS)
+            l.push_back(uint32_t(idx));
+    });
+
+    while (done && (wins.size() || losses.size()))
+    {
+        std::vector<uint32_t> newWins, newLosses;
+
+        done =  parallel(losses.size(), newWins, unused, background, [&](size_t i, auto& w, auto&) {
+
+                    for_each_predecessor(t, losses[i], [&](size_t p, int, int ep) {
+
+                        if (ep >= 0) // The capture en passant doesn't lose
+                            return;
+
+                        uint8_t s = state[p].load(std::memory_order_relaxed);
+
+                        while (s > LOSS && s <= NO_LOSS)
+                            if (state[p].compare_exchange_weak(s, WIN, std::memory_order_relaxed))
+                            {
+                                w.push_back(uint32_t(p));
+                                break;
+                            }
+                    });
+                })
+             && parallel(wins.size(), unused, newLosses, background, [&](size_t i, auto&, auto& l) {
+
+                    for_each_predecessor(t, wins[i], [&](size_t p, int weight, int ep) {
+
+                        if (ep == 1) // The move wasn't counted
+                            return;
+
+                        uint8_t s = state[p].load(std::memory_order_relaxed);
+
+                        while (s > LOSS && s < NO_LOSS)
+                            if (state[p].compare_exchange_weak(s, uint8_t(s - weight), std::memory_order_relaxed))
+                            {
+                                assert(s >= weight);
+
+                                if (s == weight)
+                                    l.push_back(uint32_t(p));
+                                break;
+                            }
+                    });
+                });
+
+        wins.swap(newWins);
+        losses.swap(newLosses);
+    }
+
+    if (!done)
+        return false;
+
+    t.wdl.assign((t.size + 3) / 4, 0);
+
+    for (size_t idx = 0; idx < t.size; ++idx)
+    {
+        uint8_t s = state[idx].load(std::memory_order_relaxed);
+        Wdl v = s == WIN ? VWIN : s == LOSS ? VLOSS : VDRAW;
+        t.wdl[idx / 4] |= uint8_t(v << (2 * (idx % 4)));
+    }
+
+    return true;
+  }
+
+  // dependencies() returns the tables reached from t by a capture, a promotion
+  // or both at once
+  std::vector<Table*> dependencies(const Table& t) {
+
+    std::vector<Table*> deps;
+    Piece pc[TBGen::MaxPieces];
+
+    auto add = [&](int removed, int promoted, PieceType promotion) {
+
+        int n = 0;
+        for (int k = 0; k < t.pieceCount; ++k)
+            if (k != removed)
+                pc[n++] = k == promoted ? make_piece(color_of(t.pieces[k]), promotion) : t.pieces[k];
+
+        bool flip;
+        Table* d = n > 2 ? find(pc, n, flip) : nullptr;
+
+        if (d && std::find(deps.begin(), deps.end(), d) == deps.end())
+            deps.push_back(d);
+    };
+
+    for (int i = 2; i < t.pieceCount; ++i)
+    {
+        add(i, -1, NO_PIECE_TYPE);
+
+        if (type_of(t.pieces[i]) == PAWN)
+            for (PieceType promotion : { QUEEN, ROOK, BISHOP, KNIGHT })
+            {
+                add(-1, i, promotion);
+
+                for (int j = 2; j < t.pieceCount; ++j)
+                    if (color_of(t.pieces[j]) != color_of(t.pieces[i]))
+                        add(j, i, promotion);
+            }
+    }
+
+    return deps;
+  }
+
+  // The files of the cache directory are a line of header, then the table
+  std::string header(const Table& t) { return "TBGen " + t.code + " " + std::to_string(t.size); }
+
+  // file_name() returns the path of the table's cache file, empty if none
+  std::string file_name(const Table& t) {
+
+    std::lock_guard<std::mutex> lock(CachePathMutex);
+    return CachePath.empty() ? "" : CachePath + "/" + t.code + ".wdl";
+  }
+
+  bool load(Table& t) {
+
+    const std::string name = file_name(t);
+
+    if (name.empty())
+        return false;
+
+    std::ifstream f(name, std::ios::binary);
+    std::string line;
+
+    if (!std::getline(f, line) || line != header(t))
+        return false;
+
+    t.wdl.resize((t.size + 3) / 4);
+
+    if (!f.read(reinterpret_cast<char*>(t.wdl.data()), t.wdl.size()))
+    {
+        t.wdl.clear();
+        return false;
+    }
+
+    return true;
+  }
+
+  void save(const Table& t) {
+
+    const std::string name = file_name(t);
+
+    if (name.empty())
+        return;
+
+    std::ofstream f(name, std::ios::binary);
+    f << header(t) << '\n';
+    f.write(reinterpret_cast<const char*>(t.wdl.data()), t.wdl.size());
+  }
+
+  // build() makes the table ready with the tables it depends on, loading each
+  // from the cache directory if it's there, else generating it. Generating it
+  // needs the smaller tables, and TBGen::build() promises them even when it's
+  // loaded. It must be called with BuildMutex held.
+  bool build(Table& t, bool background) {
+
+    if (t.status.load(std::memory_order_relaxed) == READY)
+        return true;
+
+    for (Table* d : dependencies(t))
+        if (!build(*d, background))
+            return false;
+
+    if (!load(t))
+    {
+        if (!generate(t, background))
+            return false;
+
+        save(t);
+    }
+
+    t.status.store(READY, std::memory_order_release);
+    return true;
+  }
+
+  // Builder builds the tables that the probes ask for in a thread of its own,
+  // so that the searches go on meanwhile
+  class Builder {
+
+  public:
+   ~Builder() {
+
+      Stop = true;
+      {
+          std::lock_guard<std::mutex> lk(mutex);
+          exit = true;
+      }
+      cv.notify_one();
+
+      if (thread.joinable())
+          thread.join();
+    }
+
+    void request(Table& t) {
+
+      int expected = MISSING;
+      if (!t.status.compare_exchange_strong(expected, QUEUED))
+          return;
+
+      std::lock_guard<std::mutex> lk(mutex);
+
+      if (!thread.joinable())
+          thread = std::thread(&Builder::idle_loop, this);
+
+      queue.push_back(&t);
+      cv.notify_one();
+    }
+
+  private:
+    void idle_loop() {
+
+      while (true)
+      {
+          std::unique_lock<std::mutex> lk(mutex);
+          cv.wait(lk, [&]{ return exit || !queue.empty(); });
+
+          if (exit)
+              return;
+
+          Table* t = queue.front();
+          queue.pop_front();
+          lk.unlock();
+
+          std::lock_guard<std::mutex> build_lock(BuildMutex);
+          build(*t, true);
+      }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Table*> queue;
+    std::thread thread;
+    bool exit = false;
+  };
+
+  Builder TheBuilder;
+
+  void add(const std::vector<PieceType>& pieces) {
+
+    Table& t = Tables.emplace_back();
+    Color c = BLACK;
+
+    t.pieceCount = 2;
+    t.pieces[0] = W_KING;
+    t.pieces[1] = B_KING;
+
+    for (PieceType pt : pieces)
+    {
+        if (pt == KING)
+        {
+            c = ~c;
+            t.code += c == BLACK ? "vK" : "K";
+            continue;
+        }
+
+        t.code += " PNBRQK"[pt];
+        t.pieces[t.pieceCount++] = make_piece(c, pt);
+        t.hasPawns |= pt == PAWN;
+    }
+
+    t.size = size_t(t.hasPawns ? 32 : 10) << (6 * (t.pieceCount - 1)) << 1;
+    BySignature[signature(t.pieces, t.pieceCount, false)] = &t;
+  }
+
+  // add_tables() lists the tables, the stronger side being white like in the
+  // Syzygy tables
+  void add_tables() {
+
+    int n = 0;
+    for (Square s = SQ_A1; s <= SQ_H8; ++s)
+        if (file_of(s) <= FILE_D && int(rank_of(s)) <= int(file_of(s)))
+        {
+            TriangleSq[n] = s;
+            TriangleIdx[s] = n++;
+        }
+
+    for (PieceType p1 = PAWN; p1 < KING; ++p1)
+    {
+        add({ KING, p1, KING });
+
+        for (PieceType p2 = PAWN; p2 <= p1; ++p2)
+        {
+            add({ KING, p1, p2, KING });
+            add({ KING, p1, KING, p2 });
+        }
+    }
+  }
+
+} // namespace
+
+
+/// TBGen::init() sets the largest number of pieces of the tables, 0 to not use
+/// them, and the directory of their cache files, none if empty. The tables
+/// already built are kept, and a build in the background goes on without
+/// holding it up. Not to be called during a search.
+
+void TBGen::init(int maxPieces, const std::string& cachePath) {
+
+  std::call_once(TablesAdded, add_tables);
+
+  PieceLimit = std::min(maxPieces, MaxPieces);
+
+  std::lock_guard<std::mutex> lock(CachePathMutex);
+  CachePath = cachePath == "<empty>" ? "" : cachePath;
+}
+
+
+int TBGen::max_pieces() {
+
+  return PieceLimit;
+}
+
+
+/// TBGen::memory() returns the size of the tables built so far
+
+size_t TBGen::memory() {
+
+  size_t total = 0;
+
+  for (const Table& t : Tables)
+      if (t.status.load(std::memory_order_acquire) == READY)
+          total += t.wdl.size();
+
+  return total;
+}
+
+
+/// TBGen::build() builds the table of the code, like "KRvKN", and its smaller
+/// tables in the calling thread, and returns false if there's no such table
+
+bool TBGen::build(const std::string& code) {
+
+  std::call_once(TablesAdded, add_tables);
+
+  std::lock_guard<std::mutex> lock(BuildMutex);
+
+  for (Table& t : Tables)
+      if (t.code == code)
+          return ::stockfish::build(t, false);
+
+  return false;
+}
+
+
+/// TBGen::probe_wdl() probes the tables like Tablebases::probe_wdl(). It fails
+/// until the table is built, and asks the builder for it the first time.
+
+WDLScore TBGen::probe_wdl(Position& pos, ProbeState* result) {
+
+  const int n = pos.count<ALL_PIECES>();
+
+  if (n > PieceLimit || pos.can_castle(ANY_CASTLING))
+      return *result = FAIL, WDLDraw;
+
+  if (n == 2)
+      return *result = OK, WDLDraw;
+
+  Piece pc[MaxPieces];
+  Square sq[MaxPieces];
+  Bitboard b = pos.pieces();
+
+  for (int i = 0; b; ++i)
+  {
+      sq[i] = pop_lsb(&b);
+      pc[i] = pos.piece_on(sq[i]);
+  }
+
+  bool flip;
+  Table& t = *find(pc, n, flip);
+
+  if (t.status.load(std::memory_order_acquire) != READY)
+  {
+      TheBuilder.request(t);
+      return *result = FAIL, WDLDraw;
+  }
+
+  Wdl v = probe(pc, sq, n, pos.side_to_move());
+  WDLScore wdl = v == VWIN ? WDLWin : v == VLOSS ? WDLLoss : WDLDraw;
+
+  // The tables are of the positions without en passant rights
+  if (pos.ep_square() != SQ_NONE)
+  {
+      StateInfo st;
+
+      for (const auto& m : MoveList<LEGAL>(pos))
+          if (type_of(m) == ENPASSANT)
+          {
+              pos.do_move(m, st);
+              WDLScore ep = WDLScore(-TBGen::probe_wdl(pos, result));
+              pos.undo_move(m);
+
+              if (*result == FAIL)
+                  return WDLDraw;
+
+              wdl = std::max(wdl, ep);
+          }
+  }
+
+  *result = OK;
+  return wdl;
+}
+
+} // namespace stockfish
@@ -0,0 +1,51 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TBGEN_H_INCLUDED
+#define TBGEN_H_INCLUDED
+
+#include <string>
+
+#include "syzygy/tbprobe.h"
+
+namespace stockfish {
+
+class Position;
+
+/// TBGen computes the WDL tables of the endgames of up to 4 pieces in memory,
+/// by retrograde analysis like the KPK bitbase, so that hosts without Syzygy
+/// files still know their results. A table is built in the background when
+/// one of its positions is first probed, with its smaller tables. Tables are
+/// 2 bits per position, and can be saved to a directory to be loaded later.
+
+namespace TBGen {
+
+constexpr int MaxPieces = 4;
+
+void init(int maxPieces, const std::string& cachePath);
+int max_pieces();
+size_t memory();
+bool build(const std::string& code);
+Tablebases::WDLScore probe_wdl(Position& pos, Tablebases::ProbeState* result);
+
+} // namespace TBGen
+}
+
+#endif // #ifndef TBGEN_H_INCLUDED
@@ -21,11 +21,15 @@
 #include <cassert>
 
 #include <algorithm> // For std::count
+#include <iomanip>
+#include <iostream>
+#include <sstream>
 #include "movegen.h"
 #include "search.h"
 #include "thread.h"
 #include "uci.h"
 #include "syzygy/tbprobe.h"
+#include "tbgen.h"
 #include "tt.h"
 
 namespace stockfish {
@@ -52,6 +56,8 @@ Thread::~Thread() {
   exit = true;
   start_searching();
   stdThread.join();
+
+  Histories::release(histories);
 }
 
 /// Thread::bestMoveCount(Move move) return best move counter for the given root move
@@ -64,23 +70,25 @@ int Thread::best_move_count(Move move) const {
   return rm != rootMoves.begin() + pvLast ? rm->bestMoveCount : 0;
 }
 
-/// Thread::clear() reset histories, usually before a new game
+/// Thread::clear() resets histories, usually before a new game, by giving them
+/// back to the pool: the next search acquires cleared ones. It's run by the
+/// thread itself, see ThreadPool::clear(), which also sizes the pawn, material
+/// and evaluation tables.
 
 void Thread::clear() {
 
-  counterMoves.fill(MOVE_NONE);
-  mainHistory.fill(0);
-  lowPlyHistory.fill(0);
-  captureHistory.fill(0);
+  pawnsTable.resize(size_t(Options["Pawn Hash"]));
+  materialTable.resize(size_t(Options["Material Hash"]));
+  evalCache.resize(size_t(Options["Eval Hash"]));
+  evalCache.clear(); // Its values depend on the evaluation in use
+  tbProbes = tbCacheHits = tbFaults = 0;
 
-  for (bool inCheck : { false, true })
-      for (StatsType c : { NoCaptures, Captures })
-      {
-          for (auto& to : continuationHistory[inCheck][c])
-                for (auto& h : to)
-                      h->fill(0);
-          continuationHistory[inCheck][c][NO_PIECE][0]->fill(Search::CounterMovePruneThreshold - 1);
-      }
+  Histories::release(histories);
+  histories = nullptr;
+
+#ifndef NDEBUG
+  stats.clear();
+#endif
 }
 
 /// Thread::start_searching() wakes up the thread that will start the search
@@ -93,6 +101,18 @@ void Thread::start_searching() {
 }
 
 
+/// Thread::run_custom_job() wakes up the thread to run f instead of a search.
+/// Use wait_for_search_finished() to wait for it to be done.
+
+void Thread::run_custom_job(std::function<void()> f) {
+
+  std::lock_guard<std::mutex> lk(mutex);
+  jobFunc = std::move(f);
+  searching = true;
+  cv.notify_one();
+}
+
+
 /// Thread::wait_for_search_finished() blocks on the condition variable
 /// until the thread has finished searching.
 
@@ -126,9 +146,14 @@ void Thread::idle_loop() {
       if (exit)
           return;
 
+      std::function<void()> job = std::move(jobFunc);
+      jobFunc = nullptr;
       lk.unlock();
 
-      search();
+      if (job)
+          job();
+      else
+          search();
   }
 }
 
@@ -145,6 +170,9 @@ void ThreadPool::set(size_t requested) {
           delete back(), pop_back();
   }
 
+  // Blocks of the threads that no longer exist would never be reused
+  Histories::release_pool(requested);
+
   if (requested > 0) { // create new thread(s)
       push_back(new MainThread(0));
 
@@ -152,6 +180,10 @@ void ThreadPool::set(size_t requested) {
           push_back(new Thread(size()));
       clear();
 
+      // The threads bind themselves in idle_loop(), with the same condition
+      if (requested > 8)
+          sync_cout << "info string " << WinProcGroup::layout(requested) << sync_endl;
+
       // Reallocate the hash with the new threadpool size
       TT.resize(Options["Hash"]);
 
@@ -160,16 +192,58 @@ void ThreadPool::set(size_t requested) {
   }
 }
 
-/// ThreadPool::clear() sets threadPool data to initial values.
+/// ThreadPool::clear() sets threadPool data to initial values. Each thread
+/// clears its own tables, so that on NUMA systems they are local to it.
 
 void ThreadPool::clear() {
 
   for (Thread* th : *this)
-      th->clear();
+      th->run_custom_job([th]() { th->clear(); });
+
+  for (Thread* th : *this)
+      th->wait_for_search_finished();
 
   main()->callsCnt = 0;
   main()->previousScore = VALUE_INFINITE;
   main()->previousTimeReduction = 1.0;
+  main()->lastPv.clear();
+  main()->lastPvKeys.clear();
+}
+
+
+/// ThreadPool::resume_previous_search() checks if the root position lies on the
+/// best PV of the previous search. In that case the predicted move is brought
+/// to the front of rootMoves together with its PV and score, which seed the
+/// move ordering and the aspiration window, and the depth the previous search
+/// already covered for this position is returned. Otherwise returns 0.
+
+Depth ThreadPool::resume_previous_search(const Position& pos, Search::RootMoves& rootMoves) const {
+
+  const MainThread* mt = main();
+  auto it = std::find(mt->lastPvKeys.begin(), mt->lastPvKeys.end(), pos.key());
+
+  if (it == mt->lastPvKeys.end() || rootMoves.empty())
+      return 0;
+
+  // Number of moves of the previous PV that have been played since
+  size_t ply = it - mt->lastPvKeys.begin() + 1;
+
+  if (ply >= mt->lastPv.size() || mt->lastPvDepth <= int(ply))
+      return 0;
+
+  auto rm = std::find(rootMoves.begin(), rootMoves.end(), mt->lastPv[ply]);
+
+  // Don't mess with the ordering given by the tablebases
+  if (rm == rootMoves.end() || rm->tbRank != rootMoves[0].tbRank)
+      return 0;
+
+  std::rotate(rootMoves.begin(), rm, rm + 1);
+
+  Value v = ply % 2 ? -mt->lastPvScore : mt->lastPvScore;
+  rootMoves[0].score = rootMoves[0].previousScore = v;
+  rootMoves[0].pv.assign(mt->lastPv.begin() + ply, mt->lastPv.end());
+
+  return mt->lastPvDepth - int(ply);
 }
 
 /// ThreadPool::start_thinking() wakes up main thread waiting in idle_loop() and
@@ -182,6 +256,8 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states,
 
   main()->stopOnPonderhit = stop = false;
   increaseDepth = true;
+  deterministic = Options["Deterministic"] && size() > 1;
+  iterationArrivals = 0;
   main()->ponder = ponderMode;
   Search::Limits = limits;
   Search::RootMoves rootMoves;
@@ -194,6 +270,13 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states,
   if (!rootMoves.empty())
       Tablebases::rank_root_moves(pos, rootMoves);
 
+  // Don't repeat iterations the previous search already did for this position,
+  // but make sure that at least one iteration is done when the depth is fixed.
+  Depth resumeDepth = resume_previous_search(pos, rootMoves);
+
+  if (limits.depth)
+      resumeDepth = std::min(resumeDepth, limits.depth - 1);
+
   // After ownership transfer 'states' becomes empty, so if we stop the search
   // and call 'go' again without setting a new position states.get() == NULL.
   assert(states.get() || setupStates.get());
@@ -203,22 +286,181 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states,
 
   // We use Position::set() to set root position across threads. But there are
   // some StateInfo fields (previous, pliesFromNull, capturedPiece) that cannot
-  // be deduced from a fen string, so set() clears them and to not lose the info
-  // we need to backup and later restore setupStates->back(). Note that setupStates
-  // is shared by threads but is accessed in read-only mode.
-  StateInfo tmp = setupStates->back();
-
+  // be deduced from a fen string, so set() clears them and we restore them from
+  // setupStates->back(). Each thread has its own copy of the root state, where
+  // it computes its NNUE accumulators. Note that setupStates is shared by threads
+  // but is accessed in read-only mode.
   for (Thread* th : *this)
   {
       th->nodes = th->tbHits = th->nmpMinPly = 0;
-      th->rootDepth = th->completedDepth = 0;
+      th->rootDepth = th->completedDepth = resumeDepth;
       th->rootMoves = rootMoves;
-      th->rootPos.set(pos.fen(), pos.is_chess960(), &setupStates->back(), th);
-      th->lowPlyHistory.fill(0);
+      th->rootPos.set(pos.fen(), pos.is_chess960(), &th->rootState, th);
+      th->rootState = setupStates->back();
+      th->rootState.dirtyPiece.dirtyNum = -1;
+      th->rootState.accumulator.computed[WHITE] = th->rootState.accumulator.computed[BLACK] = false;
   }
 
-  setupStates->back() = tmp;
-
   main()->start_searching();
 }
+
+
+/// ThreadPool::end_iteration() is where the threads of a deterministic search
+/// meet after each iteration. The helpers wait there until the main thread
+/// lets them start the next one, which it does once it has merged the TT
+/// writes of all threads, in thread order, and decided whether to stop. So
+/// the threads only ever see TT contents that don't depend on timing. A stop
+/// from the GUI releases everyone, and leaves merging to the end of the search.
+
+void ThreadPool::end_iteration(Thread* th) {
+
+  if (th != main())
+  {
+      uint64_t starts = iterationStarts;
+      ++iterationArrivals;
+
+      while (iterationStarts == starts && !stop)
+          std::this_thread::yield();
+      return;
+  }
+
+  while (iterationArrivals < size() - 1 && !stop)
+      std::this_thread::yield();
+
+  if (!stop)
+      merge_tt();
+}
+
+
+/// ThreadPool::start_next_iteration() releases the helpers waiting in
+/// end_iteration()
+
+void ThreadPool::start_next_iteration() {
+
+  iterationArrivals = 0;
+  ++iterationStarts;
+}
+
+
+/// ThreadPool::merge_tt() saves the TT writes of the threads of a
+/// deterministic search. No thread may be searching.
+
+void ThreadPool::merge_tt() {
+
+  for (Thread* th : *this)
+      th->ttOverlay.merge();
+}
+
+
+/// ThreadPool::memory_report() tells how much memory the engine uses, by kind
+/// of table, to help sizing hosts that run many engines. Not during a search.
+
+std::string ThreadPool::memory_report() const {
+
+  size_t histories = 0, compact = 0, tables = 0, overlays = 0, objects = 0;
+
+  for (const Thread* th : *this)
+  {
+      if (th->histories)
+      {
+          histories += th->histories->memory();
+          compact += th->histories->compact;
+      }
+
+      tables   += th->pawnsTable.memory() + th->materialTable.memory() + th->evalCache.memory();
+      overlays += th->ttOverlay.memory();
+      objects  += th == main() ? sizeof(MainThread) : sizeof(Thread);
+  }
+
+  size_t pooled = Histories::pooled_memory();
+  size_t shared = Pawns::SharedTable.memory() + Material::SharedTable.memory();
+  size_t network = Eval::NNUE::memory();
+  size_t syzygy = Tablebases::cache_memory();
+  size_t generated = TBGen::memory();
+  size_t total =  TT.memory() + histories + tables + shared + overlays + objects + pooled + network
+                + syzygy + generated;
+
+  auto mb = [](size_t bytes) {
+      std::ostringstream ss;
+      ss << std::fixed << std::setprecision(1) << std::setw(8) << bytes / (1024.0 * 1024.0) << " MB";
+      return ss.str();
+  };
+
+  std::ostringstream ss;
+  ss << "Engine memory, " << size() << " thread(s)"
+     << "\n  transposition table  " << mb(TT.memory())
+     << "\n  histories            " << mb(histories) << " (" << compact << " compact)"
+     << "\n  pawn/material/eval   " << mb(tables)
+     << "\n  shared pawn/material " << mb(shared)
+     << "\n  thread objects       " << mb(objects)
+     << "\n  TT overlays          " << mb(overlays)
+     << "\n  pooled histories     " << mb(pooled)
+     << "\n  NNUE network         " << mb(network)
+     << "\n  syzygy cache         " << mb(syzygy)
+     << "\n  generated tablebases " << mb(generated)
+     << "\n  total                " << mb(total)
+     << "\n" << large_page_report()
+     << "\n" << hash_report();
+
+  return ss.str();
+}
+
+
+/// ThreadPool::hash_report() gives the hit rates of the pawn, material and
+/// evaluation hash tables since the last clear(), to size them
+
+std::string ThreadPool::hash_report() const {
+
+  std::ostringstream ss;
+
+  auto line = [&](const char* name, auto Thread::* table, size_t sharedMemory) {
+
+      uint64_t probes = 0, hits = 0, sharedHits = 0;
+
+      for (const Thread* th : *this)
+      {
+          probes     += (th->*table).probes;
+          hits       += (th->*table).hits;
+          sharedHits += (th->*table).sharedHits;
+      }
+
+      auto percent = [&](uint64_t n) { return 100.0 * n / std::max(probes, uint64_t(1)); };
+
+      ss << std::fixed << std::setprecision(2) << name << " hash: "
+         << (front()->*table).size() << " entries per thread";
+      if (sharedMemory)
+          ss << " + " << std::setprecision(1) << sharedMemory / (1024.0 * 1024.0)
+             << std::setprecision(2) << " MB shared";
+      ss << ", " << probes << " probes, " << percent(hits) << "% hits";
+      if (sharedMemory)
+          ss << ", " << percent(sharedHits) << "% shared hits";
+  };
+
+  line("Pawn", &Thread::pawnsTable, Pawns::SharedTable.memory());
+  ss << "\n";
+  line("Material", &Thread::materialTable, Material::SharedTable.memory());
+  ss << "\n";
+  line("Eval", &Thread::evalCache, 0);
+
+  if (Tablebases::MaxCardinality)
+  {
+      uint64_t probes = 0, hits = 0, faults = 0;
+
+      for (const Thread* th : *this)
+      {
+          probes += th->tbProbes;
+          hits   += th->tbCacheHits;
+          faults += th->tbFaults;
+      }
+
+      ss << "\nSyzygy cache: " << std::setprecision(1) << Tablebases::cache_memory() / (1024.0 * 1024.0)
+         << " MB shared, " << probes << " probes, " << std::setprecision(2)
+         << 100.0 * hits / std::max(probes, uint64_t(1)) << "% hits";
+      if (SearchStats::Enabled)
+          ss << ", " << faults << " page faults";
+  }
+
+  return ss.str();
+}
+
 }
@@ -23,16 +23,21 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#include "evaluate.h"
 #include "material.h"
 #include "movepick.h"
 #include "pawns.h"
 #include "position.h"
 #include "search.h"
+#include "searchstats.h"
+#include "searchtree.h"
 #include "thread_win32_osx.h"
+#include "tt.h"
 
 namespace stockfish {
 
@@ -47,35 +52,45 @@ class Thread {
   std::condition_variable cv;
   size_t idx;
   bool exit = false, searching = true; // Set before starting std::thread
+  std::function<void()> jobFunc;
   NativeThread stdThread;
 
 public:
   explicit Thread(size_t);
   virtual ~Thread();
+
   virtual void search();
   void clear();
   void idle_loop();
   void start_searching();
+  void run_custom_job(std::function<void()> f);
   void wait_for_search_finished();
   int best_move_count(Move move) const;
 
   Pawns::Table pawnsTable;
   Material::Table materialTable;
+  Eval::Cache evalCache;
   size_t pvIdx, pvLast;
   uint64_t ttHitAverage;
   int selDepth, nmpMinPly;
   Color nmpColor;
   std::atomic<uint64_t> nodes, tbHits, bestMoveChanges;
+  uint64_t tbProbes, tbCacheHits, tbFaults; // Of the tablebase probes since clear(), faults in debug builds
 
   Position rootPos;
+  StateInfo rootState;
   Search::RootMoves rootMoves;
   Depth rootDepth, completedDepth;
-  CounterMoveHistory counterMoves;
-  ButterflyHistory mainHistory;
-  LowPlyHistory lowPlyHistory;
-  CapturePieceToHistory captureHistory;
-  ContinuationHistory continuationHistory[2][2];
+  Histories* histories = nullptr; // Acquired by the first search
   Score contempt;
+  TTOverlay ttOverlay;
+
+#ifndef NDEBUG
+  SearchStats::Counters stats;
+#endif
+#ifdef SEARCH_TREE
+  SearchTree::Buffer tree;
+#endif
 };
 
 
@@ -94,6 +109,13 @@ struct MainThread : public Thread {
   int callsCnt;
   bool stopOnPonderhit;
   std::atomic_bool ponder;
+
+  // Best PV of the last search and the keys of the positions along it, so
+  // that the next search can resume from it if the game follows the PV.
+  std::vector<Move> lastPv;
+  std::vector<Key> lastPvKeys;
+  Value lastPvScore;
+  Depth lastPvDepth;
 };
 
 
@@ -113,8 +135,21 @@ struct ThreadPool : public std::vector<Thread*> {
 
   std::atomic_bool stop, increaseDepth;
 
+  // In deterministic mode the threads meet at the end of every iteration
+  bool deterministic;
+  void end_iteration(Thread* th);
+  void start_next_iteration();
+  void merge_tt();
+
+  std::string memory_report() const;
+  std::string hash_report() const;
+
 private:
   StateListPtr setupStates;
+  std::atomic<size_t> iterationArrivals;
+  std::atomic<uint64_t> iterationStarts;
+
+  Depth resume_previous_search(const Position& pos, Search::RootMoves& rootMoves) const;
 
   uint64_t accumulate(std::atomic<uint64_t> Thread::* member) const {
 
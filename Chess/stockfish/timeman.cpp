@@ -37,6 +37,7 @@ namespace {
   constexpr int MoveHorizon   = 50;   // Plan time management at most this many moves ahead
   constexpr double MaxRatio   = 7.3;  // When in trouble, we can step over reserved time with this ratio
   constexpr double StealRatio = 0.34; // However we must not steal time from remaining moves over this ratio
+  constexpr TimePoint DeterministicNpmsec = 1000; // Nodes per millisecond of a deterministic search
 
 
   // move_importance() is a skew-logistic function based on naive statistical
@@ -91,6 +92,15 @@ void TimeManagement::init(Search::LimitsType& limits, Color us, int ply) {
   TimePoint npmsec          = Options["nodestime"];
   TimePoint hypMyTime;
 
+  // A deterministic search can't look at the clock, so it always plays in
+  // 'nodes as time' mode, assuming a nominal speed if none is given.
+  if (Threads.deterministic)
+  {
+      if (!npmsec)
+          npmsec = DeterministicNpmsec;
+      limits.movetime *= npmsec;
+  }
+
   // If we have to play in 'nodes as time' mode, then convert from time
   // to nodes, and use resulting values in time management formulas.
   // WARNING: to avoid time losses, the given npmsec (nodes per millisecond)
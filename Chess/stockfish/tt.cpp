@@ -65,26 +65,33 @@ void TranspositionTable::resize(size_t mbSize) {
 
   Threads.main()->wait_for_search_finished();
 
-  free(mem);
+  large_page_free(table);
 
   clusterCount = mbSize * 1024 * 1024 / sizeof(Cluster);
-  table = static_cast<Cluster*>(aligned_ttmem_alloc(clusterCount * sizeof(Cluster), mem));
-  if (!mem)
+  table = static_cast<Cluster*>(large_page_alloc(clusterCount * sizeof(Cluster)));
+  if (!table)
   {
       std::cerr << "Failed to allocate " << mbSize
                 << "MB for transposition table." << std::endl;
       exit(EXIT_FAILURE);
   }
 
+  // The memory from large_page_alloc() is zeroed already. Still clear it with
+  // thread binding, so that each thread touches its part of the table first.
+  cleared = Options["Threads"] <= 8;
   clear();
 }
 
 
 /// TranspositionTable::clear() initializes the entire transposition table to zero,
-//  in a multi-threaded way.
+//  in a multi-threaded way. It does nothing if no search ran since the last time:
+//  probes outside of searches only refresh the generation of empty entries.
 
 void TranspositionTable::clear() {
 
+  if (cleared)
+      return;
+
   std::vector<std::thread> threads;
 
   for (size_t idx = 0; idx < Options["Threads"]; ++idx)
@@ -107,6 +114,8 @@ void TranspositionTable::clear() {
 
   for (std::thread& th: threads)
       th.join();
+
+  cleared = true;
 }
 
 /// TranspositionTable::probe() looks up the current position in the transposition
@@ -144,6 +153,22 @@ TTEntry* TranspositionTable::probe(const Key key, bool& found) const {
 }
 
 
+/// TranspositionTable::find() returns the entry of the position, or nullptr if
+/// it's not in the table. Unlike probe() it doesn't write to the table.
+
+const TTEntry* TranspositionTable::find(const Key key) const {
+
+  const TTEntry* const tte = first_entry(key);
+  const uint16_t key16 = key >> 48;
+
+  for (int i = 0; i < ClusterSize; ++i)
+      if (tte[i].key16 == key16)
+          return &tte[i];
+
+  return nullptr;
+}
+
+
 /// TranspositionTable::hashfull() returns an approximation of the hashtable
 /// occupation during a search. The hash is x permill full, as per UCI protocol.
 
@@ -156,4 +181,91 @@ int TranspositionTable::hashfull() const {
 
   return cnt / ClusterSize;
 }
+
+
+/// TranspositionTable::histogram() counts the non-empty entries of the whole
+/// table by their stored depth (as depth8, i.e. offset by DEPTH_OFFSET) and by
+/// their age, in searches since they were last written or probed.
+
+void TranspositionTable::histogram(uint64_t (&byDepth)[256], uint64_t (&byAge)[32]) const {
+
+  std::fill(std::begin(byDepth), std::end(byDepth), 0);
+  std::fill(std::begin(byAge), std::end(byAge), 0);
+
+  for (size_t i = 0; i < clusterCount; ++i)
+      for (int j = 0; j < ClusterSize; ++j)
+      {
+          const TTEntry& e = table[i].entry[j];
+          if (e.empty())
+              continue;
+
+          ++byDepth[e.depth8];
+          ++byAge[((263 + generation8 - e.genBound8) & 0xF8) >> 3];
+      }
+}
+
+
+/// TTOverlay::resize() sets the size of the overlay in megabytes, rounded down
+/// to a power of 2 number of slots. It must be empty.
+
+void TTOverlay::resize(size_t mbSize) {
+
+  assert(used.empty());
+
+  size_t count = 1;
+  while (count * 2 * sizeof(Slot) <= mbSize * 1024 * 1024)
+      count *= 2;
+
+  if (count != slots.size())
+      slots = std::vector<Slot>(count, Slot());
+}
+
+
+/// TTOverlay::probe() works like TranspositionTable::probe(), the returned
+/// entry is always in the overlay
+
+TTEntry* TTOverlay::probe(const Key key, bool& found) {
+
+  size_t idx = key & (slots.size() - 1);
+  Slot& s = slots[idx];
+
+  if (s.key != key)
+  {
+      if (!s.key)
+          used.push_back(idx);
+
+      const TTEntry* tte = TT.find(key);
+      s.key = key;
+      s.entry = tte ? *tte : TTEntry();
+  }
+
+  found = !s.entry.empty();
+  if (found)
+      s.entry.genBound8 = uint8_t(TT.generation8 | (s.entry.genBound8 & 0x7)); // Refresh
+
+  return &s.entry;
+}
+
+
+/// TTOverlay::merge() saves the written entries into TT, in the order their
+/// slots were first used, and empties the overlay
+
+void TTOverlay::merge() {
+
+  for (size_t idx : used)
+  {
+      Slot& s = slots[idx];
+      const TTEntry& e = s.entry;
+
+      if (!e.empty())
+      {
+          bool found;
+          TTEntry* tte = TT.probe(s.key, found);
+          tte->save(s.key, e.value(), e.is_pv(), e.bound(), e.depth(), e.move(), e.eval());
+      }
+      s = Slot();
+  }
+  used.clear();
+}
+
 }
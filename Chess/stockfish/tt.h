@@ -21,6 +21,8 @@
 #ifndef TT_H_INCLUDED
 #define TT_H_INCLUDED
 
+#include <vector>
+
 #include "misc.h"
 #include "types.h"
 
@@ -45,10 +47,13 @@ struct TTEntry {
   Depth depth() const { return (Depth)depth8 + DEPTH_OFFSET; }
   bool is_pv()  const { return (bool)(genBound8 & 0x4); }
   Bound bound() const { return (Bound)(genBound8 & 0x3); }
+  bool empty()  const { return !key16; }
+  bool replaces(Key k) const { return !empty() && key16 != (uint16_t)(k >> 48); } // save(k) evicts another position
   void save(Key k, Value v, bool pv, Bound b, Depth d, Move m, Value ev);
 
 private:
   friend class TranspositionTable;
+  friend class TTOverlay;
 
   uint16_t key16;
   uint16_t move16;
@@ -77,10 +82,13 @@ class TranspositionTable {
   static_assert(sizeof(Cluster) == 32, "Unexpected Cluster size");
 
 public:
- ~TranspositionTable() { free(mem); }
-  void new_search() { generation8 += 8; } // Lower 3 bits are used by PV flag and Bound
+ ~TranspositionTable() { large_page_free(table); }
+  void new_search() { generation8 += 8; cleared = false; } // Lower 3 bits are used by PV flag and Bound
   TTEntry* probe(const Key key, bool& found) const;
+  const TTEntry* find(const Key key) const;
   int hashfull() const;
+  size_t memory() const { return clusterCount * sizeof(Cluster); }
+  void histogram(uint64_t (&byDepth)[256], uint64_t (&byAge)[32]) const;
   void resize(size_t mbSize);
   void clear();
 
@@ -91,13 +99,40 @@ public:
 
 private:
   friend struct TTEntry;
+  friend class TTOverlay;
 
   size_t clusterCount;
-  Cluster* table;
-  void* mem;
+  Cluster* table = nullptr;
   uint8_t generation8; // Size must be not bigger than TTEntry::genBound8
+  bool cleared = false; // No search since the last clear()
 };
 
 extern TranspositionTable TT;
+
+
+/// TTOverlay holds the TT writes of one thread in deterministic mode, where
+/// the shared table stays read-only during an iteration. probe() reads through
+/// to TT, copying the entry it finds into the overlay, and merge() saves the
+/// written entries into TT. The overlay is direct mapped: a position simply
+/// takes the slot of the one before it, whose writes are lost.
+
+class TTOverlay {
+
+  struct Slot {
+    Key key;
+    TTEntry entry;
+  };
+
+public:
+  void resize(size_t mbSize);
+  TTEntry* probe(const Key key, bool& found);
+  void merge();
+  size_t memory() const { return slots.size() * sizeof(Slot); }
+
+private:
+  std::vector<Slot> slots;
+  std::vector<size_t> used; // Indices of the slots holding a position
+};
+
 }
 #endif // #ifndef TT_H_INCLUDED
@@ -37,6 +37,25 @@
 ///
 /// -DUSE_PEXT    | Add runtime support for use of pext asm-instruction. Works
 ///               | only in 64-bit mode and requires hardware with pext support.
+///
+/// -DUSE_SSE41   | Use SSE 4.1 kernels in the NNUE evaluation. Requires -msse4.1
+///               | or equivalent, and hardware with SSE 4.1 support.
+///
+/// -DUSE_AVX2    | Use AVX2 kernels in the NNUE evaluation. Requires -mavx2 or
+///               | equivalent, and hardware with AVX2 support.
+///
+/// -DNO_CPU_DISPATCH
+///               | Don't compile the hot kernels for the other instruction set
+///               | levels too, see cpu.h. The switches above then set the only
+///               | one, as they always set the baseline. Implied by compilers
+///               | other than GCC and Clang, and by x86 targets other than
+///               | x86-64.
+///
+/// -DUSE_SIMD_ATTACKS
+///               | With AVX2, find the attacks of the pieces in the evaluation
+///               | four at a time with vector fills rather than one at a time
+///               | with the attack tables. Same results, but slower than the
+///               | tables on the CPUs measured so far.
 
 #include <cassert>
 #include <cctype>
@@ -80,6 +99,17 @@
 #  define pext(b, m) 0
 #endif
 
+/// The hot kernels are compiled once per instruction set level, see cpu.h, each
+/// time in their own namespace. The arch/ files name theirs, the baseline of the
+/// build is isa_base.
+#ifndef ISA_NAMESPACE
+#  define ISA_NAMESPACE isa_base
+#endif
+
+#if !defined(NO_CPU_DISPATCH) && defined(__x86_64__) && defined(__GNUC__)
+#  define USE_CPU_DISPATCH
+#endif
+
 namespace stockfish {
 
 #ifdef USE_POPCNT
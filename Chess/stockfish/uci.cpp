@@ -27,6 +27,7 @@
 #include "movegen.h"
 #include "position.h"
 #include "search.h"
+#include "searchstats.h"
 #include "thread.h"
 #include "timeman.h"
 #include "tt.h"
@@ -130,6 +131,8 @@ namespace {
         else if (token == "movetime")  is >> limits.movetime;
         else if (token == "mate")      is >> limits.mate;
         else if (token == "perft")     is >> limits.perft;
+        else if (token == "details")   limits.perftDetails = true;
+        else if (token == "dfpn")      limits.dfpn = true;
         else if (token == "infinite")  limits.infinite = 1;
         else if (token == "ponder")    ponderMode = true;
 
@@ -177,6 +180,9 @@ namespace {
 
     dbg_print(); // Just before exiting
 
+    if (SearchStats::Enabled)
+        cerr << "\n" << SearchStats::report() << endl;
+
     cerr << "\n==========================="
          << "\nTotal time (ms) : " << elapsed
          << "\nNodes searched  : " << nodes
@@ -241,6 +247,13 @@ void UCI::loop(int argc, char* argv[]) {
       else if (token == "d")        sync_cout << pos << sync_endl;
       else if (token == "eval")     sync_cout << Eval::trace(pos) << sync_endl;
       else if (token == "compiler") sync_cout << compiler_info() << sync_endl;
+      else if (token == "memory")   sync_cout << Threads.memory_report() << sync_endl;
+      else if (token == "stats")
+      {
+          string format;
+          is >> format;
+          sync_cout << SearchStats::report(format == "json") << sync_endl;
+      }
       else
           sync_cout << "Unknown command: " << cmd << sync_endl;
 
@@ -23,8 +23,13 @@
 #include <ostream>
 #include <sstream>
 
+#include "cpu.h"
+#include "evaluate.h"
+#include "material.h"
 #include "misc.h"
+#include "pawns.h"
 #include "search.h"
+#include "tbgen.h"
 #include "thread.h"
 #include "tt.h"
 #include "uci.h"
@@ -42,7 +47,30 @@ void on_clear_hash(const Option&) { Search::clear(); }
 void on_hash_size(const Option& o) { TT.resize(o); }
 void on_logger(const Option& o) { start_logger(o); }
 void on_threads(const Option& o) { Threads.set(o); }
+void on_eval_hash(const Option&) { Threads.main()->wait_for_search_finished(); Threads.clear(); }
+void on_shared_pawn_hash(const Option& o) { Threads.main()->wait_for_search_finished(); Pawns::SharedTable.resize(o); }
+void on_shared_material_hash(const Option& o) { Threads.main()->wait_for_search_finished(); Material::SharedTable.resize(o); }
 void on_tb_path(const Option& o) { Tablebases::init(o); }
+void on_tb_cache(const Option& o) { Threads.main()->wait_for_search_finished(); Tablebases::set_cache(size_t(o)); }
+void on_tb_warmup(const Option& o) { if (o) Tablebases::warm_up(Options["SyzygyProbeLimit"]); }
+void on_tb_gen(const Option&) {
+  Threads.main()->wait_for_search_finished();
+  TBGen::init(Options["Generated Tablebases"], Options["Generated Tablebases Path"]);
+  Tablebases::init(Options["SyzygyPath"]);
+}
+void on_use_NNUE(const Option&) { Threads.main()->wait_for_search_finished(); Eval::init_NNUE(); Threads.clear(); }
+
+void on_cpu_kernels(const Option& o) {
+
+  Threads.main()->wait_for_search_finished();
+
+  Cpu::Level l = Cpu::detected();
+  for (int i = Cpu::GENERIC; i < Cpu::LEVEL_NB; ++i)
+      if (o == Cpu::name(Cpu::Level(i)))
+          l = Cpu::Level(i);
+
+  Cpu::set(l);
+}
 
 
 /// Our case insensitive less() function as required by UCI protocol
@@ -64,9 +92,20 @@ void init(OptionsMap& o) {
   o["Contempt"]              << Option(24, -100, 100);
   o["Analysis Contempt"]     << Option("Both var Off var White var Black var Both", "Both");
   o["Threads"]               << Option(1, 1, 512, on_threads);
+  o["Deterministic"]         << Option(false);
   o["Hash"]                  << Option(16, 1, MaxHashMB, on_hash_size);
+  o["Perft Hash"]            << Option(16, 0, MaxHashMB);
+  o["Mate Hash"]             << Option(16, 1, MaxHashMB);
+  o["Compact History"]       << Option(false);
+  o["Pawn Hash"]             << Option(Pawns::DefaultTableKB, 1, 1048576, on_eval_hash);
+  o["Material Hash"]         << Option(Material::DefaultTableKB, 1, 1048576, on_eval_hash);
+  o["Eval Hash"]             << Option(Eval::DefaultCacheKB, 0, 1048576, on_eval_hash);
+  o["Shared Pawn Hash"]      << Option(0, 0, MaxHashMB, on_shared_pawn_hash);
+  o["Shared Material Hash"]  << Option(0, 0, MaxHashMB, on_shared_material_hash);
   o["Clear Hash"]            << Option(on_clear_hash);
   o["Ponder"]                << Option(false);
+  o["Fast Move"]             << Option(false);
+  o["Fast Few Moves"]        << Option(false);
   o["MultiPV"]               << Option(1, 1, 500);
   o["Skill Level"]           << Option(20, 0, 20);
   o["Move Overhead"]         << Option(30, 0, 5000);
@@ -81,6 +120,18 @@ void init(OptionsMap& o) {
   o["SyzygyProbeDepth"]      << Option(1, 1, 100);
   o["Syzygy50MoveRule"]      << Option(true);
   o["SyzygyProbeLimit"]      << Option(7, 0, 7);
+  o["SyzygyCache"]           << Option(2, 0, MaxHashMB, on_tb_cache);
+  o["SyzygyWarmup"]          << Option(false, on_tb_warmup);
+  o["Generated Tablebases"]  << Option(0, 0, TBGen::MaxPieces, on_tb_gen);
+  o["Generated Tablebases Path"] << Option("<empty>", on_tb_gen);
+  o["Use NNUE"]              << Option(false, on_use_NNUE);
+  o["EvalFile"]              << Option("<empty>", on_use_NNUE);
+  o["CPU Kernels"]           << Option("Auto var Auto var Generic var POPCNT var AVX2 var BMI2", "Auto", on_cpu_kernels);
+#ifdef SEARCH_TREE
+  o["Tree File"]             << Option("");
+  o["Tree Plies"]            << Option(6, 0, MAX_PLY);
+  o["Tree Nodes"]            << Option(1000000, 1, 100000000);
+#endif
 }
 
 
@@ -0,0 +1,177 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "evaluate.h"
+#include "movegen.h"
+#include "weak.h"
+
+namespace stockfish::Weak {
+
+namespace {
+
+  /// Static evaluation from the side to move's point of view. Unlike
+  /// Eval::evaluate it also works when in check, using only material and
+  /// piece-square tables then.
+
+  Value quick_eval(const Position& pos) {
+
+    if (!pos.checkers())
+        return Eval::evaluate(pos);
+
+    Score psq = pos.psq_score();
+    Value npm = Utility::clamp(pos.non_pawn_material(), EndgameLimit, MidgameLimit);
+    int phase = ((npm - EndgameLimit) * PHASE_MIDGAME) / (MidgameLimit - EndgameLimit);
+    Value v = Value((mg_value(psq) * phase + eg_value(psq) * (PHASE_MIDGAME - phase))
+                    / PHASE_MIDGAME);
+    return pos.side_to_move() == WHITE ? v : -v;
+  }
+
+  /// qsearch() resolves the captures of a position, by an alpha-beta search
+  /// of the captures that don't lose material, and of all evasions when in
+  /// check. At the first ply it also tries the checks, to see mates in one.
+  /// The depth is small: it only has to see the trades through.
+
+  Value qsearch(Position& pos, Value alpha, Value beta, int depth, bool firstPly) {
+
+    bool inCheck = pos.checkers();
+    Value bestValue = -VALUE_MATE;
+
+    if (!inCheck)
+    {
+        bestValue = Eval::evaluate(pos);
+        if (bestValue >= beta || !depth)
+            return bestValue;
+        alpha = std::max(alpha, bestValue);
+    }
+    else if (!depth)
+        return quick_eval(pos);
+
+    // Only the moves tried are generated, most valuable victim first
+    ExtMove moves[MAX_MOVES];
+    ExtMove* end = inCheck ? generate<EVASIONS>(pos, moves) : generate<CAPTURES>(pos, moves);
+    if (!inCheck && firstPly)
+        end = generate<QUIET_CHECKS>(pos, end);
+
+    ExtMove* last = moves;
+    for (ExtMove* m = moves; m < end; ++m)
+        if (   pos.legal(*m)
+            && (   inCheck
+                || (pos.capture(*m) && pos.see_ge(*m))
+                || (firstPly && pos.gives_check(*m))))
+        {
+            last->move = m->move;
+            last->value = PieceValue[MG][pos.piece_on(to_sq(*m))];
+            ++last;
+        }
+    std::stable_sort(moves, last, [](const ExtMove& a, const ExtMove& b) { return a.value > b.value; });
+
+    if (inCheck && last == moves)
+        return -VALUE_MATE;
+
+    for (ExtMove* m = moves; m < last; ++m)
+    {
+        StateInfo st;
+        pos.do_move(*m, st);
+        Value v = -qsearch(pos, -beta, -alpha, depth - 1, false);
+        pos.undo_move(*m);
+
+        if (v > bestValue)
+        {
+            bestValue = v;
+            if (v >= beta)
+                break;
+            alpha = std::max(alpha, v);
+        }
+    }
+    return bestValue;
+  }
+
+  /// score() is the value of the position after a move, from the point of
+  /// view of the side that made it, once the captures are resolved. Below
+  /// alpha it is only an upper bound.
+
+  Value score(Position& pos, Value alpha, int depth) {
+
+    if (!pos.checkers() && !MoveList<LEGAL>(pos).size())
+        return VALUE_DRAW;
+
+    return -qsearch(pos, -VALUE_INFINITE, -alpha, depth, true);
+  }
+
+  /// The moves scored this many temperatures below the best one are played
+  /// less than once in 3000 times, so their exact score doesn't matter. pick()
+  /// searches each move with alpha this far below the best score so far,
+  /// which cuts the searches of the bad candidates short.
+
+  constexpr double Margin = 8;
+
+} // namespace
+
+
+Move pick(Position& pos, double temperature, int depth, PRNG& rng) {
+
+  MoveList<LEGAL> moves(pos);
+  if (!moves.size())
+      return MOVE_NONE;
+
+  // The captures first, most valuable victim first, so that the margin
+  // starts from a good move
+  std::vector<ExtMove> order(moves.begin(), moves.end());
+  for (ExtMove& m : order)
+      m.value = pos.capture(m) ? PieceValue[MG][pos.piece_on(to_sq(m))] : 0;
+  std::stable_sort(order.begin(), order.end(), [](const ExtMove& a, const ExtMove& b) { return a.value > b.value; });
+
+  const Value margin = Value(int(Margin * temperature * int(PawnValueEg) / 100));
+  Value bestValue = -VALUE_INFINITE;
+  std::vector<double> scores;
+  double best = -VALUE_INFINITE;
+  for (const ExtMove& m : order)
+  {
+      StateInfo st;
+      pos.do_move(m, st);
+      Value v = score(pos, std::max(bestValue - margin, -VALUE_INFINITE), depth);
+      pos.undo_move(m);
+
+      double cp = int(v) * 100.0 / PawnValueEg;
+      scores.push_back(cp);
+      bestValue = std::max(bestValue, v);
+      best = std::max(best, cp);
+  }
+
+  double sum = 0;
+  for (double& s : scores)
+  {
+      s = std::exp((s - best) / temperature);
+      sum += s;
+  }
+
+  double r = (rng.rand<uint64_t>() >> 11) * 0x1.0p-53 * sum;
+  size_t i = 0;
+  while (i + 1 < scores.size() && (r -= scores[i]) >= 0)
+      ++i;
+
+  return order[i];
+}
+
+} // namespace stockfish::Weak
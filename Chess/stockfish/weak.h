@@ -0,0 +1,50 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2020 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WEAK_H_INCLUDED
+#define WEAK_H_INCLUDED
+
+#include "misc.h"
+#include "position.h"
+#include "types.h"
+
+namespace stockfish::Weak {
+
+/// pick() chooses a move for the lowest playing levels without the thread
+/// pool, in some tens of microseconds on the caller's thread. Every legal
+/// move is scored by a capture search of the given depth in plies of the
+/// position it leads to, and one is sampled from the softmax of the scores:
+/// the higher the temperature (in centipawns), the more random the play.
+/// Returns MOVE_NONE when there is no legal move.
+
+Move pick(Position& pos, double temperature, int depth, PRNG& rng);
+
+/// The temperatures and capture search depths of the bot's weak levels, the
+/// weakest first, matched with tools/Match.cpp against the node capped
+/// searches they replace. The random levels don't need to see the trades
+/// through.
+
+constexpr int Levels = 3;
+constexpr double Temperatures[Levels] = { 85, 40, 5 };
+constexpr int Depths[Levels] = { 2, 2, 4 };
+
+} // namespace stockfish::Weak
+
+#endif // #ifndef WEAK_H_INCLUDED
@@ -0,0 +1,13 @@
+#pragma once
+
+// Counts every heap allocation of the program linking Allocations.cpp, which
+// replaces the global operator new
+
+#include <cstdint>
+
+namespace tools {
+
+// The number of allocations made so far
+uint64_t allocations();
+
+} // namespace tools
@@ -0,0 +1,398 @@
+// Command line bench: searches the benchmark.cpp suite (or a FEN file) to a
+// fixed depth or node count, once per requested thread count, and reports
+// the total nodes, NPS, time per position and thread scaling. The results
+// can be saved as JSON and compared against such a baseline; a slowdown
+// beyond the tolerance makes it exit with 1.
+//
+//   make bench
+//   build/tools/bench --depth 13 --threads 1,2,4 --json base.json
+//   build/tools/bench --depth 13 --threads 1,2,4 --baseline base.json
+//   build/tools/bench --depth 13 --threads 8 --option "Shared Pawn Hash=16"
+//   build/tools/bench --depth 13 --nnue nn.nnue
+//
+// With --nnue the suite is run again with that network, and the NPS of both
+// evaluations compared.
+//
+// With one thread, or any number of them with --deterministic, the total node
+// count is reproducible, so it doubles as a signature of the search: it
+// changes exactly when the search does.
+
+#include "Engine.h"
+
+#include "evaluate.h"
+#include "thread.h"
+#include "uci.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stockfish {
+std::vector<std::string> setup_bench(const Position&, std::istream&);
+}
+
+using namespace stockfish;
+
+namespace {
+
+struct Args {
+    int hash = 16;
+    std::vector<int> threads = {1};
+    std::string limitType = "depth";
+    int64_t limit = 13;
+    std::string fens = "default";
+    std::string jsonPath;
+    std::string baselinePath;
+    double tolerance = 5; // percent
+    bool deterministic = false;
+    bool verbose = false;
+    std::string nnuePath;
+    std::vector<std::pair<std::string, std::string>> options;
+};
+
+struct PositionResult {
+    uint64_t nodes;
+    double ms;
+};
+
+struct RunResult {
+    int threads;
+    uint64_t nodes = 0;
+    double ms = 0;
+    std::vector<PositionResult> positions;
+
+    uint64_t nps() const { return uint64_t(1000 * nodes / std::max(ms, 1.0)); }
+};
+
+[[noreturn]] void usage(const char* error = nullptr) {
+    if (error) std::cerr << "bench: " << error << "\n\n";
+    std::cerr
+        << "usage: bench [options]\n"
+           "  --hash MB          transposition table size (16)\n"
+           "  --threads N[,N..]  thread counts to run the suite with (1)\n"
+           "  --depth D          search every position to depth D (13)\n"
+           "  --nodes N          search every position for N nodes\n"
+           "  --fens FILE        one FEN per line instead of the default "
+           "suite\n"
+           "  --json FILE        save the results as JSON\n"
+           "  --baseline FILE    compare against results saved with --json\n"
+           "  --tolerance PCT    allowed NPS drop against the baseline (5)\n"
+           "  --deterministic    reproducible multithreaded searches\n"
+           "  --option NAME=VAL  set a UCI option, can be repeated\n"
+           "  --nnue FILE        run again with this network, and compare\n"
+           "  --verbose          show the search output\n";
+    std::exit(error ? 2 : 0);
+}
+
+Args parseArgs(int argc, char* argv[]) {
+    Args a;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) usage(("missing value for " + arg).c_str());
+            return argv[++i];
+        };
+        if (arg == "--hash") {
+            a.hash = std::stoi(value());
+        } else if (arg == "--threads") {
+            a.threads.clear();
+            std::istringstream is(value());
+            std::string n;
+            while (std::getline(is, n, ','))
+                a.threads.push_back(std::stoi(n));
+        } else if (arg == "--depth" || arg == "--nodes") {
+            a.limitType = arg.substr(2);
+            a.limit = std::stoll(value());
+        } else if (arg == "--fens") {
+            a.fens = value();
+        } else if (arg == "--json") {
+            a.jsonPath = value();
+        } else if (arg == "--baseline") {
+            a.baselinePath = value();
+        } else if (arg == "--tolerance") {
+            a.tolerance = std::stod(value());
+        } else if (arg == "--deterministic") {
+            a.deterministic = true;
+        } else if (arg == "--verbose") {
+            a.verbose = true;
+        } else if (arg == "--nnue") {
+            a.nnuePath = value();
+        } else if (arg == "--option") {
+            std::string option = value();
+            size_t eq = option.find('=');
+            if (eq == std::string::npos) usage("--option needs NAME=VALUE");
+            a.options.emplace_back(option.substr(0, eq), option.substr(eq + 1));
+        } else if (arg == "--help" || arg == "-h") {
+            usage();
+        } else {
+            usage(("unknown option " + arg).c_str());
+        }
+    }
+    if (a.threads.empty()) usage("no thread counts");
+    return a;
+}
+
+std::string limitString(const Args& a) {
+    return a.limitType + " " + std::to_string(a.limit);
+}
+
+// Runs the commands setup_bench() generates for the given thread count
+RunResult runSuite(const Args& a, int threads) {
+    Position pos;
+    StateListPtr states;
+    tools::setPosition(pos, states, "startpos");
+
+    std::istringstream args(std::to_string(a.hash) + " " +
+                            std::to_string(threads) + " " +
+                            std::to_string(a.limit) + " " + a.fens + " " +
+                            a.limitType);
+    std::vector<std::string> list = setup_bench(pos, args);
+
+    RunResult res;
+    res.threads = threads;
+
+    for (const auto& cmd : list) {
+        std::istringstream is(cmd);
+        std::string token;
+        is >> token;
+
+        if (token == "setoption") {
+            std::string name, value;
+            is >> token; // "name"
+            while (is >> token && token != "value")
+                name += (name.empty() ? "" : " ") + token;
+            is >> value;
+            Options[name] = value;
+        } else if (token == "ucinewgame") {
+            Search::clear();
+        } else if (token == "position") {
+            std::string rest;
+            std::getline(is, rest);
+            tools::setPosition(pos, states, rest);
+        } else if (token == "go") {
+            Search::LimitsType limits;
+            if (a.limitType == "depth")
+                limits.depth = int(a.limit);
+            else
+                limits.nodes = a.limit;
+
+            tools::QuietCout quiet(!a.verbose);
+            auto start = std::chrono::steady_clock::now();
+            tools::searchAndWait(pos, states, limits);
+            std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+
+            uint64_t nodes = Threads.nodes_searched();
+            res.positions.push_back({nodes, elapsed.count()});
+            res.nodes += nodes;
+            res.ms += elapsed.count();
+        }
+    }
+    return res;
+}
+
+void printRun(const RunResult& r) {
+    std::cout << "\nThreads: " << r.threads << "\n"
+              << "   #        nodes       ms          nps\n";
+    for (size_t i = 0; i < r.positions.size(); ++i) {
+        const auto& p = r.positions[i];
+        std::cout << std::setw(4) << i + 1 << std::setw(13) << p.nodes
+                  << std::setw(9) << std::fixed << std::setprecision(1)
+                  << p.ms << std::setw(13)
+                  << uint64_t(1000 * p.nodes / std::max(p.ms, 1.0)) << "\n";
+    }
+    std::cout << "Total nodes : " << r.nodes << "\n"
+              << "Total time  : " << std::setprecision(0) << r.ms << " ms\n"
+              << "Mean time   : " << std::setprecision(1)
+              << r.ms / std::max<size_t>(r.positions.size(), 1)
+              << " ms/position\n"
+              << "Nodes/second: " << r.nps() << "\n"
+              << Threads.hash_report() << "\n";
+}
+
+void printScaling(const std::vector<RunResult>& runs) {
+    if (runs.size() < 2) return;
+
+    const RunResult& base = runs.front();
+    std::cout << "\nThread scaling (against " << base.threads
+              << " thread(s))\n"
+              << " threads          nps  speedup  efficiency\n";
+    for (const auto& r : runs) {
+        double speedup = double(r.nps()) / std::max<uint64_t>(base.nps(), 1);
+        double efficiency = speedup * base.threads / r.threads;
+        std::cout << std::setw(8) << r.threads << std::setw(13) << r.nps()
+                  << std::setw(8) << std::setprecision(2) << speedup << "x"
+                  << std::setw(11) << std::setprecision(0)
+                  << 100 * efficiency << "%\n";
+    }
+}
+
+// Same thread counts with the classical evaluation and the network
+void printEvalComparison(const std::vector<RunResult>& classical,
+                         const std::vector<RunResult>& nnue) {
+    std::cout << "\nClassical against NNUE evaluation\n"
+              << " threads    classical         nnue  nnue speed   nodes\n";
+    for (size_t i = 0; i < classical.size(); ++i) {
+        const RunResult& c = classical[i];
+        const RunResult& n = nnue[i];
+        std::cout << std::setw(8) << c.threads << std::setw(13) << c.nps()
+                  << std::setw(13) << n.nps() << std::setw(11)
+                  << std::setprecision(2)
+                  << double(n.nps()) / std::max<uint64_t>(c.nps(), 1) << "x"
+                  << std::setw(7) << std::setprecision(0)
+                  << 100.0 * n.nodes / std::max<uint64_t>(c.nodes, 1) << "%\n";
+    }
+}
+
+void writeJson(const Args& a, const std::vector<RunResult>& runs) {
+    std::ofstream f(a.jsonPath);
+    if (!f) {
+        std::cerr << "bench: can't write " << a.jsonPath << "\n";
+        std::exit(2);
+    }
+    f << "{\n"
+      << "  \"limit\": \"" << limitString(a) << "\",\n"
+      << "  \"hash\": " << a.hash << ",\n"
+      << "  \"fens\": \"" << a.fens << "\",\n"
+      << "  \"deterministic\": " << a.deterministic << ",\n"
+      << "  \"runs\": [\n";
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const auto& r = runs[i];
+        f << "    {\"threads\": " << r.threads << ", \"nodes\": " << r.nodes
+          << ", \"timeMs\": " << uint64_t(r.ms) << ", \"nps\": " << r.nps()
+          << "}" << (i + 1 < runs.size() ? "," : "") << "\n";
+    }
+    f << "  ]\n}\n";
+}
+
+// The number after "key": at or after pos, or -1
+int64_t jsonNumber(const std::string& s, const std::string& key, size_t pos) {
+    size_t i = s.find("\"" + key + "\":", pos);
+    if (i == std::string::npos) return -1;
+    return std::strtoll(s.c_str() + i + key.size() + 3, nullptr, 10);
+}
+
+std::string jsonString(const std::string& s, const std::string& key) {
+    size_t i = s.find("\"" + key + "\":");
+    if (i == std::string::npos) return "";
+    size_t begin = s.find('"', i + key.size() + 3);
+    size_t end = s.find('"', begin + 1);
+    if (begin == std::string::npos || end == std::string::npos) return "";
+    return s.substr(begin + 1, end - begin - 1);
+}
+
+// Returns false if a run is slower than the baseline allows
+bool compareBaseline(const Args& a, const std::vector<RunResult>& runs) {
+    std::ifstream f(a.baselinePath);
+    if (!f) {
+        std::cerr << "bench: can't read " << a.baselinePath << "\n";
+        std::exit(2);
+    }
+    std::stringstream buf;
+    buf << f.rdbuf();
+    std::string s = buf.str();
+
+    if (jsonString(s, "limit") != limitString(a) ||
+        jsonString(s, "fens") != a.fens) {
+        std::cerr << "bench: the baseline was recorded with \""
+                  << jsonString(s, "limit") << "\" on \""
+                  << jsonString(s, "fens") << "\", can't compare\n";
+        std::exit(2);
+    }
+
+    bool baseDeterministic = jsonNumber(s, "deterministic", 0) == 1;
+
+    // threads -> {nodes, nps}
+    std::map<int64_t, std::pair<int64_t, int64_t>> base;
+    for (size_t i = s.find("\"threads\":"); i != std::string::npos;
+         i = s.find("\"threads\":", i + 1)) {
+        base[jsonNumber(s, "threads", i)] = {jsonNumber(s, "nodes", i),
+                                             jsonNumber(s, "nps", i)};
+    }
+
+    bool ok = true;
+    std::cout << "\nAgainst " << a.baselinePath << " (tolerance "
+              << std::setprecision(1) << a.tolerance << "%)\n"
+              << " threads     base nps          nps   change\n";
+    for (const auto& r : runs) {
+        auto it = base.find(r.threads);
+        if (it == base.end()) {
+            std::cout << std::setw(8) << r.threads << "  not in baseline\n";
+            continue;
+        }
+        auto [baseNodes, baseNps] = it->second;
+        double change = 100.0 * (double(r.nps()) / std::max<int64_t>(baseNps, 1) - 1);
+        bool slow = change < -a.tolerance;
+        ok = ok && !slow;
+
+        std::cout << std::setw(8) << r.threads << std::setw(13) << baseNps
+                  << std::setw(13) << r.nps() << std::setw(8)
+                  << std::showpos << change << std::noshowpos << "%"
+                  << (slow ? "  <-- REGRESSION" : "") << "\n";
+
+        bool reproducible = r.threads == 1 || (a.deterministic && baseDeterministic);
+        if (reproducible && int64_t(r.nodes) != baseNodes)
+            std::cout << "         signature changed: " << baseNodes << " -> "
+                      << r.nodes << " nodes, the search itself changed\n";
+    }
+    if (!ok)
+        std::cout << "\nNPS REGRESSION beyond " << a.tolerance << "%\n";
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Args a = parseArgs(argc, argv);
+
+    tools::initEngine();
+    Options["Deterministic"] = std::string(a.deterministic ? "true" : "false");
+    for (const auto& [name, value] : a.options) {
+        if (!Options.count(name)) usage(("no option " + name).c_str());
+        Options[name] = value;
+    }
+
+    std::cout << engine_info() << "\n"
+              << "Bench: " << limitString(a) << ", hash " << a.hash
+              << " MB, positions: " << a.fens
+              << (a.deterministic ? ", deterministic" : "") << "\n";
+
+    std::vector<RunResult> runs;
+    for (int threads : a.threads) {
+        runs.push_back(runSuite(a, threads));
+        printRun(runs.back());
+    }
+    printScaling(runs);
+
+    if (!a.nnuePath.empty()) {
+        Options["EvalFile"] = a.nnuePath;
+        Options["Use NNUE"] = std::string("true");
+        if (!Eval::useNNUE) {
+            std::cerr << "bench: can't load the network " << a.nnuePath << "\n";
+            std::exit(2);
+        }
+
+        std::cout << "\nNNUE: " << Eval::NNUE::description() << "\n";
+        std::vector<RunResult> nnueRuns;
+        for (int threads : a.threads) {
+            nnueRuns.push_back(runSuite(a, threads));
+            printRun(nnueRuns.back());
+        }
+        printEvalComparison(runs, nnueRuns);
+
+        Options["Use NNUE"] = std::string("false");
+    }
+
+    if (!a.jsonPath.empty())
+        writeJson(a, runs);
+
+    bool ok = a.baselinePath.empty() || compareBaseline(a, runs);
+
+    tools::exitEngine();
+    return ok ? 0 : 1;
+}
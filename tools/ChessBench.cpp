@@ -0,0 +1,422 @@
+// Microbenchmarks of the chess:: rules engine the UI plays with: move
+// generation per piece type, the check and game end tests, the FEN writers
+// and whole moves through Board. The inputs are replayed games plus seeded
+// random games, and every position of them is benchmarked.
+//
+//   make chess-bench
+//   chess-bench.exe [--reps N] [--warmup N] [--random N] [--plies N]
+//                   [--seed N] [--filter STR]
+//
+// The chess module includes <windows.h> (through core/Utils.h), so unlike
+// the engine tools this one is a console program built with the Windows
+// toolchain. It reports the median and best time per call and heap
+// allocations per call.
+
+#include "Allocations.h"
+
+#include "../Chess/chess/Board.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace chess;
+
+namespace {
+
+// Games in UCI notation: the Opera game, then games the engine played
+// against itself from the four main first moves
+const char* const Games[] = {
+    "e2e4 e7e5 g1f3 d7d6 d2d4 c8g4 d4e5 g4f3 d1f3 d6e5 f1c4 g8f6 f3b3 d8e7 "
+    "b1c3 c7c6 c1g5 b7b5 c3b5 c6b5 c4b5 b8d7 e1c1 a8d8 d1d7 d8d7 h1d1 e7e6 "
+    "b5d7 f6d7 b3b8 d7b8 d1d8",
+    "e2e4 d7d5 e4d5 c7c6 g1f3 c6d5 f1b5 c8d7 b5d7 b8d7 d2d4 e7e6 e1g1 g8f6 "
+    "c1e3 f8e7 c2c3 e8g8 b1d2 d8c7 d1b3 a7a5 a2a4 a8a6 b3a2 a6c6 h2h3 f8a8 "
+    "a2b1 e7d6 f1c1 h7h6 b1d3 a8c8 c1f1 d7f8 d2b3 f8g6 a1c1 c7d8 b3d2 d6b8 "
+    "b2b3 b7b6 f1d1 g8h8 g2g3 b8d6 c3c4 h8g8 d3e2 f6h7 g1g2 h7f6 c1b1 d8c7 "
+    "f3h2 g6e7 e2d3 e7f5 g2g1 d6g3 h2g4 f6h5 c4d5 c6c3 d3e4 g3f4 d5e6 f4e3 "
+    "e6f7 c7f7 g4e3 h5g3 e4f3 f5e3 f3f7 g8f7 f2e3 g3f5 d2c4 f5e3 c4d6 f7f8 "
+    "d6c8 e3d1 c8b6 d1e3 b3b4 a5b4 b1b4 e3f5 d4d5 c3a3 b6c4 a3a2 a4a5 f5d4 "
+    "b4b8 f8e7 d5d6 e7e6 b8e8 e6d7 e8e7 d7c6 e7c7 c6b5 d6d7 d4e6 c4d6 b5b4 "
+    "c7c4 b4b3 c4e4 a2a1 g1h2 e6d8 e4e8 a1d1 e8d8 d1d2 h2h1 d2d1 h1g2 d1d2 "
+    "g2f1 d2d6 a5a6 b3c3 a6a7 d6d1 f1e2 d1d2 e2e1 d2d6 a7a8q d6e6 e1d1 e6d6",
+    "d2d4 d7d5 b1c3 g8f6 f2f3 c7c5 e2e4 b8c6 f1b5 e7e6 c1e3 c5d4 d1d4 c8d7 "
+    "d4d2 a7a6 b5c6 d7c6 e4d5 f6d5 c3d5 d8d5 d2d5 c6d5 g1e2 f8b4 c2c3 b4e7 "
+    "b2b3 e8g8 e1f2 e6e5 h1e1 f8c8 c3c4 d5c6 a1d1 c8d8 e3b6 d8e8 e2c3 e7b4 "
+    "d1c1 a8c8 e1d1 f7f5 c1c2 e8e6 b6e3 e6d6 c2d2 d6d2 e3d2 g8f7 f2e2 c8d8 "
+    "d2e3 d8d1 c3d1 b4d6 d1c3 b7b5 e3b6 f7e6 a2a4 b5b4 c3d1 e5e4 d1e3 g7g6 "
+    "e3c2 e6d7 a4a5 g6g5 e2f2 e4f3 g2f3 g5g4 f3g4 f5g4 f2g1 c6e4 c4c5 d6h2 "
+    "g1h2 e4c2 h2g3 h7h5 g3h4 d7c6 b6d8 c2b3 d8g5 b3f7 g5f6 c6c5 f6e7 c5b5 "
+    "e7d8 b4b3 d8f6 b5a5 f6e5 a5b4 e5b2 a6a5 b2f6 b4a3 h4g3 b3b2 f6b2 a3b2 "
+    "g3g2 a5a4 g2g3 a4a3 g3h4 a3a2 h4g3 a2a1q g3f2 g4g3 f2g2 f7d5 g2g3 a1f1 "
+    "g3h4 f1f4 h4h3 f4g4 h3h2 g4g2",
+    "c2c4 e7e5 b1c3 b8c6 g1f3 e5e4 c3e4 d7d5 c4d5 c6e7 e4g3 e7d5 e2e4 d5b6 "
+    "d2d4 c8d7 d1c2 f8b4 c1d2 b4d2 f3d2 c7c6 g3h5 d7g4 h5f4 d8d4 f1e2 g8f6 "
+    "e1g1 g4e6 a2a3 e6f5 f1e1 e8g8 e2f1 d4d6 f4d3 f6g4 d2f3 f5g6 a3a4 b6d7 "
+    "a1c1 f8e8 h2h3 g4h6 e4e5 d6d5 c2c3 g6d3 f1d3 d7f8 a4a5 d5d7 a5a6 a8c8 "
+    "a6b7 d7b7 c3a3 c8b8 e1d1 f8e6 d3e4 e8c8 e4c2 c8d8 d1d8 b8d8 c2e4 b7b6 "
+    "c1c6 b6b5 c6c1 b5b8 g2g3 a7a6 g1g2 g7g6 c1c4 b8a7 a3b4 d8b8 b4d2 g8g7 "
+    "f3g5 a7e7 g5e6 e7e6 d2c3 b8b2 c4c8 b2b5 e4d3 e6d5 g2h2 b5b3 c8d8 d5d8 "
+    "c3b3 d8d4 h2g1 d4e5 d3a6 h6f5 b3f3 e5c5 g1g2 c5d4 f3a8 f5d6 a6b7 d4e5 "
+    "b7c6 h7h6 a8d8 g6g5 d8a8 d6c4 a8a2 e5c3 c6e4 c3d4 e4f3 c4d6 g2h2 d6c4 "
+    "h2g2 d4c3 f3d1 c3e1 d1e2 c4e5 a2b2 f7f6 b2b5 g7g8 b5b2 g8f8 b2a3 f8g7",
+    "g1f3 d7d5 d2d4 g8f6 c1f4 c7c6 e2e3 f6h5 f4b8 a8b8 f1e2 g7g6 b1d2 h5f6 "
+    "c2c4 f8g7 c4d5 f6d5 a2a3 e8g8 a1b1 d5f6 e3e4 e7e5 d1a4 e5d4 a4a7 d8c7 "
+    "f3d4 f8e8 f2f3 c8d7 d4c2 f6h5 a7f2 b8d8 e2f1 d7e6 g2g3 d8d7 d2c4 c6c5 "
+    "c2e3 b7b5 f1e2 b5c4 e1g1 g7d4 f1c1 h5f4 g3f4 c7f4 c1c3 e8b8 g1h1 d4c3 "
+    "e3c4 f4f6 b2b4 c5b4 a3b4 b8b4 c4a3 b4e4 b1f1 e4e2 f2e2 d7d2 e2e3 f6h4 "
+    "e3d2 c3d2 f1g1 d2f4 g1g2 h4e1 g2g1 e1d2 g1g2 d2d1 g2g1 d1f3 g1g2 f3d1 "
+    "g2g1 e6d5",
+};
+
+struct Args {
+    int reps = 10;
+    int warmup = 2;
+    int randomGames = 8;
+    int plies = 80;
+    uint64_t seed = 1;
+    std::string filter;
+};
+
+[[noreturn]] void usage(const char* error = nullptr) {
+    if (error) std::cerr << "chess-bench: " << error << "\n\n";
+    std::cerr << "usage: chess-bench [options]\n"
+                 "  --reps N       timed passes over the corpus (10)\n"
+                 "  --warmup N     untimed passes before them (2)\n"
+                 "  --random N     random games added to the corpus (8)\n"
+                 "  --plies N      maximum length of the random games (80)\n"
+                 "  --seed N       seed of the random games (1)\n"
+                 "  --filter STR   only run benchmarks whose name contains "
+                 "STR\n";
+    std::exit(error ? 2 : 0);
+}
+
+Args parseArgs(int argc, char* argv[]) {
+    Args a;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) usage(("missing value for " + arg).c_str());
+            return argv[++i];
+        };
+        if (arg == "--reps") a.reps = std::max(std::stoi(value()), 1);
+        else if (arg == "--warmup") a.warmup = std::stoi(value());
+        else if (arg == "--random") a.randomGames = std::stoi(value());
+        else if (arg == "--plies") a.plies = std::stoi(value());
+        else if (arg == "--seed") a.seed = std::stoull(value());
+        else if (arg == "--filter") a.filter = value();
+        else if (arg == "--help" || arg == "-h") usage();
+        else usage(("unknown option " + arg).c_str());
+    }
+    return a;
+}
+
+// Board logs every position to std::clog. It's formatted as usual but
+// dropped, so the timings don't depend on the console.
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+void ignoreResult(FullMove, Side) {}
+void ignoreDraw(FullMove, std::string_view) {}
+void ignorePromotion(Side) {}
+
+std::unique_ptr<Board> newBoard() {
+    auto board = std::make_unique<Board>(ignorePromotion, ignoreResult,
+                                         ignoreResult, ignoreDraw);
+    board->reset();
+    return board;
+}
+
+using Game = std::vector<FullMove>;
+
+// The legal moves of the side to move, with pawns promoting to queens
+std::vector<FullMove> legalMoves(const Board& board) {
+    std::vector<FullMove> res;
+    std::vector<Move> moves;
+    const BoardState& state = board.getState();
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            auto* ptr = state.at(x, y);
+            if (ptr == nullptr || ptr->getSide() != board.getCurrentSide())
+                continue;
+            ptr->getValidMoves({x, y}, state, moves);
+            for (auto m : moves) {
+                res.emplace_back(Pos{x, y}, m.pos,
+                                 m.type == Move::Type::Promotion
+                                         ? PromotionResult::Queen
+                                         : PromotionResult::None);
+            }
+        }
+    }
+    return res;
+}
+
+Game parseGame(const char* uci) {
+    Game res;
+    std::istringstream is(uci);
+    std::string m;
+    while (is >> m) {
+        res.emplace_back(Pos{m[0] - 'a', m[1] - '1'},
+                         Pos{m[2] - 'a', m[3] - '1'},
+                         m.size() > 4 ? PromotionResult(m[4])
+                                      : PromotionResult::None);
+    }
+    return res;
+}
+
+Game randomGame(std::mt19937_64& rng, int plies) {
+    Game res;
+    auto board = newBoard();
+    for (int i = 0; i < plies; ++i) {
+        auto moves = legalMoves(*board);
+        if (moves.empty()) break;
+        res.push_back(moves[rng() % moves.size()]);
+        board->doFullMove(res.back());
+    }
+    return res;
+}
+
+// Plays the first plies moves of game on a new board
+std::unique_ptr<Board> replay(const Game& game, size_t plies) {
+    auto board = newBoard();
+    for (size_t i = 0; i < plies; ++i) {
+        auto moves = legalMoves(*board);
+        auto m = game[i];
+        if (std::none_of(moves.begin(), moves.end(), [m](FullMove l) {
+                return l.from == m.from && l.to == m.to;
+            })) {
+            std::cerr << "chess-bench: illegal move " << m << " at ply "
+                      << i + 1 << " of a game\n";
+            std::exit(2);
+        }
+        board->doFullMove(m);
+    }
+    return board;
+}
+
+// Every position of the games, each on a board of its own: the board owns
+// the pieces a BoardState points to, and a piece's first move flag must
+// match the position
+struct Corpus {
+    std::vector<Game> games;
+    std::vector<std::unique_ptr<Board>> boards;
+    std::vector<const BoardState*> states;
+
+    // The moves of the side to move not yet tested for check
+    std::vector<std::vector<FullMove>> pseudoLegal;
+};
+
+void buildCorpus(Corpus& c, const Args& a) {
+    for (const char* g : Games)
+        c.games.push_back(parseGame(g));
+    std::mt19937_64 rng(a.seed);
+    for (int i = 0; i < a.randomGames; ++i)
+        c.games.push_back(randomGame(rng, a.plies));
+
+    std::vector<Move> moves;
+    for (const auto& game : c.games) {
+        for (size_t ply = 0; ply <= game.size(); ++ply) {
+            c.boards.push_back(replay(game, ply));
+            const BoardState& state = c.boards.back()->getState();
+            c.states.push_back(&state);
+
+            c.pseudoLegal.emplace_back();
+            for (int y = 0; y < 8; ++y) {
+                for (int x = 0; x < 8; ++x) {
+                    auto* ptr = state.at(x, y);
+                    if (ptr == nullptr ||
+                        ptr->getSide() != c.boards.back()->getCurrentSide())
+                        continue;
+                    ptr->getValidMovesDontTestCheck({x, y}, state, moves);
+                    for (auto m : moves)
+                        c.pseudoLegal.back().emplace_back(Pos{x, y}, m.pos);
+                }
+            }
+        }
+    }
+}
+
+// Keeps the compiler from optimizing the benchmarked calls away
+volatile uint64_t sink;
+
+struct Benchmark {
+    std::string name;
+    // One pass over the corpus, returns the number of calls it made
+    std::function<uint64_t()> pass;
+    // Untimed preparation of each pass, if any
+    std::function<void()> setup = nullptr;
+};
+
+std::vector<Benchmark> benchmarks(Corpus& c) {
+    std::vector<Benchmark> res;
+
+    for (char letter : {'K', 'Q', 'R', 'B', 'N', 'P'}) {
+        res.push_back({std::string("getValidMoves(") + letter + ")",
+                       [&c, letter] {
+            std::vector<Move> moves;
+            uint64_t n = 0, calls = 0;
+            for (const BoardState* state : c.states) {
+                for (int y = 0; y < 8; ++y) {
+                    for (int x = 0; x < 8; ++x) {
+                        auto* ptr = state->at(x, y);
+                        if (ptr == nullptr || toupper(ptr->getLetter()) != letter)
+                            continue;
+                        ptr->getValidMoves({x, y}, *state, moves);
+                        n += moves.size();
+                        ++calls;
+                    }
+                }
+            }
+            sink = n;
+            return calls;
+        }});
+    }
+
+    // update() only reads the squares, so the copies are made once
+    auto copies = std::make_shared<std::vector<BoardState>>();
+    res.push_back({"BoardState::update", [copies] {
+        uint64_t n = 0;
+        for (auto& state : *copies) {
+            state.update();
+            n += state.getEnPassantTarget().x();
+        }
+        sink = n;
+        return uint64_t(copies->size());
+    }, [&c, copies] {
+        if (copies->empty()) {
+            for (const BoardState* state : c.states)
+                copies->push_back(*state);
+        }
+    }});
+
+    res.push_back({"moveLeavesInCheck", [&c] {
+        uint64_t n = 0, calls = 0;
+        for (size_t i = 0; i < c.states.size(); ++i) {
+            for (auto m : c.pseudoLegal[i])
+                n += c.states[i]->moveLeavesInCheck(m.from, m.to);
+            calls += c.pseudoLegal[i].size();
+        }
+        sink = n;
+        return calls;
+    }});
+
+    res.push_back({"testWinOrStalemate", [&c] {
+        uint64_t n = 0;
+        for (size_t i = 0; i < c.states.size(); ++i)
+            n += int(c.states[i]->testWinOrStalemate(
+                    c.boards[i]->getCurrentSide()));
+        sink = n;
+        return uint64_t(c.states.size());
+    }});
+
+    res.push_back({"getFEN", [&c] {
+        uint64_t n = 0;
+        for (const BoardState* state : c.states)
+            n += state->getFEN().size();
+        sink = n;
+        return uint64_t(c.states.size());
+    }});
+
+    res.push_back({"getShortenedFEN", [&c] {
+        uint64_t n = 0;
+        for (const BoardState* state : c.states)
+            n += state->getShortenedFEN().size();
+        sink = n;
+        return uint64_t(c.states.size());
+    }});
+
+    // Whole games through tryMove and finishMove, on boards set up
+    // beforehand so that only the moves are timed
+    auto boards = std::make_shared<std::vector<std::unique_ptr<Board>>>();
+    res.push_back({"tryMove+finishMove", [&c, boards] {
+        uint64_t calls = 0;
+        for (size_t i = 0; i < c.games.size(); ++i) {
+            for (auto m : c.games[i])
+                (*boards)[i]->doFullMove(m);
+            calls += c.games[i].size();
+        }
+        return calls;
+    }, [&c, boards] {
+        boards->clear();
+        for (size_t i = 0; i < c.games.size(); ++i)
+            boards->push_back(newBoard());
+    }});
+
+    return res;
+}
+
+struct Result {
+    uint64_t calls;
+    double medianNs, bestNs, allocs;
+};
+
+Result run(const Benchmark& b, const Args& a) {
+    for (int i = 0; i < a.warmup; ++i) {
+        if (b.setup) b.setup();
+        b.pass();
+    }
+
+    std::vector<double> nsPerCall;
+    uint64_t calls = 0, totalCalls = 0, totalAllocs = 0;
+
+    for (int i = 0; i < a.reps; ++i) {
+        if (b.setup) b.setup();
+
+        uint64_t allocsBefore = tools::allocations();
+        auto start = std::chrono::steady_clock::now();
+        calls = b.pass();
+        std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        totalAllocs += tools::allocations() - allocsBefore;
+
+        nsPerCall.push_back(elapsed.count() / std::max<uint64_t>(calls, 1));
+        totalCalls += calls;
+    }
+
+    std::sort(nsPerCall.begin(), nsPerCall.end());
+    totalCalls = std::max<uint64_t>(totalCalls, 1);
+    return {calls, nsPerCall[nsPerCall.size() / 2], nsPerCall.front(),
+            double(totalAllocs) / totalCalls};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Args a = parseArgs(argc, argv);
+
+    NullBuffer null;
+    std::streambuf* clogBuffer = std::clog.rdbuf(&null);
+
+    Corpus corpus;
+    buildCorpus(corpus, a);
+
+    std::cout << "Corpus: " << corpus.games.size() << " games, "
+              << corpus.states.size() << " positions, " << a.warmup
+              << " warmup and " << a.reps << " timed passes\n\n"
+              << std::left << std::setw(22) << "benchmark" << std::right
+              << std::setw(10) << "calls" << std::setw(12) << "median ns"
+              << std::setw(10) << "best ns" << std::setw(10) << "allocs"
+              << "\n";
+
+    for (const auto& b : benchmarks(corpus)) {
+        if (b.name.find(a.filter) == std::string::npos)
+            continue;
+        Result r = run(b, a);
+        std::cout << std::left << std::setw(22) << b.name << std::right
+                  << std::setw(10) << r.calls << std::fixed
+                  << std::setprecision(1) << std::setw(12) << r.medianNs
+                  << std::setw(10) << r.bestNs << std::setprecision(2)
+                  << std::setw(10) << r.allocs << "\n";
+    }
+
+    std::clog.rdbuf(clogBuffer);
+}
@@ -0,0 +1,126 @@
+#include "Engine.h"
+
+#include "bitboard.h"
+#include "endgame.h"
+#include "movegen.h"
+#include "thread.h"
+#include "uci.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <sstream>
+
+using namespace stockfish;
+
+namespace stockfish::PSQT {
+void init();
+}
+
+// The tools only look at the search results through the thread pool
+namespace stockfish::Search {
+void onBestMoveFound(Move) {}
+void onIterationFinished(const RootMoves&, size_t, Depth) {}
+} // namespace stockfish::Search
+
+namespace stockfish {
+std::vector<std::string> setup_bench(const Position&, std::istream&);
+}
+
+namespace tools {
+
+constexpr static const char* StartFEN =
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+static std::vector<StartupStep> startup;
+
+void initEngine() {
+    startup.clear();
+    auto start = std::chrono::steady_clock::now();
+    auto step = [&start](const char* name, auto&& f) {
+        f();
+        auto now = std::chrono::steady_clock::now();
+        startup.push_back(
+            {name, std::chrono::duration<double, std::micro>(now - start).count()});
+        start = now;
+    };
+
+    step("UCI::init", [] { UCI::init(Options); });
+    step("PSQT::init", [] { PSQT::init(); });
+    step("Bitboards::init", [] { Bitboards::init(); });
+    step("Position::init", [] { Position::init(); });
+    step("Endgames::init", [] { Endgames::init(); });
+    step("Threads.set", [] { Threads.set(Options["Threads"]); });
+    step("Search::clear", [] { Search::clear(); });
+}
+
+const std::vector<StartupStep>& startupSteps() {
+    return startup;
+}
+
+void exitEngine() {
+    Threads.set(0);
+}
+
+void setPosition(Position& pos, StateListPtr& states, const std::string& str) {
+    std::istringstream is(str);
+    std::string token, fen;
+
+    is >> token;
+    if (token == "startpos") {
+        fen = StartFEN;
+        is >> token; // "moves"
+    } else if (token == "fen") {
+        while (is >> token && token != "moves")
+            fen += token + " ";
+    }
+
+    states = std::make_unique<std::deque<StateInfo>>(1);
+    pos.set(fen, Options["UCI_Chess960"], &states->back(), Threads.main());
+
+    Move m;
+    while (is >> token && (m = UCI::to_move(pos, token)) != MOVE_NONE) {
+        states->emplace_back();
+        pos.do_move(m, states->back());
+    }
+}
+
+std::vector<std::string> positionCorpus(int playoutPlies, uint64_t seed) {
+    Position pos;
+    StateListPtr states;
+    setPosition(pos, states, "startpos");
+
+    std::istringstream args("16 1 1 default depth");
+    std::vector<std::string> res;
+    PRNG rng(seed);
+    bool chess960 = false;
+
+    for (const auto& cmd : setup_bench(pos, args)) {
+        if (cmd.find("UCI_Chess960") != std::string::npos)
+            chess960 = cmd.find("true") != std::string::npos;
+        if (chess960 || cmd.rfind("position ", 0) != 0)
+            continue;
+
+        setPosition(pos, states, cmd.substr(9));
+        res.push_back(pos.fen());
+        for (int ply = 0; ply < playoutPlies; ++ply) {
+            MoveList<LEGAL> moves(pos);
+            if (!moves.size())
+                break;
+            Move m = moves.begin()[rng.rand<uint64_t>() % moves.size()];
+            states->emplace_back();
+            pos.do_move(m, states->back());
+            res.push_back(pos.fen());
+        }
+    }
+    return res;
+}
+
+void searchAndWait(Position& pos, StateListPtr& states,
+                   Search::LimitsType& limits) {
+    limits.startTime = now();
+    Threads.start_thinking(pos, states, limits);
+    Threads.main()->wait_for_search_finished();
+}
+
+} // namespace tools
@@ -0,0 +1,56 @@
+#pragma once
+
+// Shared setup of the command line tools: they link the engine without the
+// Windows UI, so they have to provide the search hooks chess::Bot normally
+// implements and do the initialization Bot's constructor does.
+
+#include "position.h"
+#include "search.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace tools {
+
+void initEngine();
+void exitEngine();
+
+// The steps of the last initEngine(), with the time each took
+struct StartupStep {
+    const char* name;
+    double us;
+};
+const std::vector<StartupStep>& startupSteps();
+
+// Sets pos from a "fen <fen> [moves ...]" or "startpos [moves ...]" string,
+// like the UCI position command
+void setPosition(stockfish::Position& pos, stockfish::StateListPtr& states,
+                 const std::string& str);
+
+// FENs of the positions of the bench suite (without the Chess960 one), each
+// followed by the positions of a pseudo-random playout of up to
+// playoutPlies plies from it. The same seed gives the same corpus.
+std::vector<std::string> positionCorpus(int playoutPlies, uint64_t seed = 1);
+
+// Searches pos with the given limits and waits for the search to finish.
+// Like Threads.start_thinking, it takes over states.
+void searchAndWait(stockfish::Position& pos, stockfish::StateListPtr& states,
+                   stockfish::Search::LimitsType& limits);
+
+// Silences std::cout, where the search prints its info lines, while it lives
+class QuietCout {
+public:
+    explicit QuietCout(bool enabled = true)
+            : old(enabled ? std::cout.rdbuf(nullptr) : nullptr) {}
+    ~QuietCout() {
+        if (old) std::cout.rdbuf(old);
+    }
+    QuietCout(const QuietCout&) = delete;
+    QuietCout& operator=(const QuietCout&) = delete;
+
+private:
+    std::streambuf* old;
+};
+
+} // namespace tools
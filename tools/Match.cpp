@@ -0,0 +1,213 @@
+// Command line match of the bot's weak levels: plays each level's softmax
+// policy (Weak::pick at Weak::Temperatures and Weak::Depths) against the depth 1 search
+// capped at 5, 10 and 50 nodes that the level used to run, and reports the
+// policy's score with its 95% confidence interval. The levels are meant to
+// play like the old ones, so each score should be 50% within the error. It
+// also reports the mean and the longest time of the policy's picks.
+//
+//   make match
+//   build/tools/match
+//   build/tools/match --games 2000 --level 2
+//   build/tools/match --level 1 --temperature 40
+//   build/tools/match --level 2 --depth 2
+//
+// The games start from the start position and alternate colors. Both sides
+// are seeded, so the same options replay the same games. Games end by the
+// rules, or as a draw after --max-plies plies.
+
+#include "Engine.h"
+
+#include "movegen.h"
+#include "thread.h"
+#include "uci.h"
+#include "weak.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+using namespace stockfish;
+
+namespace {
+
+// The node caps of the searches levels 0, 1 and 2 used to run at depth 1
+constexpr int64_t OldNodes[Weak::Levels] = {5, 10, 50};
+
+struct Args {
+    int games = 400;
+    int level = -1; // All of them
+    double temperature = 0; // The level's own
+    int depth = 0; // The level's own
+    int maxPlies = 400;
+    uint64_t seed = 1;
+    bool verbose = false;
+};
+
+[[noreturn]] void usage(const char* error = nullptr) {
+    if (error) std::cerr << "match: " << error << "\n\n";
+    std::cerr
+        << "usage: match [options]\n"
+           "  --games N          games per level (400)\n"
+           "  --level L          play only this level, 0-"
+        << Weak::Levels - 1
+        << "\n"
+           "  --temperature CP   softmax temperature instead of the level's\n"
+           "  --depth N          capture search depth instead of the level's\n"
+           "  --max-plies N      adjudicate a draw after N plies (400)\n"
+           "  --seed N           seed of the policy (1)\n"
+           "  --verbose          print the moves of every game\n";
+    std::exit(error ? 2 : 0);
+}
+
+Args parseArgs(int argc, char* argv[]) {
+    Args a;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) usage(("missing value for " + arg).c_str());
+            return argv[++i];
+        };
+        if (arg == "--games") {
+            a.games = std::stoi(value());
+        } else if (arg == "--level") {
+            a.level = std::stoi(value());
+        } else if (arg == "--temperature") {
+            a.temperature = std::stod(value());
+        } else if (arg == "--depth") {
+            a.depth = std::stoi(value());
+        } else if (arg == "--max-plies") {
+            a.maxPlies = std::stoi(value());
+        } else if (arg == "--seed") {
+            a.seed = std::stoull(value());
+        } else if (arg == "--verbose") {
+            a.verbose = true;
+        } else if (arg == "--help" || arg == "-h") {
+            usage();
+        } else {
+            usage(("unknown option " + arg).c_str());
+        }
+    }
+    if (a.games < 1) usage("no games");
+    if (a.level >= Weak::Levels) usage("no such level");
+    if (a.temperature < 0 || a.depth < 0 || !a.seed)
+        usage("bad temperature, depth or seed");
+    return a;
+}
+
+// The old level's move: a depth 1 search of the game so far, like the bot
+// ran it, with the node cap checked at every node
+Move oldMove(const std::string& game, int64_t nodes) {
+    Position pos;
+    StateListPtr states;
+    tools::setPosition(pos, states, game);
+
+    Search::LimitsType limits;
+    limits.depth = 1;
+    limits.nodes = nodes;
+    tools::QuietCout quiet;
+    tools::searchAndWait(pos, states, limits);
+    return Threads.main()->rootMoves[0].pv[0];
+}
+
+bool insufficientMaterial(const Position& pos) {
+    return !pos.pieces(PAWN) && pos.non_pawn_material() <= BishopValueMg;
+}
+
+// The time the policy's picks took
+struct PickTimes {
+    double totalUs = 0;
+    double maxUs = 0;
+    int picks = 0;
+};
+
+// Plays one game, returns the policy's score: 1, 0.5 or 0
+double play(const Args& a, int level, Color policyColor, PRNG& rng, PickTimes& times) {
+    double temperature = a.temperature ? a.temperature : Weak::Temperatures[level];
+    int depth = a.depth ? a.depth : Weak::Depths[level];
+    std::string game = "startpos moves";
+    Position pos;
+    StateListPtr states;
+    tools::setPosition(pos, states, game);
+    Search::clear();
+
+    for (int ply = 0; ply < a.maxPlies; ++ply) {
+        if (!MoveList<LEGAL>(pos).size()) {
+            if (!pos.checkers()) return 0.5;
+            return pos.side_to_move() == policyColor ? 0 : 1;
+        }
+        // Threefold repetition or the 50 moves rule
+        if (pos.is_draw(0) || insufficientMaterial(pos)) return 0.5;
+
+        Move m;
+        if (pos.side_to_move() == policyColor) {
+            auto start = std::chrono::steady_clock::now();
+            m = Weak::pick(pos, temperature, depth, rng);
+            std::chrono::duration<double, std::micro> elapsed =
+                std::chrono::steady_clock::now() - start;
+            times.totalUs += elapsed.count();
+            times.maxUs = std::max(times.maxUs, elapsed.count());
+            ++times.picks;
+        } else {
+            m = oldMove(game, OldNodes[level]);
+        }
+        game += " " + UCI::move(m, false);
+        states->emplace_back();
+        pos.do_move(m, states->back());
+    }
+    return 0.5;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Args a = parseArgs(argc, argv);
+
+    tools::initEngine();
+    Options["Threads"] = std::to_string(1);
+
+    std::cout << engine_info() << "\n"
+              << "Weak level match: " << a.games << " games per level, "
+              << a.maxPlies << " plies at most, seed " << a.seed << "\n\n"
+              << "level  temp depth  nodes   wins  draws losses   score     +/-"
+                 "  pick us  max us\n";
+
+    for (int level = 0; level < Weak::Levels; ++level) {
+        if (a.level >= 0 && level != a.level) continue;
+
+        PRNG rng(a.seed);
+        int wins = 0, draws = 0, losses = 0;
+        PickTimes times;
+        for (int g = 0; g < a.games; ++g) {
+            double s = play(a, level, g % 2 ? BLACK : WHITE, rng, times);
+            wins += s == 1;
+            draws += s == 0.5;
+            losses += s == 0;
+            if (a.verbose)
+                std::cout << "game " << g + 1 << ": " << s << "\n";
+        }
+
+        // Mean and 95% confidence interval of the per game score
+        double n = a.games;
+        double mean = (wins + 0.5 * draws) / n;
+        double var = (wins * std::pow(1 - mean, 2) + draws * std::pow(0.5 - mean, 2)
+                      + losses * std::pow(mean, 2)) / n;
+        double error = 1.96 * std::sqrt(var / n);
+
+        std::cout << std::setw(5) << level << std::setw(6) << std::fixed
+                  << std::setprecision(0)
+                  << (a.temperature ? a.temperature : Weak::Temperatures[level])
+                  << std::setw(6) << (a.depth ? a.depth : Weak::Depths[level])
+                  << std::setw(7) << OldNodes[level] << std::setw(7) << wins
+                  << std::setw(7) << draws << std::setw(7) << losses
+                  << std::setw(7) << std::setprecision(1) << 100 * mean << "%"
+                  << std::setw(7) << 100 * error << "%" << std::setw(9)
+                  << times.totalUs / std::max(times.picks, 1) << std::setw(8)
+                  << times.maxUs << "\n";
+    }
+
+    tools::exitEngine();
+    return 0;
+}
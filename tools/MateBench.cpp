@@ -0,0 +1,257 @@
+// Command line mate bench: solves a suite of mate-in-N positions with the
+// df-pn mate solver ("go dfpn mate N") and with the alpha-beta search ("go
+// mate N"), checks that they find the mate of the expected length, and
+// compares their nodes and times.
+//
+//   make mate-bench
+//   build/tools/mate-bench
+//   build/tools/mate-bench --threads 4 --no-search
+//   build/tools/mate-bench --fens mates.txt --nodes 5000000
+//
+// A FEN file has one position per line, followed by "; N" for a mate in N
+// moves. Positions without it are solved up to the longest mate the solver
+// looks for, and only reported. The positions of the suite all mate by
+// checks alone, the only mates the solver looks for; the search finds the
+// others too. Any expected mate the solver misses makes it exit with 1.
+
+#include "Engine.h"
+
+#include "mate.h"
+#include "thread.h"
+#include "uci.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace stockfish;
+
+namespace {
+
+// Mates by checks, shortest first in each group
+const std::vector<std::string> DefaultSuite = {
+    // Morphy - Duke of Brunswick and Count Isouard, Paris 1858
+    "4kb1r/p2n1ppp/4q3/4p1B1/4P3/1Q6/PPP2PPP/2KR4 w k - 1 16; 2",
+    // Reti - Tartakower, Vienna 1910
+    "rnb1kb1r/pp3ppp/2p5/4q3/4n3/3Q4/PPPB1PPP/2KR1BNR w kq - 0 9; 3",
+    // Philidor's smothered mate
+    "r6k/6pp/8/6N1/2Q5/8/5PPP/6K1 w - - 0 1; 4",
+    // Ed. Lasker - Thomas, London 1912
+    "rn3rk1/pbppq1p1/1p2pb2/4N2Q/3PN3/3B4/PPP2PPP/R3K2R w KQ - 0 11; 7",
+    // Playouts of the bench positions (tools::positionCorpus), where no
+    // quiet move mates sooner
+    "6r1/4P1qk/p2B1n2/1pp2np1/1PPr3p/8/P3b1BR/1K4N1 b - - 0 35; 5",
+    "3nk2r/3n4/1Prp2pb/pN3p1p/NP2PPb1/4KB1R/PB4P1/1q6 b - - 3 33; 5",
+    "5r2/8/2k5/2p5/8/Q7/8/K3R3 w - - 18 24; 6",
+    "4R3/8/3k4/1r1p4/2Bp4/q7/3K4/2R3n1 b - - 4 20; 6",
+    "4Qb1k/5pq1/p2Pp3/Pp3r2/N5P1/2rp4/5BpK/1R6 b - - 3 63; 7",
+    "rn2k3/2p2p2/bnN1p1Q1/p3b3/Np2P2r/3B3p/PPP2PPP/1RBK1R2 w q - 3 22; 7",
+    "Q7/2q4k/7p/3p2p1/6K1/6p1/8/6b1 b - - 5 22; 8",
+    "1r3rk1/BqQ1b3/2P2pp1/2Pp3p/P2Rp2P/8/1P2NP2/3KR2b b - - 0 31; 8",
+    "3rR1r1/7q/p5k1/2P3p1/1PP5/5bnp/1K6/5BN1 b - - 0 49; 9",
+    "1k1r4/8/3p3b/8/Q1B1PpP1/1p1P4/1P3N2/4K3 w - - 7 18; 9",
+    "5q1k/pb3p2/4p1pp/6rN/Pp5P/NPb1P3/5PP1/5RK1 b - - 1 34; 11",
+};
+
+struct Args {
+    int hash = 16;
+    int threads = 1;
+    std::string fens;
+    int64_t nodes = 0;
+    int64_t movetime = 0;
+    bool search = true;
+    bool verbose = false;
+};
+
+struct Problem {
+    std::string fen;
+    int moves; // 0 when the length isn't known
+};
+
+// The length in moves of the mate found, 0 for none
+struct Solve {
+    int moves;
+    uint64_t nodes;
+    double ms;
+};
+
+[[noreturn]] void usage(const char* error = nullptr) {
+    if (error) std::cerr << "mate-bench: " << error << "\n\n";
+    std::cerr
+        << "usage: mate-bench [options]\n"
+           "  --hash MB          transposition table and mate hash size (16)\n"
+           "  --threads N        threads of both searches (1)\n"
+           "  --fens FILE        \"<fen>; <moves>\" per line instead of the "
+           "default suite\n"
+           "  --nodes N          node budget of each solve and search\n"
+           "  --movetime MS      time budget of each solve and search\n"
+           "  --no-search        solve with df-pn only\n"
+           "  --verbose          show the solver and search output\n";
+    std::exit(error ? 2 : 0);
+}
+
+Args parseArgs(int argc, char* argv[]) {
+    Args a;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) usage(("missing value for " + arg).c_str());
+            return argv[++i];
+        };
+        if (arg == "--hash") {
+            a.hash = std::stoi(value());
+        } else if (arg == "--threads") {
+            a.threads = std::stoi(value());
+        } else if (arg == "--fens") {
+            a.fens = value();
+        } else if (arg == "--nodes") {
+            a.nodes = std::stoll(value());
+        } else if (arg == "--movetime") {
+            a.movetime = std::stoll(value());
+        } else if (arg == "--no-search") {
+            a.search = false;
+        } else if (arg == "--verbose") {
+            a.verbose = true;
+        } else if (arg == "--help" || arg == "-h") {
+            usage();
+        } else {
+            usage(("unknown option " + arg).c_str());
+        }
+    }
+    if (a.threads < 1) usage("no threads");
+    return a;
+}
+
+Problem parseProblem(const std::string& line) {
+    size_t semicolon = line.find(';');
+    if (semicolon == std::string::npos) return {line, 0};
+    return {line.substr(0, semicolon), std::atoi(line.c_str() + semicolon + 1)};
+}
+
+std::vector<Problem> loadProblems(const Args& a) {
+    std::vector<Problem> problems;
+    if (a.fens.empty()) {
+        for (const auto& line : DefaultSuite)
+            problems.push_back(parseProblem(line));
+        return problems;
+    }
+
+    std::ifstream f(a.fens);
+    if (!f) {
+        std::cerr << "mate-bench: can't read " << a.fens << "\n";
+        std::exit(2);
+    }
+    std::string line;
+    while (std::getline(f, line))
+        if (line.find_first_not_of(" \t\r") != std::string::npos && line[0] != '#')
+            problems.push_back(parseProblem(line));
+    return problems;
+}
+
+// Solves the problem with "go dfpn", or searches it with "go mate"
+Solve run(const Args& a, const Problem& p, bool dfpn) {
+    Position pos;
+    StateListPtr states;
+    tools::setPosition(pos, states, "fen " + p.fen);
+    Search::clear();
+
+    Search::LimitsType limits;
+    limits.mate = p.moves ? p.moves : (dfpn ? Mate::MaxMoves : 0);
+    limits.dfpn = dfpn;
+    limits.nodes = a.nodes;
+    limits.movetime = a.movetime;
+    if (!dfpn && !limits.mate && !a.nodes && !a.movetime)
+        limits.depth = 2 * Mate::MaxMoves; // Not to search forever
+
+    tools::QuietCout quiet(!a.verbose);
+    auto start = std::chrono::steady_clock::now();
+    tools::searchAndWait(pos, states, limits);
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    Solve s = {0, Threads.nodes_searched(), elapsed.count()};
+    if (dfpn) {
+        s.moves = Mate::result().proven ? Mate::result().moves : 0;
+        return s;
+    }
+
+    // The shortest mate any thread has at its root
+    for (Thread* th : Threads) {
+        Value v = th->rootMoves.empty() ? VALUE_NONE : th->rootMoves[0].score;
+        if (v != VALUE_NONE && v >= VALUE_MATE_IN_MAX_PLY) {
+            int moves = (VALUE_MATE - v + 1) / 2;
+            s.moves = s.moves ? std::min(s.moves, moves) : moves;
+        }
+    }
+    return s;
+}
+
+std::string movesString(int moves) {
+    return moves ? std::to_string(moves) : "-";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Args a = parseArgs(argc, argv);
+
+    tools::initEngine();
+    Options["Hash"] = std::to_string(a.hash);
+    Options["Mate Hash"] = std::to_string(a.hash);
+    Options["Threads"] = std::to_string(a.threads);
+
+    std::vector<Problem> problems = loadProblems(a);
+
+    std::cout << engine_info() << "\n"
+              << "Mate bench: " << problems.size() << " positions, "
+              << a.threads << " thread(s), hash " << a.hash << " MB\n\n"
+              << "   #  mate   dfpn        nodes       ms";
+    if (a.search)
+        std::cout << "  search        nodes       ms  speedup";
+    std::cout << "\n";
+
+    Solve dfpnTotal = {0, 0, 0}, searchTotal = {0, 0, 0};
+    int missed = 0;
+
+    for (size_t i = 0; i < problems.size(); ++i) {
+        const Problem& p = problems[i];
+        Solve d = run(a, p, true);
+        dfpnTotal.nodes += d.nodes;
+        dfpnTotal.ms += d.ms;
+        bool miss = p.moves && d.moves != p.moves;
+        missed += miss;
+
+        std::cout << std::setw(4) << i + 1 << std::setw(6)
+                  << movesString(p.moves) << std::setw(7) << movesString(d.moves)
+                  << std::setw(13) << d.nodes << std::setw(9) << std::fixed
+                  << std::setprecision(1) << d.ms;
+
+        if (a.search) {
+            Solve s = run(a, p, false);
+            searchTotal.nodes += s.nodes;
+            searchTotal.ms += s.ms;
+            std::cout << std::setw(8) << movesString(s.moves) << std::setw(13)
+                      << s.nodes << std::setw(9) << s.ms << std::setw(8)
+                      << std::setprecision(1) << s.ms / std::max(d.ms, 0.1)
+                      << "x";
+        }
+        std::cout << (miss ? "  <-- MISSED" : "") << "\n";
+    }
+
+    std::cout << "\ndf-pn : " << dfpnTotal.nodes << " nodes, "
+              << std::setprecision(0) << dfpnTotal.ms << " ms\n";
+    if (a.search)
+        std::cout << "search: " << searchTotal.nodes << " nodes, "
+                  << searchTotal.ms << " ms, " << std::setprecision(1)
+                  << searchTotal.ms / std::max(dfpnTotal.ms, 0.1)
+                  << "x the time of df-pn\n";
+    if (missed)
+        std::cout << "\n" << missed << " expected mate(s) MISSED\n";
+
+    tools::exitEngine();
+    return missed ? 1 : 0;
+}
@@ -0,0 +1,410 @@
+// Microbenchmarks of the engine's hot primitives, each timed in isolation
+// over a corpus of realistic positions: the bench suite plus short playouts
+// from each of its positions.
+//
+//   make microbench
+//   build/tools/microbench [--reps N] [--warmup N] [--plies N] [--filter STR]
+//                          [--kernels NAME]
+//
+// Every benchmark makes a few warmup passes over the corpus, then the timed
+// repetitions. It reports the median and best time per call, cycles per
+// call (from the time stamp counter, on x86) and heap allocations per call.
+// A breakdown of the classical evaluation by step follows, from the same
+// number of passes. The report starts with the time each step of the
+// engine's initialization took, and the build of the KPK bitbase, which its
+// first probe does.
+
+#include "Allocations.h"
+#include "Engine.h"
+
+#include "bitboard.h"
+#include "endgame.h"
+#include "evaluate.h"
+#include "material.h"
+#include "movegen.h"
+#include "pawns.h"
+#include "thread.h"
+#include "tt.h"
+#include "uci.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_RDTSC
+#endif
+
+using namespace stockfish;
+
+namespace {
+
+struct Args {
+    int reps = 10;
+    int warmup = 2;
+    int plies = 16;
+    std::string filter;
+    std::string kernels = "Auto";
+};
+
+[[noreturn]] void usage(const char* error = nullptr) {
+    if (error) std::cerr << "microbench: " << error << "\n\n";
+    std::cerr << "usage: microbench [options]\n"
+                 "  --reps N       timed passes over the corpus (10)\n"
+                 "  --warmup N     untimed passes before them (2)\n"
+                 "  --plies N      playout length from each bench position "
+                 "(16)\n"
+                 "  --filter STR   only run benchmarks whose name contains "
+                 "STR\n"
+                 "  --kernels NAME CPU Kernels option: Auto, Generic, POPCNT, "
+                 "AVX2 or BMI2 (Auto)\n";
+    std::exit(error ? 2 : 0);
+}
+
+Args parseArgs(int argc, char* argv[]) {
+    Args a;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) usage(("missing value for " + arg).c_str());
+            return argv[++i];
+        };
+        if (arg == "--reps") a.reps = std::max(std::stoi(value()), 1);
+        else if (arg == "--warmup") a.warmup = std::stoi(value());
+        else if (arg == "--plies") a.plies = std::stoi(value());
+        else if (arg == "--filter") a.filter = value();
+        else if (arg == "--kernels") a.kernels = value();
+        else if (arg == "--help" || arg == "-h") usage();
+        else usage(("unknown option " + arg).c_str());
+    }
+    return a;
+}
+
+// The corpus, with everything the benchmarks need precomputed so that only
+// the primitive itself is timed
+struct Corpus {
+    std::deque<Position> positions; // Position isn't movable
+    std::deque<StateInfo> states;
+    std::vector<std::vector<Move>> legalMoves;
+    std::vector<std::vector<Move>> captures;
+    std::vector<Key> keys;
+};
+
+void buildCorpus(Corpus& c, int plies) {
+    for (const auto& fen : tools::positionCorpus(plies)) {
+        c.states.emplace_back();
+        Position& pos = c.positions.emplace_back();
+        pos.set(fen, false, &c.states.back(), Threads.main());
+
+        c.legalMoves.emplace_back();
+        c.captures.emplace_back();
+        for (const auto& m : MoveList<LEGAL>(pos)) {
+            c.legalMoves.back().push_back(m);
+            if (pos.capture(m)) c.captures.back().push_back(m);
+        }
+        c.keys.push_back(pos.key());
+    }
+}
+
+// Keeps the compiler from optimizing the benchmarked calls away
+volatile uint64_t sink;
+
+struct Benchmark {
+    std::string name;
+    // One pass over the corpus, returns the number of calls it made
+    std::function<uint64_t()> pass;
+};
+
+std::vector<Benchmark> benchmarks(Corpus& c) {
+    std::vector<Benchmark> res;
+
+    res.push_back({"do_move+undo_move", [&c] {
+        uint64_t calls = 0;
+        StateInfo st;
+        for (size_t i = 0; i < c.positions.size(); ++i) {
+            Position& pos = c.positions[i];
+            for (Move m : c.legalMoves[i]) {
+                pos.do_move(m, st);
+                pos.undo_move(m);
+            }
+            calls += c.legalMoves[i].size();
+        }
+        return calls;
+    }});
+
+    res.push_back({"generate<LEGAL>", [&c] {
+        ExtMove moves[MAX_MOVES];
+        uint64_t n = 0;
+        for (const auto& pos : c.positions)
+            n += generate<LEGAL>(pos, moves) - moves;
+        sink = n;
+        return uint64_t(c.positions.size());
+    }});
+
+    res.push_back({"generate<CAPTURES>", [&c] {
+        ExtMove moves[MAX_MOVES];
+        uint64_t n = 0, calls = 0;
+        for (const auto& pos : c.positions) {
+            if (pos.checkers()) continue; // Only evasions then
+            n += generate<CAPTURES>(pos, moves) - moves;
+            ++calls;
+        }
+        sink = n;
+        return calls;
+    }});
+
+    res.push_back({"see_ge", [&c] {
+        uint64_t n = 0, calls = 0;
+        for (size_t i = 0; i < c.positions.size(); ++i) {
+            for (Move m : c.captures[i])
+                n += c.positions[i].see_ge(m);
+            calls += c.captures[i].size();
+        }
+        sink = n;
+        return calls;
+    }});
+
+    res.push_back({"Eval::evaluate", [&c] {
+        int64_t v = 0;
+        uint64_t calls = 0;
+        for (const auto& pos : c.positions) {
+            if (pos.checkers()) continue; // Not allowed in check
+            v += Eval::evaluate(pos);
+            ++calls;
+        }
+        sink = v;
+        return calls;
+    }});
+
+    res.push_back({"Pawns::probe", [&c] {
+        uint64_t n = 0;
+        for (const auto& pos : c.positions)
+            n += uintptr_t(Pawns::probe(pos));
+        sink = n;
+        return uint64_t(c.positions.size());
+    }});
+
+    res.push_back({"Material::probe", [&c] {
+        uint64_t n = 0;
+        for (const auto& pos : c.positions)
+            n += uintptr_t(Material::probe(pos));
+        sink = n;
+        return uint64_t(c.positions.size());
+    }});
+
+    res.push_back({"Endgames::probe", [&c] {
+        uint64_t n = 0;
+        for (const auto& pos : c.positions)
+            n += uintptr_t(Endgames::probe<Value>(pos.material_key()))
+               + uintptr_t(Endgames::probe<ScaleFactor>(pos.material_key()));
+        sink = n;
+        return uint64_t(c.positions.size());
+    }});
+
+    res.push_back({"TT.probe", [&c] {
+        uint64_t n = 0;
+        bool found;
+        for (Key k : c.keys)
+            n += uintptr_t(TT.probe(k, found)) + found;
+        sink = n;
+        return uint64_t(c.keys.size());
+    }});
+
+    res.push_back({"attacks_bb", [&c] {
+        Bitboard b = 0;
+        uint64_t calls = 0;
+        for (const auto& pos : c.positions) {
+            Bitboard occupied = pos.pieces();
+            for (PieceType pt : {KNIGHT, BISHOP, ROOK, QUEEN, KING}) {
+                Bitboard pieces = pos.pieces(pt);
+                while (pieces) {
+                    b ^= attacks_bb(pt, pop_lsb(&pieces), occupied);
+                    ++calls;
+                }
+            }
+        }
+        sink = b;
+        return calls;
+    }});
+
+    return res;
+}
+
+struct Result {
+    uint64_t calls;
+    double medianNs, bestNs, cycles, allocs;
+};
+
+Result run(const Benchmark& b, const Args& a) {
+    for (int i = 0; i < a.warmup; ++i)
+        b.pass();
+
+    std::vector<double> nsPerCall;
+    uint64_t calls = 0, totalCalls = 0, totalCycles = 0, totalAllocs = 0;
+
+    for (int i = 0; i < a.reps; ++i) {
+        uint64_t allocsBefore = tools::allocations();
+        auto start = std::chrono::steady_clock::now();
+#ifdef HAS_RDTSC
+        uint64_t tsc = __rdtsc();
+#endif
+        calls = b.pass();
+#ifdef HAS_RDTSC
+        totalCycles += __rdtsc() - tsc;
+#endif
+        std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        totalAllocs += tools::allocations() - allocsBefore;
+
+        nsPerCall.push_back(elapsed.count() / std::max<uint64_t>(calls, 1));
+        totalCalls += calls;
+    }
+
+    std::sort(nsPerCall.begin(), nsPerCall.end());
+    totalCalls = std::max<uint64_t>(totalCalls, 1);
+    return {calls, nsPerCall[nsPerCall.size() / 2], nsPerCall.front(),
+            double(totalCycles) / totalCalls,
+            double(totalAllocs) / totalCalls};
+}
+
+// Times the steps of the classical evaluation over the corpus, and prints
+// the cycles (or nanoseconds, off x86) per run of each step and its share of
+// the total. The overhead of the timer itself, measured on empty laps, is
+// taken off each step.
+void timeSteps(Corpus& c, const Args& a) {
+    Eval::StepTimes times{};
+    auto pass = [&] {
+        int64_t v = 0;
+        for (const auto& pos : c.positions)
+            if (!pos.checkers()) v += Eval::time_steps(pos, times);
+        sink = v;
+    };
+
+    for (int i = 0; i < a.warmup; ++i)
+        pass();
+    times = {};
+    for (int i = 0; i < a.reps; ++i)
+        pass();
+
+    constexpr int Laps = 1 << 16;
+    uint64_t start = timestamp(), last = start;
+    for (int i = 0; i < Laps; ++i)
+        last = timestamp();
+    double overhead = double(last - start) / Laps;
+
+    double perRun[Eval::STEP_NB], total = 0;
+    for (int s = 0; s < Eval::STEP_NB; ++s) {
+        perRun[s] = times.runs[s] ? std::max(double(times.ticks[s]) / times.runs[s]
+                                             - overhead, 0.0)
+                                  : 0;
+        total += perRun[s];
+    }
+
+    std::cout << "\n" << std::left << std::setw(20) << "evaluation step"
+              << std::right << std::setw(10) << "runs" << std::setw(12)
+#ifdef HAS_RDTSC
+              << "cycles"
+#else
+              << "ns"
+#endif
+              << std::setw(10) << "share" << "\n";
+
+    for (int s = 0; s < Eval::STEP_NB; ++s)
+        std::cout << std::left << std::setw(20) << Eval::StepNames[s]
+                  << std::right << std::setw(10) << times.runs[s] << std::fixed
+                  << std::setprecision(1) << std::setw(12) << perRun[s]
+                  << std::setw(9) << 100 * perRun[s] / std::max(total, 1.0)
+                  << "%\n";
+}
+
+// Prints the time each step of the initialization took, then the build of
+// the KPK bitbase, which waits for the first probe rather than startup
+void printStartup(double bitbaseUs) {
+    double total = 0;
+
+    std::cout << std::left << std::setw(20) << "startup step" << std::right
+              << std::setw(12) << "us" << "\n" << std::fixed
+              << std::setprecision(1);
+
+    for (const auto& step : tools::startupSteps()) {
+        std::cout << std::left << std::setw(20) << step.name << std::right
+                  << std::setw(12) << step.us << "\n";
+        total += step.us;
+    }
+
+    std::cout << std::left << std::setw(20) << "total" << std::right
+              << std::setw(12) << total << "\n"
+              << std::left << std::setw(20) << "Bitbases::init" << std::right
+              << std::setw(12) << bitbaseUs << "  (on first probe)\n\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Args a = parseArgs(argc, argv);
+
+    tools::initEngine();
+
+    auto bitbaseStart = std::chrono::steady_clock::now();
+    Bitbases::init();
+    std::chrono::duration<double, std::micro> bitbaseUs =
+        std::chrono::steady_clock::now() - bitbaseStart;
+
+    // No evaluation cache, so that Eval::evaluate times the evaluation
+    // itself rather than cache hits on the corpus
+    Options["Eval Hash"] = std::string("0");
+    Options["CPU Kernels"] = a.kernels;
+
+    Corpus corpus;
+    buildCorpus(corpus, a.plies);
+
+    // Half full, like during a search
+    {
+        tools::QuietCout quiet;
+        Position pos;
+        StateListPtr states;
+        tools::setPosition(pos, states, "startpos");
+        Search::LimitsType limits;
+        limits.nodes = 200000;
+        tools::searchAndWait(pos, states, limits);
+    }
+
+    std::cout << engine_info() << "\n"
+              << "Corpus: " << corpus.positions.size() << " positions, "
+              << a.warmup << " warmup and " << a.reps << " timed passes\n\n";
+
+    printStartup(bitbaseUs.count());
+
+    std::cout << std::left << std::setw(20) << "benchmark" << std::right
+              << std::setw(10) << "calls" << std::setw(12) << "median ns"
+              << std::setw(10) << "best ns" << std::setw(10) << "cycles"
+              << std::setw(10) << "allocs" << "\n";
+
+    for (const auto& b : benchmarks(corpus)) {
+        if (b.name.find(a.filter) == std::string::npos)
+            continue;
+        Result r = run(b, a);
+        std::cout << std::left << std::setw(20) << b.name << std::right
+                  << std::setw(10) << r.calls << std::fixed
+                  << std::setprecision(2) << std::setw(12) << r.medianNs
+                  << std::setw(10) << r.bestNs << std::setprecision(1)
+#ifdef HAS_RDTSC
+                  << std::setw(10) << r.cycles
+#else
+                  << std::setw(10) << "-"
+#endif
+                  << std::setprecision(3) << std::setw(10) << r.allocs
+                  << "\n";
+    }
+
+    if (std::string("Eval::evaluate").find(a.filter) != std::string::npos)
+        timeSteps(corpus, a);
+
+    tools::exitEngine();
+}
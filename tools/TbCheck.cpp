@@ -0,0 +1,330 @@
+// Command line check of the generated tablebases (TBGen): builds the tables
+// and compares them with results found without them.
+//
+//   - KPvK against the KPK bitbase, on all its legal positions
+//   - Random positions of each table, and of KPvKP with en passant rights,
+//     against a 1-ply search over the tables: the value of a position must
+//     be the best of the values after its moves, or the result of the mate
+//     or stalemate when it has none.
+//
+//   make tb-check
+//   build/tools/tb-check
+//   build/tools/tb-check --tables KRvKN,KPvKP --positions 100000
+//   build/tools/tb-check --cache tb
+//
+// A table's build time includes the tables it depends on that were not built
+// yet: all of them take about 2 minutes on one core. Any mismatch makes it
+// exit with 1.
+
+#include "Engine.h"
+
+#include "bitboard.h"
+#include "movegen.h"
+#include "tbgen.h"
+#include "thread.h"
+#include "uci.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace stockfish;
+using namespace stockfish::Tablebases;
+
+namespace {
+
+struct Args {
+    int positions = 20000;
+    std::vector<std::string> tables; // All of them when empty
+    std::string cache;
+    uint64_t seed = 1;
+};
+
+[[noreturn]] void usage(const char* error = nullptr) {
+    if (error) std::cerr << "tb-check: " << error << "\n\n";
+    std::cerr
+        << "usage: tb-check [options]\n"
+           "  --positions N      random positions per table (20000)\n"
+           "  --tables A,B,...   check only these tables, like KRvKN\n"
+           "  --cache DIR        load and save the tables there\n"
+           "  --seed N           seed of the random positions (1)\n";
+    std::exit(error ? 2 : 0);
+}
+
+Args parseArgs(int argc, char* argv[]) {
+    Args a;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) usage(("missing value for " + arg).c_str());
+            return argv[++i];
+        };
+        if (arg == "--positions") {
+            a.positions = std::stoi(value());
+        } else if (arg == "--tables") {
+            std::istringstream is(value());
+            std::string code;
+            while (std::getline(is, code, ','))
+                a.tables.push_back(code);
+        } else if (arg == "--cache") {
+            a.cache = value();
+        } else if (arg == "--seed") {
+            a.seed = std::stoull(value());
+        } else if (arg == "--help" || arg == "-h") {
+            usage();
+        } else {
+            usage(("unknown option " + arg).c_str());
+        }
+    }
+    if (a.positions < 0) usage("negative positions");
+    if (!a.seed) usage("the seed can't be 0");
+    return a;
+}
+
+// The codes of the tables TBGen builds, the stronger side being white
+std::vector<std::string> allTables() {
+    const std::string pieces = "PNBRQ";
+    std::vector<std::string> codes;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        codes.push_back(std::string("K") + pieces[i] + "vK");
+        for (size_t j = 0; j <= i; ++j) {
+            codes.push_back(std::string("K") + pieces[i] + pieces[j] + "vK");
+            codes.push_back(std::string("K") + pieces[i] + "vK" + pieces[j]);
+        }
+    }
+    return codes;
+}
+
+// The pieces of a table's code, the white ones first
+std::vector<Piece> piecesOf(const std::string& code) {
+    std::vector<Piece> pieces;
+    Color c = BLACK;
+    for (char ch : code) {
+        if (ch == 'v') continue;
+        if (ch == 'K') c = ~c;
+        PieceType pt = PieceType(std::string(" PNBRQK").find(ch));
+        pieces.push_back(make_piece(c, pt));
+    }
+    return pieces;
+}
+
+std::string fenOf(const std::vector<Piece>& pieces, const std::vector<Square>& squares,
+                  Color stm, Square ep = SQ_NONE) {
+    const std::string pieceToChar = " PNBRQK  pnbrqk";
+    char board[SQUARE_NB] = {};
+    for (size_t i = 0; i < pieces.size(); ++i)
+        board[squares[i]] = pieceToChar[pieces[i]];
+
+    std::string fen;
+    for (Rank r = RANK_8; r >= RANK_1; --r) {
+        int empty = 0;
+        for (File f = FILE_A; f <= FILE_H; ++f) {
+            char ch = board[make_square(f, r)];
+            if (!ch) {
+                ++empty;
+                continue;
+            }
+            if (empty) fen += char('0' + empty);
+            empty = 0;
+            fen += ch;
+        }
+        if (empty) fen += char('0' + empty);
+        if (r > RANK_1) fen += '/';
+    }
+    return fen + (stm == WHITE ? " w - " : " b - ")
+         + (ep == SQ_NONE ? "-" : UCI::square(ep)) + " 0 1";
+}
+
+// Sets pos from the FEN, and tells whether the position is legal: the side
+// not to move can't be in check
+bool setLegal(Position& pos, StateInfo& st, const std::string& fen) {
+    pos.set(fen, false, &st, Threads.main());
+    Color us = pos.side_to_move();
+    return !(pos.attackers_to(pos.square<KING>(~us)) & pos.pieces(us));
+}
+
+// The value of pos by the tables, WDLScoreNone if the probe failed
+WDLScore probe(Position& pos) {
+    ProbeState result;
+    WDLScore v = TBGen::probe_wdl(pos, &result);
+    return result == FAIL ? WDLScoreNone : v;
+}
+
+// The value of pos by a 1-ply search over the tables
+WDLScore search(Position& pos) {
+    MoveList<LEGAL> moves(pos);
+    if (!moves.size()) return pos.checkers() ? WDLLoss : WDLDraw;
+
+    WDLScore best = WDLLoss;
+    for (Move m : moves) {
+        StateInfo st;
+        pos.do_move(m, st);
+        WDLScore v = probe(pos);
+        pos.undo_move(m);
+        if (v == WDLScoreNone) return WDLScoreNone;
+        best = std::max(best, WDLScore(-v));
+    }
+    return best;
+}
+
+struct Count {
+    int positions = 0;
+    int mismatches = 0;
+};
+
+// Checks a legal position against the 1-ply search
+void check(Position& pos, Count& c) {
+    WDLScore v = probe(pos);
+    ++c.positions;
+    if (v == WDLScoreNone || v != search(pos)) {
+        if (++c.mismatches <= 5)
+            std::cout << "  mismatch: " << pos.fen() << "\n";
+    }
+}
+
+Count checkRandom(const std::string& code, int positions, PRNG& rng) {
+    std::vector<Piece> pieces = piecesOf(code);
+    std::vector<Square> squares(pieces.size());
+    Position pos;
+    StateInfo st;
+    Count c;
+
+    while (c.positions < positions) {
+        Bitboard occupied = 0;
+        bool ok = true;
+        for (size_t i = 0; i < pieces.size() && ok; ++i) {
+            squares[i] = Square(rng.rand<unsigned>() % SQUARE_NB);
+            ok = !(occupied & squares[i])
+              && !(type_of(pieces[i]) == PAWN
+                   && (rank_of(squares[i]) == RANK_1 || rank_of(squares[i]) == RANK_8));
+            occupied |= squares[i];
+        }
+        Color stm = Color(rng.rand<unsigned>() & 1);
+        if (ok && setLegal(pos, st, fenOf(pieces, squares, stm)))
+            check(pos, c);
+    }
+    return c;
+}
+
+// KPvKP positions where the side to move can capture en passant: the pawn
+// of the other side has just made a double push next to its own
+Count checkEnPassant(int positions, PRNG& rng) {
+    const std::vector<Piece> pieces = {W_KING, W_PAWN, B_KING, B_PAWN};
+    std::vector<Square> squares(pieces.size());
+    Position pos;
+    StateInfo st;
+    Count c;
+
+    while (c.positions < positions) {
+        Color us = Color(rng.rand<unsigned>() & 1);
+        File f = File(rng.rand<unsigned>() % FILE_NB);
+        File g = f == FILE_A ? FILE_B : f == FILE_H ? FILE_G
+               : File(rng.rand<unsigned>() & 1 ? f + 1 : f - 1);
+        Square pushed = make_square(f, relative_rank(~us, RANK_4));
+        Square ours = make_square(g, rank_of(pushed));
+        squares[1] = us == WHITE ? ours : pushed;
+        squares[3] = us == WHITE ? pushed : ours;
+        squares[0] = Square(rng.rand<unsigned>() % SQUARE_NB);
+        squares[2] = Square(rng.rand<unsigned>() % SQUARE_NB);
+
+        Bitboard occupied = 0;
+        bool ok = true;
+        for (Square s : squares) {
+            ok &= !(occupied & s);
+            occupied |= s;
+        }
+        Square ep = pushed - pawn_push(~us);
+        ok &= !(occupied & (ep | (ep - pawn_push(~us))));
+        if (ok && setLegal(pos, st, fenOf(pieces, squares, us, ep)) && pos.ep_square() != SQ_NONE)
+            check(pos, c);
+    }
+    return c;
+}
+
+// All the legal KPvK positions against the KPK bitbase, which tells whether
+// white wins
+Count checkKPK() {
+    const std::vector<Piece> pieces = {W_KING, W_PAWN, B_KING};
+    std::vector<Square> squares(pieces.size());
+    Position pos;
+    StateInfo st;
+    Count c;
+
+    for (Square wksq = SQ_A1; wksq <= SQ_H8; ++wksq)
+        for (Square bksq = SQ_A1; bksq <= SQ_H8; ++bksq)
+            for (Square psq = SQ_A2; psq <= SQ_H7; ++psq)
+                for (Color stm : {WHITE, BLACK}) {
+                    if (file_of(psq) > FILE_D || wksq == bksq || wksq == psq || bksq == psq)
+                        continue;
+                    squares = {wksq, psq, bksq};
+                    if (!setLegal(pos, st, fenOf(pieces, squares, stm)))
+                        continue;
+
+                    WDLScore v = probe(pos);
+                    bool whiteWins = v == (stm == WHITE ? WDLWin : WDLLoss);
+                    bool blackWins = v == (stm == WHITE ? WDLLoss : WDLWin);
+                    ++c.positions;
+                    if (v == WDLScoreNone || blackWins
+                        || whiteWins != Bitbases::probe(wksq, psq, bksq, stm)) {
+                        if (++c.mismatches <= 5)
+                            std::cout << "  mismatch: " << pos.fen() << "\n";
+                    }
+                }
+    return c;
+}
+
+void report(const std::string& name, double buildMs, const Count& c) {
+    std::cout << std::left << std::setw(10) << name << std::right << std::setw(10)
+              << std::fixed << std::setprecision(0) << buildMs << std::setw(11)
+              << c.positions << std::setw(12) << c.mismatches << "\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Args a = parseArgs(argc, argv);
+
+    tools::initEngine();
+    Options["Generated Tablebases Path"] = a.cache.empty() ? "<empty>" : a.cache;
+    Options["Generated Tablebases"] = std::to_string(TBGen::MaxPieces);
+
+    std::vector<std::string> tables = a.tables.empty() ? allTables() : a.tables;
+    PRNG rng(a.seed);
+    int mismatches = 0;
+
+    std::cout << engine_info() << "\n"
+              << "Tablebase check: " << tables.size() << " table(s), "
+              << a.positions << " random positions each\n\n"
+              << "table      build ms  positions  mismatches\n";
+
+    for (const std::string& code : tables) {
+        auto start = std::chrono::steady_clock::now();
+        if (!TBGen::build(code)) usage(("no table " + code).c_str());
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        Count c = checkRandom(code, a.positions, rng);
+        report(code, elapsed.count(), c);
+        mismatches += c.mismatches;
+
+        if (code == "KPvK") {
+            c = checkKPK();
+            report("KPK", 0, c);
+            mismatches += c.mismatches;
+        }
+        if (code == "KPvKP") {
+            c = checkEnPassant(a.positions, rng);
+            report("KPvKP ep", 0, c);
+            mismatches += c.mismatches;
+        }
+    }
+
+    if (mismatches)
+        std::cout << "\n" << mismatches << " mismatch(es)\n";
+
+    tools::exitEngine();
+    return mismatches ? 1 : 0;
+}
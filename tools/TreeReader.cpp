@@ -0,0 +1,268 @@
+// Reads the search trees the engine records when built with -DSEARCH_TREE
+// (see Chess/stockfish/searchtree.h) and prints statistics per ply, the root
+// nodes, one per iteration and re-search, or the subtree of a node.
+//
+//   make tree-reader
+//   build/tools/tree-reader FILE [--thread N] [--roots] [--subtree IDX]
+//                           [--plies N]
+//
+// Each line of a tree is a node: its index, the move leading to it, depth,
+// window, static eval and what happened there. "cut@3" means that the third
+// move failed high.
+
+#include "searchtree.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace stockfish;
+using SearchTree::Record;
+
+namespace {
+
+struct Args {
+    std::string path;
+    int thread = -1; // All of them
+    bool roots = false;
+    int64_t subtree = -1;
+    int plies = 2;
+};
+
+[[noreturn]] void usage(const char* error = nullptr) {
+    if (error) std::cerr << "tree-reader: " << error << "\n\n";
+    std::cerr << "usage: tree-reader FILE [options]\n"
+                 "  --thread N     only the nodes of thread N (all)\n"
+                 "  --roots        list the root nodes\n"
+                 "  --subtree IDX  print the subtree of node IDX (of thread "
+                 "0 unless --thread)\n"
+                 "  --plies N      plies of the subtree to print (2)\n";
+    std::exit(error ? 2 : 0);
+}
+
+Args parseArgs(int argc, char* argv[]) {
+    Args a;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) usage(("missing value for " + arg).c_str());
+            return argv[++i];
+        };
+        if (arg == "--thread") a.thread = std::stoi(value());
+        else if (arg == "--roots") a.roots = true;
+        else if (arg == "--subtree") a.subtree = std::stoll(value());
+        else if (arg == "--plies") a.plies = std::stoi(value());
+        else if (arg == "--help" || arg == "-h") usage();
+        else if (arg[0] == '-') usage(("unknown option " + arg).c_str());
+        else a.path = arg;
+    }
+    if (a.path.empty()) usage("no file");
+    return a;
+}
+
+struct Tree {
+    std::string fen;
+    std::vector<std::vector<Record>> threads;
+};
+
+Tree load(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        std::cerr << "tree-reader: can't read " << path << "\n";
+        std::exit(2);
+    }
+
+    SearchTree::FileHeader h;
+    f.read(reinterpret_cast<char*>(&h), sizeof(h));
+    if (!f || std::string(h.magic, 4) != "SFTR" ||
+        h.version != SearchTree::FileVersion ||
+        h.recordSize != sizeof(Record)) {
+        std::cerr << "tree-reader: " << path
+                  << " isn't a search tree of this version\n";
+        std::exit(2);
+    }
+
+    Tree t;
+    t.fen.resize(h.fenLength);
+    f.read(t.fen.data(), h.fenLength);
+    t.threads.resize(h.threads);
+    for (auto& records : t.threads) {
+        uint64_t count = 0;
+        f.read(reinterpret_cast<char*>(&count), sizeof(count));
+        records.resize(count);
+        f.read(reinterpret_cast<char*>(records.data()),
+               count * sizeof(Record));
+    }
+    if (!f) {
+        std::cerr << "tree-reader: " << path << " is truncated\n";
+        std::exit(2);
+    }
+    return t;
+}
+
+std::string squareString(Square s) {
+    return {char('a' + file_of(s)), char('1' + rank_of(s))};
+}
+
+std::string moveString(uint16_t move) {
+    Move m = Move(move);
+    if (m == MOVE_NONE) return "(root)";
+    if (m == MOVE_NULL) return "(null)";
+
+    Square from = from_sq(m), to = to_sq(m);
+    // Castling is stored as king takes rook
+    if (type_of(m) == CASTLING)
+        to = make_square(to > from ? FILE_G : FILE_C, rank_of(from));
+
+    std::string s = squareString(from) + squareString(to);
+    if (type_of(m) == PROMOTION)
+        s += " pnbrqk"[promotion_type(m)];
+    return s;
+}
+
+std::string valueString(int16_t v) {
+    if (v == VALUE_NONE) return "-";
+    if (v >= VALUE_INFINITE) return "inf";
+    if (v <= -VALUE_INFINITE) return "-inf";
+    if (v >= VALUE_MATE_IN_MAX_PLY) return "#" + std::to_string(VALUE_MATE - v);
+    if (v <= VALUE_MATED_IN_MAX_PLY) return "-#" + std::to_string(VALUE_MATE + v);
+    return std::to_string(v);
+}
+
+void printNode(const Record& r, size_t idx, int indent) {
+    std::cout << std::setw(8) << idx << "  " << std::string(2 * indent, ' ')
+              << std::left << std::setw(7) << moveString(r.move) << std::right
+              << " d" << int(r.depth) << " [" << valueString(r.alpha) << ","
+              << valueString(r.beta) << "] eval " << valueString(r.staticEval);
+
+    if (r.flags & SearchTree::PvNode) std::cout << " pv";
+    else if (r.flags & SearchTree::CutNode) std::cout << " cut";
+    else std::cout << " all";
+
+    if (r.flags & SearchTree::QSearch) std::cout << " qs";
+    if (r.flags & SearchTree::Excluded) std::cout << " excl";
+    if (r.flags & SearchTree::InCheck) std::cout << " check";
+    if (r.flags & SearchTree::TTHit) std::cout << " tt";
+    if (r.cutoffMove) std::cout << " cut@" << int(r.cutoffMove);
+    std::cout << "\n";
+}
+
+std::vector<std::vector<size_t>> children(const std::vector<Record>& records) {
+    std::vector<std::vector<size_t>> res(records.size());
+    for (size_t i = 0; i < records.size(); ++i)
+        if (records[i].parent != SearchTree::NoParent)
+            res[records[i].parent].push_back(i);
+    return res;
+}
+
+void printSubtree(const std::vector<Record>& records,
+                  const std::vector<std::vector<size_t>>& kids, size_t idx,
+                  int indent, int plies) {
+    printNode(records[idx], idx, indent);
+    if (plies == 0) return;
+    for (size_t c : kids[idx])
+        printSubtree(records, kids, c, indent + 1, plies - 1);
+}
+
+struct PlyStats {
+    uint64_t nodes = 0, qnodes = 0, ttHits = 0, inCheck = 0;
+    uint64_t interior = 0, children = 0;
+    uint64_t pv = 0, cut = 0, all = 0;
+    uint64_t failHighs = 0, firstMoveCutoffs = 0, cutoffMoveSum = 0;
+};
+
+double percent(uint64_t a, uint64_t b) {
+    return b ? 100.0 * a / b : 0;
+}
+
+void printStats(const Tree& t, int thread) {
+    std::vector<PlyStats> plies;
+    uint64_t excluded = 0;
+
+    for (size_t th = 0; th < t.threads.size(); ++th) {
+        if (thread >= 0 && int(th) != thread) continue;
+        const auto& records = t.threads[th];
+        for (const Record& r : records) {
+            if (plies.size() <= r.ply) plies.resize(r.ply + 1);
+            PlyStats& s = plies[r.ply];
+
+            ++s.nodes;
+            s.qnodes += bool(r.flags & SearchTree::QSearch);
+            s.ttHits += bool(r.flags & SearchTree::TTHit);
+            s.inCheck += bool(r.flags & SearchTree::InCheck);
+            excluded += bool(r.flags & SearchTree::Excluded);
+
+            if (r.flags & SearchTree::PvNode) ++s.pv;
+            else if (r.flags & SearchTree::CutNode) ++s.cut;
+            else ++s.all;
+
+            if (r.cutoffMove) {
+                ++s.failHighs;
+                s.firstMoveCutoffs += r.cutoffMove == 1;
+                s.cutoffMoveSum += r.cutoffMove;
+            }
+        }
+        auto kids = children(records);
+        for (size_t i = 0; i < records.size(); ++i) {
+            if (kids[i].empty()) continue;
+            ++plies[records[i].ply].interior;
+            plies[records[i].ply].children += kids[i].size();
+        }
+    }
+
+    uint64_t total = 0;
+    for (const auto& s : plies) total += s.nodes;
+    std::cout << total << " nodes, " << excluded
+              << " of them in singular extension searches\n\n"
+              << " ply      nodes    qs%    tt%  check%   pv%  cut%  all%"
+                 "  branch   fh%  1st%  avg cut\n";
+
+    for (size_t ply = 0; ply < plies.size(); ++ply) {
+        const PlyStats& s = plies[ply];
+        std::cout << std::fixed << std::setprecision(1) << std::setw(4) << ply
+                  << std::setw(11) << s.nodes << std::setw(7)
+                  << percent(s.qnodes, s.nodes) << std::setw(7)
+                  << percent(s.ttHits, s.nodes) << std::setw(8)
+                  << percent(s.inCheck, s.nodes) << std::setw(6)
+                  << percent(s.pv, s.nodes) << std::setw(6)
+                  << percent(s.cut, s.nodes) << std::setw(6)
+                  << percent(s.all, s.nodes) << std::setw(8)
+                  << std::setprecision(2)
+                  << (s.interior ? double(s.children) / s.interior : 0)
+                  << std::setprecision(1) << std::setw(6)
+                  << percent(s.failHighs, s.nodes) << std::setw(6)
+                  << percent(s.firstMoveCutoffs, s.failHighs) << std::setw(9)
+                  << std::setprecision(2)
+                  << (s.failHighs ? double(s.cutoffMoveSum) / s.failHighs : 0)
+                  << "\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Args a = parseArgs(argc, argv);
+    Tree t = load(a.path);
+
+    std::cout << "Root: " << t.fen << "\nThreads:";
+    for (const auto& records : t.threads) std::cout << " " << records.size();
+    std::cout << " nodes\n\n";
+
+    if (a.thread >= int(t.threads.size())) usage("no such thread");
+    int thread = std::max(a.thread, 0);
+    const auto& records = t.threads[thread];
+
+    if (a.subtree >= 0) {
+        if (a.subtree >= int64_t(records.size())) usage("no such node");
+        printSubtree(records, children(records), a.subtree, 0, a.plies);
+    } else if (a.roots) {
+        for (size_t i = 0; i < records.size(); ++i)
+            if (records[i].parent == SearchTree::NoParent)
+                printNode(records[i], i, 0);
+    } else {
+        printStats(t, a.thread);
+    }
+}
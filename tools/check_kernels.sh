@@ -0,0 +1,64 @@
+#!/bin/sh
+# Checks that the kernels of Chess/stockfish/arch stay out of the code every
+# CPU runs (see cpu.h). Each arch object compiles the headers again with the
+# flags of its instruction set, so any inline function of them it doesn't
+# inline would be shared with the baseline objects, and the linker could keep
+# the copy with POPCNT, AVX2 or PEXT instructions for everyone.
+#
+#   tools/check_kernels.sh <arch objects> -- <programs>
+#
+# Fails if an arch object defines a global symbol outside the isa_* namespaces,
+# or a program has a global function outside them that uses the instructions
+# of the kernels or calls into them. NM and OBJDUMP select the binutils, e.g.
+# for MinGW.
+
+NM=${NM:-nm}
+OBJDUMP=${OBJDUMP:-objdump}
+
+# POPCNT, SSSE3 and SSE 4.1, AVX and AVX2, BMI2. tzcnt is left out: it decodes
+# "rep bsf", which the baseline uses too.
+ISA='popcnt|pext|pdep|shlx|shrx|sarx|rorx|bzhi|mulx'
+ISA="$ISA|pshufb|pmaddubsw|phadd|phsub|psign|pabs|palignr|pmulhrsw"
+ISA="$ISA|ptest|pblend|pmins[bd]|pmaxs[bd]|pminu[dw]|pmaxu[dw]|pmulld|pmuldq"
+ISA="$ISA|pextr[bdq]|pinsr[bdq]|pmovsx|pmovzx|packusdw|pcmpeqq|pcmpgtq|round[ps][sd]"
+ISA="$ISA|insertps|extractps|blendv|dpp[sd]|mpsadbw|phminposuw|v[a-z0-9]+"
+
+status=0
+kernels=1
+globals=$(mktemp)
+trap 'rm -f "$globals"' EXIT
+
+for f in "$@"; do
+    if [ "$f" = "--" ]; then
+        kernels=0
+        continue
+    fi
+
+    if [ $kernels = 1 ]; then
+        # MinGW's .refptr pointers to global variables are the same in any object
+        bad=$($NM --defined-only "$f" |
+              awk '$2 ~ /^[A-Zuvw]$/ && $3 !~ /isa_/ && $3 !~ /^\.refptr\./ { print $3 }')
+        what="defines outside the isa_* namespaces"
+    else
+        $NM --defined-only "$f" | awk '$2 ~ /^[TWi]$/ && $3 !~ /isa_/ { print $3 }' > "$globals"
+        bad=$($OBJDUMP -d --no-show-raw-insn "$f" |
+              awk -v isa="^($ISA)" '
+                  NR == FNR { global[$1] = 1; next }
+                  /^[0-9a-f]+ <.*>:$/ { split($0, h, " "); fn = substr(h[2], 2, length(h[2]) - 3); next }
+                  !(fn in global) { next }
+                  $2 ~ isa || $0 ~ /%ymm/ || ($2 ~ /^(call|jmp)/ && $0 ~ /isa_/ && $0 !~ /isa_base/) {
+                      print fn
+                      delete global[fn]
+                  }
+              ' "$globals" FS='\t' -)
+        what="uses the kernels outside the isa_* namespaces in"
+    fi
+
+    if [ -n "$bad" ]; then
+        echo "$f $what:" >&2
+        echo "$bad" | c++filt | sed 's/^/    /' >&2
+        status=1
+    fi
+done
+
+exit $status